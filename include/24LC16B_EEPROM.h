@@ -5,7 +5,8 @@
 #include <stdlib.h>
 #include <math.h>
 #include <string.h>
-#include "24LC16B_EEPROM_i2c.h"
+#include "i2c_bus.h"
+#include "i2c_pio.h"
 #include "pico_rtc.h"
 #include "com_protocol.h"
 
@@ -23,13 +24,22 @@ Whenever a specific page is referenced I will refer to it as 24LC16B_DOC_x where
 This driver is meant to work on any micro controller using C.
 The driver communicates to the eeprom through I2C
 The eeprom address is non configurable :(
-The 24LC16B_EEPROM_i2c.h header file is meant to be a generic wrapper function where one puts in a board specific I2C implementation.
+All transfers go through the shared bus layer in i2c_bus.h.
+The block-select bits are part of the I2C address, so the chip shows up as 8 devices, one descriptor per block (lcb16b_i2c_devices).
+The descriptors sit on LCB16B_I2C_BUS. With I2C_EEPROM_ON_PIO_BUS set in i2c_config.h that is the PIO bus, so page writes never hold up the sensors.
 The i2c_config.h header is meant to be a generic header where one defines I2C parameters and initialize functions.
 More information can be found in the header itself.
 
 Currently this driver is configured to work with the pico SDK.
 */
 
+// Bus the chip is wired to
+#if I2C_EEPROM_ON_PIO_BUS
+#define LCB16B_I2C_BUS (&i2c_bus1)
+#else
+#define LCB16B_I2C_BUS (&i2c_bus0)
+#endif
+
 // 24LC16B global constants
 #define LCB16B_CHIP_ID_ADDR _u(0x000) //Configured myself for future
 #define LCB16B_CHIP_ID _u(0xAA) //Configured myself for future
@@ -39,6 +49,14 @@ Currently this driver is configured to work with the pico SDK.
 
 #define LCB16B_PAGE_WRITE_TIME_SAFETY _u(4) // Defines the scalar to scale LCB16B_PAGE_WRITE_TIME to form a safety margin
 #define LCB16B_PAGE_WRITE_TIME _u(5) // From 24LC16B_DOC_8 there is a max page write time of 5ms, make it wait 4X for safety
+#define LCB16B_PAGE_SIZE _u(16) // Size of the page write buffer given at 24LC16B_DOC_1. One write cycle commits at most one page.
+#define LCB16B_BLOCK_SIZE _u(256) // Each block-select value addresses 256 bytes 24LC16B_DOC_7
+#define LCB16B_N_BLOCKS _u(8) // 8 blocks of 256 bytes gives the 16 Kbit (2 KB) of the chip
+#define LCB16B_SIZE (LCB16B_BLOCK_SIZE * LCB16B_N_BLOCKS) // Total amount of bytes on the chip
+
+#define LCB16B_WRITE_BUFFER_ENABLE 1 // Flag to gather small writes in RAM and commit them as whole page writes. Set to 0 to write through.
+#define LCB16B_WRITE_BUFFER_TIMEOUT _u(1000) // Max time in ms a partially filled page may stay in RAM before lcb16b_buffer_poll flushes it
+#define LCB16B_MIRROR_ENABLE 1 // Flag to keep a RAM copy of the whole chip. Loaded on init, reads are then served without touching I2C.
 
 #define LCB16B_INIT 0 //Flag to use to determine if new chipID should be written. If set to 0 will only see if chipID can be read.
 #define LCB16B_DEBUG 1 //Flag to determine if USB debug statements should be printed.
@@ -59,12 +77,35 @@ struct lcb16b_eeprom {
 
     uint8_t *dst; // Stores data to be read
     uint8_t dst_len; // Stores the length of dst to be read
+
+    // Write-back buffer. Holds the page currently being gathered until it is full, timed out or synced.
+    #if LCB16B_WRITE_BUFFER_ENABLE
+    uint8_t wbuf[LCB16B_PAGE_SIZE]; // Pending bytes of the buffered page
+    uint16_t wbuf_page; // First register of the buffered page
+    uint16_t wbuf_mask; // Bit i is set when byte i of wbuf holds pending data
+    uint32_t wbuf_time; // Time in ms since boot of the oldest pending write
+    #endif
+
+    // RAM mirror of the entire chip. Always holds the newest data, including bytes still pending in the write-back buffer.
+    #if LCB16B_MIRROR_ENABLE
+    uint8_t mirror[LCB16B_SIZE];
+    bool mirror_valid; // Only serve reads from the mirror once it has been loaded
+    #endif
 };
 
+//Bus descriptors, one per block-select value
+extern struct i2c_device lcb16b_i2c_devices[LCB16B_N_BLOCKS];
+
+// Sink used by the streaming read. Called once per block with the register of the first byte in data.
+// data is only valid for the duration of the call.
+typedef void (*lcb16b_sink_t)(uint16_t reg, const uint8_t *data, uint16_t len, void *ctx);
+
 //Helper functions
 
 // Returns control byte
 uint8_t return_device_address(uint16_t register_address);
+// Returns the bus descriptor of the block register_address lives in
+const struct i2c_device* lcb16b_i2c_device(uint16_t register_address);
 
 //Main Functions
 
@@ -73,16 +114,68 @@ void lcb16b_eeprom_init(struct lcb16b_eeprom* my_eeprom);
 
 //Writing functions
 
-//Performs a random write operation
-void lcb16b_eeprom_random_write(struct lcb16b_eeprom* my_eeprom);
-//Performs a write to the address pointed to by register
-void lcb16b_eeprom_point_write(struct lcb16b_eeprom* my_eeprom, uint16_t reg);
+//Performs a random write operation. Returns the bytes taken, less than src_len if a write failed.
+//The pointer only moves past what was taken.
+uint16_t lcb16b_eeprom_random_write(struct lcb16b_eeprom* my_eeprom);
+//Performs a write to the address pointed to by register. Same return value as random write.
+uint16_t lcb16b_eeprom_point_write(struct lcb16b_eeprom* my_eeprom, uint16_t reg);
 
 //Performs a random read operation
 void lcb16b_eeprom_random_read(struct lcb16b_eeprom* my_eeprom);
 //Performs a read to the address pointed to by register
 void lcb16b_eeprom_point_read(struct lcb16b_eeprom* my_eeprom, uint16_t reg);
 
+//Streams len bytes starting at reg into sink, one sequential read per 256 byte block touched.
+//Does not move the internal pointer. Returns the amount of bytes delivered.
+uint16_t lcb16b_eeprom_stream_read(struct lcb16b_eeprom* my_eeprom, uint16_t reg, uint16_t len, lcb16b_sink_t sink, void *ctx);
+//Streams the entire chip into the dump printer. Executed by the com protocol.
+void lcb16b_eeprom_dump(struct lcb16b_eeprom* my_eeprom);
+
+//Writes len bytes starting at reg without touching the internal pointer. Goes through the mirror and write-back buffer when enabled.
+//Returns the bytes taken, less than len when a page could not be committed to the chip.
+uint16_t lcb16b_eeprom_write(struct lcb16b_eeprom* my_eeprom, uint16_t reg, const uint8_t *src, uint16_t len);
+//Low level write of len bytes starting at reg. Splits the data on page boundaries, one write cycle per page.
+//Returns the bytes written, stopping at the first page that failed, or the bus error if the first page failed.
+int lcb16b_eeprom_page_write(uint16_t reg, const uint8_t *src, uint16_t len);
+
+// Write-back buffer functions
+/*
+When LCB16B_WRITE_BUFFER_ENABLE is set random_write and point_write no longer go straight to the chip.
+Bytes are gathered in a single page sized RAM buffer and committed with one page write when:
+1) The page is full.
+2) A write lands on a different page.
+3) lcb16b_buffer_poll finds the oldest pending byte older than LCB16B_WRITE_BUFFER_TIMEOUT.
+4) lcb16b_buffer_sync is called.
+A page that fails to commit stays pending with its mask intact and is tried again by the next sync or poll.
+Until then writes to other pages are not taken.
+Overlapping writes to the same address are merged, the newest value wins.
+Reads are patched with pending bytes so the buffer stays invisible to the caller.
+*/
+#if LCB16B_WRITE_BUFFER_ENABLE
+// Clears the write-back buffer
+void lcb16b_buffer_init(struct lcb16b_eeprom* my_eeprom);
+// Adds len bytes starting at reg to the buffer, flushing pages as they fill up. Returns the bytes taken.
+uint16_t lcb16b_buffer_write(struct lcb16b_eeprom* my_eeprom, uint16_t reg, const uint8_t *src, uint16_t len);
+// Commits any pending bytes to the chip. Returns false if they could not be committed, they stay pending then.
+bool lcb16b_buffer_sync(struct lcb16b_eeprom* my_eeprom);
+// Commits pending bytes if they have been waiting longer than LCB16B_WRITE_BUFFER_TIMEOUT. Call this periodically.
+void lcb16b_buffer_poll(struct lcb16b_eeprom* my_eeprom);
+// Copies pending bytes over a freshly read dst buffer starting at reg
+void lcb16b_buffer_overlay(struct lcb16b_eeprom* my_eeprom, uint16_t reg, uint8_t *dst, uint16_t len);
+#endif
+
+// RAM mirror functions
+/*
+When LCB16B_MIRROR_ENABLE is set the whole chip is read into RAM on init, one sequential read per 256 byte block.
+random_read and point_read are then served with a memcpy and every write updates the mirror before it reaches the chip.
+*/
+#if LCB16B_MIRROR_ENABLE
+// Loads the full chip into the mirror
+void lcb16b_mirror_load(struct lcb16b_eeprom* my_eeprom);
+// Applies a write of len bytes starting at reg to the mirror
+void lcb16b_mirror_update(struct lcb16b_eeprom* my_eeprom, uint16_t reg, const uint8_t *src, uint16_t len);
+#endif
+
 // Wrappers to be executed by control protocols
 
 // Creates space in memory and assigns the src value to an 8-bit buffer
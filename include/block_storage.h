@@ -0,0 +1,94 @@
+#ifndef __BLOCK_STORAGE_H__
+#define __BLOCK_STORAGE_H__
+
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "dlog.h"
+
+/*
+Generic block storage interface used by anything that wants to persist data without caring where it ends up.
+
+A backend fills in a struct block_storage with its geometry and a table of operations:
+read: Reads len bytes starting at addr. Any alignment.
+program: Writes len bytes starting at addr. Has to be program_size aligned in both addr and len.
+         Backends with NOR semantics (flash) can only clear bits, so the range has to be erased first. They set needs_erase.
+erase: Sets len bytes starting at addr to erase_value. Has to be erase_size aligned in both addr and len.
+sync: Commits anything the backend still holds in RAM.
+
+Addresses are relative to the start of the region the backend exposes, [0, size).
+The block_storage_* wrappers check ranges and alignment before calling into the backend,
+so backends only have to deal with requests that make sense.
+
+The following backends are provided:
+eeprom: The 24LC16B, 2 KB. Uses the driver's mirror and write-back buffer. See block_storage_eeprom_init.
+flash: The unused tail of the RP2040 QSPI flash. 4 KB sector erase and 256 byte page program. See block_storage_flash_init.
+file: A file on the host, only built for host builds (PICO_ON_DEVICE == 0). Emulates NOR flash so host tests see the same rules.
+
+Every operation returns BLOCK_STORAGE_ERROR when the backend could not do it, a failed I2C transfer of the eeprom or
+a flash page that does not read back as programmed. The sample log (eeprom_log.h) is the user in this project.
+*/
+
+// Return codes
+#define BLOCK_STORAGE_OK 0
+#define BLOCK_STORAGE_ERROR -1 // Backend failed
+#define BLOCK_STORAGE_RANGE -2 // Request falls outside [0, size)
+#define BLOCK_STORAGE_ALIGN -3 // Request is not aligned to the program or erase size
+
+// Flash backend parameters
+#define BLOCK_STORAGE_FLASH_SIZE (_u(512) * 1024) // Bytes reserved at the end of flash. The firmware image must stay below PICO_FLASH_SIZE_BYTES - BLOCK_STORAGE_FLASH_SIZE.
+#define BLOCK_STORAGE_FLASH_OFFSET (PICO_FLASH_SIZE_BYTES - BLOCK_STORAGE_FLASH_SIZE) // Offset of the region from the start of flash
+
+#define BLOCK_STORAGE_DEBUG 0 // Flag to determine if USB debug statements should be printed.
+#define BLOCK_STORAGE_INFO 1 // Flag to determine if USB info statements should be printed.
+
+struct block_storage;
+
+// Operations a backend has to provide. Each returns one of the return codes above.
+struct block_storage_ops {
+    int (*read)(struct block_storage *storage, uint32_t addr, uint8_t *dst, uint32_t len);
+    int (*program)(struct block_storage *storage, uint32_t addr, const uint8_t *src, uint32_t len);
+    int (*erase)(struct block_storage *storage, uint32_t addr, uint32_t len);
+    int (*sync)(struct block_storage *storage);
+};
+
+// Storage model
+struct block_storage {
+    const struct block_storage_ops *ops;
+    const char *name; // Backend name, used for prints
+    uint32_t size; // Amount of bytes exposed
+    uint32_t program_size; // Program granularity in bytes
+    uint32_t erase_size; // Erase granularity in bytes
+    uint8_t erase_value; // Value erased bytes read back as
+    bool needs_erase; // A program can only clear bits, the range has to be erased before it is programmed again
+    void *ctx; // Backend specific state
+};
+
+// Main functions. These check the request and call into the backend.
+
+int block_storage_read(struct block_storage *storage, uint32_t addr, uint8_t *dst, uint32_t len);
+int block_storage_program(struct block_storage *storage, uint32_t addr, const uint8_t *src, uint32_t len);
+int block_storage_erase(struct block_storage *storage, uint32_t addr, uint32_t len);
+int block_storage_sync(struct block_storage *storage);
+
+// Backends
+
+// The 24LC16B. Exposes every register after the first page, the chip ID page is left alone.
+// Any byte can be programmed without an erase, erase works on single eeprom pages. Needs an initialized eeprom.
+struct lcb16b_eeprom;
+void block_storage_eeprom_init(struct block_storage *storage, struct lcb16b_eeprom *my_eeprom);
+
+// The last BLOCK_STORAGE_FLASH_SIZE bytes of the onboard flash.
+// Program and erase run from RAM with interrupts disabled. If core1 called multicore_lockout_victim_init it is paused as well.
+// Programmed pages are read back, a mismatch (usually a page that was not erased) returns BLOCK_STORAGE_ERROR.
+void block_storage_flash_init(struct block_storage *storage);
+
+#if !PICO_ON_DEVICE
+// A file of size bytes on the host. Created and erased if it does not exist yet.
+// Returns BLOCK_STORAGE_ERROR if the file can not be opened.
+int block_storage_file_init(struct block_storage *storage, const char *path, uint32_t size, uint32_t erase_size, uint32_t program_size);
+// Closes the file
+void block_storage_file_deinit(struct block_storage *storage);
+#endif
+
+#endif
@@ -3,7 +3,9 @@
 
 #include <stdio.h>
 #include <math.h>
-#include "bme280_i2c.h"
+#include "i2c_bus.h"
+#include "i2c_async.h"
+#include "seqlock.h"
 #include "com_protocol.h"
 
 /*
@@ -25,7 +27,12 @@ Similarly when a page is referenced the format is BME280_CIRCUIT_<Page_Number>
 
 This driver is meant to work on any micro controller using C.
 The driver communicates through I2C
-The bme280_i2c.h header file is meant to be a generic wrapper function where one puts in a board specific I2C implementation.
+All transfers go through the shared bus layer in i2c_bus.h using the bme280_i2c_device descriptor.
+A small comment on the I2C can be found at BME280_DOC_30.
+Of note "multiple byte write (using pairs of register addresses and register data)".
+Thus multiple address writing does not use an autoincremented target address and must be assigned each time.
+Further for reading " multiple byte read (using a single register address which is auto-incremented)".
+Thus a typical burst read is supported.
 The i2c_config.h header is meant to be a generic header where one defines I2C parameters and initialize functions specific to ones board.
 More information can be found in the header itself.
 
@@ -174,9 +181,13 @@ Selection is done based on BME_280_T_SB_MODE
 // Lookup array
 extern uint32_t bme280_t_sb_timing_array[8];
 
+//Bus descriptor of the chip
+extern struct i2c_device bme280_i2c_device;
+
 // Lazy debug modes
 #define BME_280_DEBUG_MODE 1 //Defines if debug print statements are enabled. 0 for False 1>= for True. This will give feedback on each operational step.
 #define BME_280_INFO_MODE 1 //Defines if INFO print statements are enabled. 0 for False 1>= for True. Info is for init feedback.
+#define BME_280_ASYNC_RETRIES _u(2) // Aborted async burst reads resubmitted in a row before giving up, a missing chip NACKs every one
 
 //Register locations
 //These can be obtained from BME280_DOC_22 and BME280_DOC_25 (shows a nice register map in the latter case)
@@ -323,18 +334,40 @@ struct bme280_measurements {
     uint32_t H; 
 };
 
+// State of the asynchronous burst read, see bme280_get_compensated_measurements_async
+struct bme280_async {
+    struct i2c_async_txn txn;
+    uint8_t reg; // Register the burst starts at
+    uint8_t raw[8]; // Filled by DMA, press, temp and hum registers
+    bool in_flight; // Has txn been submitted and not consumed yet
+    uint8_t retries; // Aborted reads resubmitted in a row
+};
+
 // Structure to store the current state of the chip
+// Compensated values of the last completed sample, published through a seqlock so either core can read them
+// while the next sample is compensated into measure. Read with bme280_read_sample.
+struct bme280_sample {
+    uint32_t time_us; // time_us_32 when it was published
+    int32_t T; // 0.01 C
+    uint32_t P;
+    uint32_t H; // 1/1024 %RH
+};
+
 struct bme280_model {
     struct bme280_calib_param *cal_params;
     struct bme280_settings *settings;
     struct bme280_measurements *measure;
     uint8_t chipID;
+    struct bme280_async async;
+    struct seqlock sample_lock;
+    struct bme280_sample sample; // Only through sample_lock
 };
 
 // Return values
 #define BME280_OK 0
 #define BME280_SLEEP 1
 #define BME280_BUSY 2
+#define BME280_FAILED 3 // The async burst read was aborted more than BME_280_ASYNC_RETRIES times in a row
 
 // Main functions
 
@@ -360,11 +393,34 @@ uint8_t bme280_start_measurements(struct bme280_model *my_chip);
 uint8_t bme280_get_uncompensated_measurements(struct bme280_model *my_chip); // This function is non blocking, depending one 
 void bme280_get_compensated_measurements_blocked(struct bme280_model *my_chip);
 uint8_t bme280_get_compensated_measurements_non_blocked(struct bme280_model *my_chip);
+/*
+Pipelined version built on the async I2C engine. Meant for normal mode where the chip keeps converting on its own.
+Each call that returns BME280_OK hands back a fresh sample and has already put the next burst read on the wire,
+so compensating one sample overlaps with reading the next. Returns BME280_BUSY while the read is still on the wire.
+An aborted read is resubmitted up to BME_280_ASYNC_RETRIES times, then BME280_FAILED is returned and the next call starts over.
+The burst read is protected by the data register shadowing (BME280_DOC_21), so the status register is not polled.
+The bme280 task of main uses it whenever the chip is in normal mode.
+*/
+uint8_t bme280_get_compensated_measurements_async(struct bme280_model *my_chip);
+// Copies the last published sample. Safe from either core, never waits. False if there is none yet.
+bool bme280_read_sample(struct bme280_model *my_chip, struct bme280_sample *sample);
+
+// Timing of one sample, used to work out the max sample rate
+// Max measurement time in us for the current oversampling settings, BME280_DOC_51
+uint32_t bme280_measurement_time_us(struct bme280_model *my_chip);
+// Time between the start of two samples in us. Normal mode adds the standby time, forced mode the bus traffic to start it.
+uint32_t bme280_sample_period_us(struct bme280_model *my_chip);
+// Theoretical time one sample occupies the bus in us. Forced mode includes the ctrl_meas write.
+uint32_t bme280_bus_time_us(struct bme280_model *my_chip);
 
 // Compensation functions. Formulae are found at BME280_DOC_23
 void bme280_compensate_temp(struct bme280_model *my_chip);
 void bme280_compensate_press(struct bme280_model *my_chip);
 void bme280_compensate_hum(struct bme280_model *my_chip);
+// All three on the adc values in measure, temperature first
+void bme280_compensate(struct bme280_model *my_chip);
+// Publishes the compensated values of measure stamped with time_us, for samples taken along with another sensor
+void bme280_publish_at(struct bme280_model *my_chip, uint32_t time_us);
 
 
 #endif
\ No newline at end of file
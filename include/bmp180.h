@@ -3,7 +3,8 @@
 
 #include <stdio.h>
 #include <math.h>
-#include "bmp180_i2c.h"
+#include "i2c_bus.h"
+#include "seqlock.h"
 #include "com_protocol.h"
 
 /* 
@@ -13,7 +14,7 @@ Whenever a specific page is being referenced the code will be BMP180_DOC_<page_n
 
 This driver is meant to work on any micro controller using C.
 The driver communicates through I2C
-The bmp180_i2c.h header file is meant to be a generic wrapper function where one puts in a board specific I2C implementation.
+All transfers go through the shared bus layer in i2c_bus.h using the bmp180_i2c_device descriptor.
 The i2c_config.h header is meant to be a generic header where one defines I2C parameters and initialize functions.
 More information can be found in the header itself.
 
@@ -150,11 +151,23 @@ struct bmp180_measurements{
      float p_relative;
 };
 
+//Final values of the last completed measurement. Published through a seqlock so either core can read them at any rate,
+//while bmp180_get_measurement is overwriting measurement_params. Read with bmp180_read_sample.
+struct bmp180_sample {
+    uint32_t time_us; // time_us_32 when it was published
+    int32_t T; // 0.1 C
+    int32_t p; // Pa
+    float altitude; // m, as of the last bmp180_get_altitude
+    float p_relative; // Pa, as of the last bmp180_get_sea_pressure
+};
+
 //Declare our chip model
 struct bmp180_model {
     struct bmp180_calib_param* cal_params;
     struct bmp180_measurements* measurement_params;
     uint8_t chipID;
+    struct seqlock sample_lock;
+    struct bmp180_sample sample; // Only through sample_lock
     // This is only for the com protocol. Feel free to leave this out :)
     #if BMP_180_COM_PROTO_ENABLE
     uint8_t m; // Assigns the value for the m argument
@@ -162,6 +175,9 @@ struct bmp180_model {
     #endif
 };
 
+//Bus descriptor of the chip
+extern struct i2c_device bmp180_i2c_device;
+
 //Mappings for the OSS mode of Pressure to variable input 
 extern uint16_t pressure_oss[4] ;
 //Mappings for out wait time in pressure mode
@@ -177,6 +193,15 @@ void bmp180_get_temp(struct bmp180_model* my_chip);
 
 void bmp180_get_up(struct bmp180_model* my_chip);
 void bmp180_get_pressure(struct bmp180_model* my_chip);
+
+// The steps of bmp180_get_ut and bmp180_get_up, so the conversion time can be spent on something else.
+// Start a conversion, wait at least the wait time, then read. Only one conversion can run at a time.
+void bmp180_start_ut(struct bmp180_model* my_chip);
+void bmp180_read_ut(struct bmp180_model* my_chip);
+uint32_t bmp180_ut_wait_us();
+void bmp180_start_up(struct bmp180_model* my_chip);
+void bmp180_read_up(struct bmp180_model* my_chip);
+uint32_t bmp180_up_wait_us();
 // Because in general get_pressure is always preluded by get_temperature when get_measurement is saved it does not call get_temp internally
 // Unfortunately if I want to add a function to com_proto to only get temp and or pressure I need to add this function wrapper
 void bmp180_get_temp_pressure(struct bmp180_model* my_chip);
@@ -184,9 +209,28 @@ void bmp180_get_temp_pressure(struct bmp180_model* my_chip);
 //Main wrapper to obtain measurements and average over :)
 void bmp180_get_measurement(struct bmp180_model* my_chip);
 
+// Compensation steps of bmp180_get_temp and bmp180_get_pressure, on the ut and up already in measurement_params.
+// Like those they add to T_sum and p_sum. The pressure needs B5 of the temperature.
+void bmp180_compensate_temp(struct bmp180_model* my_chip);
+void bmp180_compensate_pressure(struct bmp180_model* my_chip);
+// Compensates a single ut and up into T and p, without the averaging of bmp180_get_measurement
+void bmp180_compensate(struct bmp180_model* my_chip);
+// Publishes the values of measurement_params stamped with time_us, for samples taken along with another sensor
+void bmp180_publish_at(struct bmp180_model* my_chip, uint32_t time_us);
+
 // Get the altitude
 void bmp180_get_altitude(struct bmp180_model* my_chip);
+// Altitude in m for a pressure p in Pa, relative to BMP_180_SEA_PRESSURE
+float bmp180_altitude_from_pressure(long p);
 // Get relative sea pressure
 void bmp180_get_sea_pressure(struct bmp180_model* my_chip);
+// Copies the last published sample. Safe from either core, never waits. False if there is none yet.
+bool bmp180_read_sample(struct bmp180_model* my_chip, struct bmp180_sample* sample);
+
+// Timing of one bmp180_get_measurement, used to work out the max sample rate
+// Time spent waiting on conversions in us, BMP_180_SS times a temperature and a pressure conversion
+uint32_t bmp180_conversion_time_us(struct bmp180_model* my_chip);
+// Theoretical time the measurement occupies the bus in us
+uint32_t bmp180_bus_time_us(struct bmp180_model* my_chip);
 
 #endif
\ No newline at end of file
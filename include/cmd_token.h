@@ -0,0 +1,58 @@
+#ifndef __CMD_TOKEN_H__
+#define __CMD_TOKEN_H__
+// Tokenizer for the command lines com_protocol reads.
+
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+
+/*
+cmd_token_next walks a line once from left to right and hands back one token per call.
+Tokens are slices of the line (start and len), nothing is copied and the line is not modified,
+so a token is only valid while the line is.
+
+Tokens are split on spaces. Types:
+    CMD_TOKEN_WORD: Anything that is not one of the below. The command itself is a word.
+    CMD_TOKEN_SHORT_OPTS: -abc, the slice holds the option characters abc.
+    CMD_TOKEN_LONG_OPT: --name, the slice holds name.
+    CMD_TOKEN_INT: [+-]digits or [+-]0x hex digits. value holds the number.
+    CMD_TOKEN_FIXED: [+-]digits.digits. value holds the number times CMD_TOKEN_FIXED_SCALE,
+        digits past CMD_TOKEN_FIXED_DECIMALS are dropped. 21.5 gives 21500.
+    CMD_TOKEN_STRING: "some text", the slice holds the text without the quotes. There are no escapes.
+    CMD_TOKEN_ERROR: A number out of int32_t range or a quote that is not closed. The slice holds the offending text.
+
+A - followed by a digit starts a number and not an option, so -40 is the integer -40.
+value is only set for numbers.
+*/
+
+#define CMD_TOKEN_FIXED_DECIMALS _u(3) // Decimals kept in a fixed point value
+#define CMD_TOKEN_FIXED_SCALE 1000 // 10^CMD_TOKEN_FIXED_DECIMALS
+
+// Token types
+#define CMD_TOKEN_WORD _u(0)
+#define CMD_TOKEN_SHORT_OPTS _u(1)
+#define CMD_TOKEN_LONG_OPT _u(2)
+#define CMD_TOKEN_INT _u(3)
+#define CMD_TOKEN_FIXED _u(4)
+#define CMD_TOKEN_STRING _u(5)
+#define CMD_TOKEN_ERROR _u(6)
+
+// One token of a line
+struct cmd_token {
+    const char *start; // First character of the slice, not NUL terminated
+    uint16_t len; // Characters in the slice
+    uint8_t type; // One of CMD_TOKEN_*
+    int32_t value; // Number of CMD_TOKEN_INT and CMD_TOKEN_FIXED
+};
+
+// Main functions
+
+/*
+Reads the token at *cursor and moves *cursor past it. The line ends at end or at a NUL, whichever comes first.
+Returns false when only spaces are left.
+*/
+bool cmd_token_next(const char **cursor, const char *end, struct cmd_token *token);
+// Returns true if the slice of token equals the NUL terminated string str
+bool cmd_token_equals(const struct cmd_token *token, const char *str);
+
+#endif
@@ -0,0 +1,119 @@
+#ifndef __COM_BINARY_H__
+#define __COM_BINARY_H__
+// Binary framed mode of com_protocol, for host collectors.
+// This example is based off of the PICO SDK
+// Documentation can be found at https://raspberrypi.github.io/pico-sdk-doxygen/index.html
+
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/stdio.h"
+#include "pico/mutex.h"
+
+/*
+The text interface prints floats and parses whole lines, a host needs a few ms per sample on both ends,
+and a line cut in half leaves it guessing where the next one starts.
+The binary command of com_protocol switches the serial link to frames instead:
+
+    frame = COBS(payload, CRC16) 0x00
+    payload = type (1 byte), seq (1 byte), data
+
+COBS removes every 0x00 from the frame, so 0x00 only ever marks the end of one. A host that starts listening
+half way or loses bytes just waits for the next 0x00 and is back in sync. The CRC is CRC16-CCITT (0x1021, init 0xFFFF)
+over the payload, sent little endian. All numbers in data are little endian.
+
+Requests from the host carry a seq of its choice, the reply carries the same seq:
+    COM_BIN_MSG_PING -> COM_BIN_MSG_PONG
+    COM_BIN_MSG_CMD, data is a text command line. It goes through the same tokenizer and execute_bin as typed lines.
+        -> COM_BIN_MSG_RESULT, data is the int16 return value of execute_bin (index of the binary or a COM_PROTO_* error).
+    COM_BIN_MSG_EXIT -> COM_BIN_MSG_BYE, the link is back to text after it.
+A frame with a bad CRC, bad COBS or unknown type is answered by COM_BIN_MSG_ERROR with one of COM_BIN_ERR_*.
+
+Frames the pico sends on its own carry a seq that counts up by one, so a host can tell when it missed some:
+    COM_BIN_MSG_SAMPLE: sensor (1 byte), quantity (1 byte), time_us_32 when sampled (4 bytes), value (int32).
+        See COM_BIN_SENSOR_* and COM_BIN_Q_*. The stream command sends these at a fixed rate, see stream.h.
+    COM_BIN_MSG_TEXT: Everything printf'ed while in binary mode (help, errors, logs of either core), as raw text.
+While in binary mode all stdio output goes through com_binary, so text can never land inside a frame.
+*/
+
+#define COM_BIN_MAX_PAYLOAD _u(254) // Max payload bytes of a frame, type and seq included
+#define COM_BIN_MAX_FRAME (COM_BIN_MAX_PAYLOAD + _u(2) + _u(2) + _u(1)) // CRC, COBS overhead for up to 254 bytes and the delimiter
+#define COM_BIN_HEADER_LEN _u(2) // type and seq
+
+#define COM_BIN_INFO 1 // Flag to determine if entering and leaving binary mode should be printed.
+
+// Message types, host to pico
+#define COM_BIN_MSG_PING _u(0x01)
+#define COM_BIN_MSG_CMD _u(0x02)
+#define COM_BIN_MSG_EXIT _u(0x03)
+// Message types, pico to host
+#define COM_BIN_MSG_PONG _u(0x81)
+#define COM_BIN_MSG_RESULT _u(0x82)
+#define COM_BIN_MSG_BYE _u(0x83)
+#define COM_BIN_MSG_TEXT _u(0x90)
+#define COM_BIN_MSG_SAMPLE _u(0x91)
+#define COM_BIN_MSG_ERROR _u(0xff)
+
+// Codes of COM_BIN_MSG_ERROR
+#define COM_BIN_ERR_CRC _u(1)
+#define COM_BIN_ERR_COBS _u(2)
+#define COM_BIN_ERR_LENGTH _u(3) // Frame longer than COM_BIN_MAX_FRAME or shorter than a header and CRC
+#define COM_BIN_ERR_TYPE _u(4)
+
+// Sensors and quantities of COM_BIN_MSG_SAMPLE
+#define COM_BIN_SENSOR_BMP180 _u(1)
+#define COM_BIN_SENSOR_BME280 _u(2)
+#define COM_BIN_Q_TEMPERATURE _u(1) // 0.1 C from the BMP180, 0.01 C from the BME280
+#define COM_BIN_Q_PRESSURE _u(2) // Pa from the BMP180, 0.01 Pa from the BME280
+#define COM_BIN_Q_ALTITUDE _u(3) // mm
+#define COM_BIN_Q_SEA_PRESSURE _u(4) // Pa
+#define COM_BIN_Q_HUMIDITY _u(5) // 1/1024 %RH
+#define COM_BIN_Q_DEW_POINT _u(6) // 0.01 C, derived by the pipeline from the BME280
+
+#define COM_BIN_SAMPLE_LEN _u(10)
+
+// State of the binary link
+struct com_binary {
+    volatile bool active;
+    uint8_t tx_seq; // seq of the next frame sent on our own
+    mutex_t tx_mutex; // Frames from both cores go out whole
+    uint8_t tx_frame[COM_BIN_MAX_FRAME]; // Encoded frame, under tx_mutex
+    uint8_t rx_frame[COM_BIN_MAX_FRAME]; // Bytes received since the last 0x00, core1 only
+    uint16_t rx_len;
+    bool rx_overflow; // The frame being received is too long, drop it at its 0x00
+};
+
+// Main functions
+
+// Initializer. Call before either core prints in binary mode.
+void com_binary_init();
+// Switches the link to binary frames
+void com_binary_enter();
+// Switches the link back to text
+void com_binary_exit();
+bool com_binary_active();
+
+/*
+Takes one byte the host sent. Returns true once it completes a frame, with the payload (type, seq and data) in payload
+and its length in *len, payload must hold COM_BIN_MAX_PAYLOAD.
+Bad frames are answered with COM_BIN_MSG_ERROR here and not returned. Only call from core1.
+*/
+bool com_binary_feed(uint8_t byte, uint8_t *payload, uint16_t *len);
+// Sends one frame. len bytes of data follow type and seq. data may be NULL when len is 0.
+void com_binary_send(uint8_t type, uint8_t seq, const uint8_t *data, uint16_t len);
+// Sends a COM_BIN_MSG_SAMPLE taken at time_us
+void com_binary_send_sample(uint8_t sensor, uint8_t quantity, uint32_t time_us, int32_t value);
+
+// Helpers
+
+// CRC16-CCITT of len bytes
+uint16_t com_binary_crc16(const uint8_t *data, uint16_t len);
+// COBS encodes len bytes of src into dst, which must hold len + len / 254 + 1. Returns the encoded length.
+uint16_t com_binary_cobs_encode(const uint8_t *src, uint16_t len, uint8_t *dst);
+// COBS decodes len bytes of src, delimiter excluded, into dst. Returns the decoded length or -1 if src is not valid COBS.
+int com_binary_cobs_decode(const uint8_t *src, uint16_t len, uint8_t *dst);
+// Writes value little endian to dst and returns the byte after it
+uint8_t *com_binary_put_u16(uint8_t *dst, uint16_t value);
+uint8_t *com_binary_put_u32(uint8_t *dst, uint32_t value);
+
+#endif
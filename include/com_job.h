@@ -0,0 +1,151 @@
+#ifndef __COM_JOB_H__
+#define __COM_JOB_H__
+// Typed jobs for main and typed results for com_protocol.
+
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/util/queue.h"
+#include "com_protocol.h"
+#include "bmp180.h"
+#include "eeprom_log.h"
+#include "pipeline.h"
+#include "task_sched.h"
+
+/*
+Work crosses the cores as plain records, no function pointers are passed around.
+
+call_queue holds struct com_job: an opcode, the handle of the device or state it works on and its parameters.
+main hands every job to com_job_dispatch, which indexes com_job_handlers by the opcode.
+The handler does the work and queues what is to be printed to results_queue.
+
+results_queue holds struct com_result: a kind, the time it was produced and a payload.
+The payload is a copy of the values taken by main right after the measurement,
+so core1 prints what was measured even when main already runs the next job on the same device.
+Payloads come from a fixed pool of COM_JOB_POOL_LEN, handed out by main and given back by core1 after printing.
+When the pool is empty main waits for core1 to print, the same back pressure a full results_queue gives.
+core1 hands every result to com_result_route, which indexes com_result_routes by the kind
+and runs the text printer, or the binary sender if the link is in binary mode and the kind has one.
+
+Both lookups are a table index, adding a job or result is a new entry in the table.
+*/
+
+#define COM_JOB_POOL_LEN _u(16) // Payloads that can be waiting to be printed
+
+#define COM_JOB_DEBUG 0 // Flag to determine if USB debug statements should be printed.
+
+// Opcodes of struct com_job
+#define COM_JOB_BMP180_MEASURE _u(0) // handle: struct bmp180_model
+#define COM_JOB_BMP180_ALTITUDE _u(1) // handle: struct bmp180_model
+#define COM_JOB_BMP180_SEA_PRESSURE _u(2) // handle: struct bmp180_model
+#define COM_JOB_EEPROM_DUMP _u(3) // handle: struct lcb16b_eeprom
+#define COM_JOB_LOG_APPEND _u(4) // handle: struct eeprom_log, params.value
+#define COM_JOB_LOG_QUERY _u(5) // handle: struct eeprom_log, params.query
+#define COM_JOB_I2C_PROBE _u(6) // handle: struct i2c_probe
+#define COM_JOB_STREAM_START _u(7) // handle: struct stream
+#define COM_JOB_STREAM_STOP _u(8) // handle: struct stream
+#define COM_JOB_STREAM_SAMPLE _u(9) // handle: struct stream
+#define COM_JOB_PIPELINE_START _u(10) // handle: struct pipeline
+#define COM_JOB_PIPELINE_STOP _u(11) // handle: struct pipeline
+#define COM_JOB_PIPELINE_ACQUIRE _u(12) // handle: struct pipeline
+#define COM_JOB_PIPELINE_BENCH _u(13) // handle: struct pipeline, params.value samples per mode
+#define COM_JOB_SCHED_STATS _u(14) // handle: struct task_sched
+#define COM_JOB_SCHED_RESET _u(15) // handle: struct task_sched
+#define COM_JOB_SCHED_PERIOD _u(16) // handle: struct task_sched, params.task
+#define COM_N_JOB _u(17)
+
+// Flags of jobs and results
+#define COM_JOB_VERBOSE (1u << 0) // Print the intermediate steps as well
+
+// Kinds of struct com_result
+#define COM_RES_BMP180_MEASURE _u(0) // payload: bmp180, temperature and pressure
+#define COM_RES_BMP180_ALTITUDE _u(1) // payload: bmp180
+#define COM_RES_BMP180_SEA_PRESSURE _u(2) // payload: bmp180
+#define COM_RES_LOG_QUERY _u(3) // payload: log_query
+#define COM_RES_LOG_APPEND _u(4) // payload: log_append
+#define COM_RES_I2C_PROBE _u(5) // payload: probe
+#define COM_RES_PIPELINE_BENCH _u(6) // payload: pipe_bench
+#define COM_RES_SCHED_STATS _u(7) // payload: sched
+#define COM_N_RES _u(8)
+
+// Query window of COM_JOB_LOG_QUERY
+struct com_job_query {
+    uint32_t start; // Inclusive start of the window
+    uint32_t end; // Inclusive end of the window
+    bool aggregate; // Only report min, max and mean
+};
+
+// New period of a task of COM_JOB_SCHED_PERIOD
+struct com_job_task {
+    uint8_t index; // Of the task in the scheduler
+    uint32_t period_us; // 0 disables the task
+};
+
+// One piece of work for main
+struct com_job {
+    uint8_t op; // COM_JOB_*
+    uint8_t flags;
+    void *handle;
+    union {
+        uint32_t value;
+        struct com_job_query query;
+        struct com_job_task task;
+    } params;
+};
+
+// Copy of a log query
+struct com_log_query_payload {
+    struct eeprom_log_sample results[EEPROM_LOG_QUERY_MAX];
+    int status; // BLOCK_STORAGE_OK, or the error the storage gave while scanning
+    uint16_t n_results;
+    uint32_t n_matched;
+    uint32_t count;
+    bool aggregate;
+    uint32_t min;
+    uint32_t max;
+    uint32_t mean;
+};
+
+// Copy of a log append
+struct com_log_append_payload {
+    uint32_t value;
+    uint32_t count;
+    int status; // BLOCK_STORAGE_OK, or the error of the storage. Nothing was logged then.
+};
+
+// Values of one result, owned by it until com_result_route gives it back
+struct com_payload {
+    union {
+        struct bmp180_measurements bmp180;
+        struct com_log_query_payload log_query;
+        struct com_log_append_payload log_append;
+        struct i2c_probe probe;
+        struct pipeline_bench pipe_bench;
+        struct task_sched_snapshot sched;
+    };
+};
+
+// One thing for core1 to print
+struct com_result {
+    uint8_t kind; // COM_RES_*
+    uint8_t flags; // Copied from the job
+    uint32_t time_us; // time_us_32 when the values were taken
+    struct com_payload *payload;
+};
+
+// Main functions
+
+// Initializer. Call before either queue is used.
+void com_job_init();
+// Runs job. Only call from main.
+void com_job_dispatch(const struct com_job *job);
+// Prints or sends result and gives its payload back. Only call from core1.
+void com_result_route(const struct com_result *result);
+
+// Helpers
+
+// Takes a payload from the pool, waits for core1 if there is none
+struct com_payload *com_job_payload_alloc();
+void com_job_payload_free(struct com_payload *payload);
+
+#endif
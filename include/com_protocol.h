@@ -10,8 +10,13 @@
 #include "bmp180.h"
 #include "bme280.h"
 #include "24LC16B_EEPROM.h"
+#include "i2c_sched.h"
+#include "cmd_token.h"
+#include "com_binary.h"
 #include "pico/util/queue.h"
 #include "pico/multicore.h"
+#include "hardware/sync.h"
+#include "spsc_ring.h"
 #include "pico_rtc.h"
 
 // comprotocol needs to be made aware of structures main function would use
@@ -27,8 +32,8 @@ Add checks to keep cmd's arrays within max and min array indices.
 This will serve as the main interface to be used for general communication between the PICO and the outside world.
 This will be ran on core1 in a super loop.
 The general principle will be that it will read in some input, based on that make a decision as to what needs to be executed by main.
-The function will be passed to main via FIFO as well as the needed structure.
-Main will execute what is needed and pass the output print function and the main structure back to com_protcol to be print.
+The work will be passed to main via FIFO as a typed job, an opcode with the needed structure and parameters.
+Main will execute what is needed and pass a result with a copy of the values back to com_protcol to be print. See com_job.h.
 In this header there will be compile flags that decide what communication method the main TX and RX functions will be using.
 
 Further DEBUG as defined in each driver will always depend on USB and will not pass instructions to core1.
@@ -51,6 +56,12 @@ For argument values this holds :
 <command> -ar 40 60 -> Executes command with argument a which has an input value of 40. And argument r with input 60.
 <command> -a 40 -r 60 -> Executes command with argument a which has an input value of 40. And argument r with input 60.
 
+A line is split into tokens by cmd_token_next in one pass, see cmd_token.h. Values may be signed (-40), hex (0x28),
+fixed point (21.5) or quoted strings ("two words"). Nothing is copied, struct cmd points into the RX buffer.
+Options can also be given long, prefixed with --. Each binary maps its long names to its option characters
+in its bin_executable entry, so bmp180 --measure 3 is bmp180 -m 3.
+A line with more than COM_PROTO_ARG_ARRAY_SIZE options or values, a bad value or an unknown long option is refused as a whole.
+
 On default if no option is given the help function will be printed.
 
 NB as a word of caution, specific trumps general. The examples are the general case one would find and describes 
@@ -62,15 +73,26 @@ The default help will also give the user a nudge.
 The following will document the commands that can be sent to the pico.
 
 help: Provides a basic list of key commands that can be sent.
+bmp180: Samples the BMP180. See print_help_bmp180_help.
+eeprom: Inspects the 24LC16B eeprom. See print_help_eeprom_help.
+log: Appends to and queries the time stamped sample log on the eeprom. See print_help_log_help.
+i2c: Shows statistics of the shared I2C bus and captures transfer traces. See print_help_i2c_help.
+stream: Pushes sensor channels at a fixed rate until stopped. See print_help_stream_help.
+sched: Shows the jitter and deadline misses of the periodic tasks of main and sets the sensor rates. See print_help_sched_help.
+       main owns the tasks and registers sched at startup through com_protocol_register_bin.
+pipe: Acquires raw sensor values on core0 and compensates and filters them on core1, benchmarks the split. See print_help_pipe_help.
+binary: Switches the link to the binary framed protocol of com_binary.h. See print_help_binary_help.
 
 */
 
 #define USE_USB 1 // Will tinyUSB be used as the main communications?
-#define COM_PROTO_RX_WAIT _u(1000000) //Wait for COM_PROTO_RX_WAIT us for some buffer input
+#define COM_PROTO_RX_RING_SIZE _u(2048) // Bytes received but not yet read by core1. Power of 2.
+#define COM_PROTO_IDLE_WAKE_MS _u(100) // Longest core1 sleeps when idle, so driver logs still come out
 #define COM_PROTO_RX_BUFFER_SIZE _u(1024) // Buffer size for stdin
-#define COM_PROTO_ARG_ARRAY_SIZE _u(10) // How many arguments of str can I store at a time
+#define COM_PROTO_ARG_ARRAY_SIZE _u(32) // How many options and values a line can hold
 #define COM_PROTO_COMMAND_SIZE _u(100) //max char size of a given command
-#define COM_PROTO_N_BIN _u(2) // Defines how many 'binaries' we have defined
+#define COM_PROTO_N_BIN _u(8) // Defines how many 'binaries' are built into com_proto_bins
+#define COM_PROTO_N_RUNTIME_BIN _u(16) // Defines how many 'binaries' can be registered at startup
 #define COM_PROTO_QUEUE_LEN _u(15) // Defines how many entries can be in the queue
 
 // Some basic lazy debug log levels
@@ -80,77 +102,142 @@ help: Provides a basic list of key commands that can be sent.
 // For some user friendliness
 #define COM_PROTO_USER_FEEDBACK_SERIAL 1 // enable this to print stdin input to the serial terminal
 
+// Marks a long option in struct cmd args until execute_bin maps it to the option character of the binary
+#define COM_PROTO_LONG_ARG ((char) 0x7f)
+
 // Some error definitions
 #define COM_PROTO_NO_BIN -1
+#define COM_PROTO_BIN_EXISTS -2 // A binary with that name is already registered
+#define COM_PROTO_BIN_FULL -3 // No room left in the runtime registry
+#define COM_PROTO_BIN_BAD_NAME -4 // Name is empty, too long or contains a space
+#define COM_PROTO_BAD_ARG -5 // The binary has no such long option
+#define COM_PROTO_BAD_LINE -6 // The line could not be tokenized, see read_stdin_to_cmd
 
 // Main variables
 
+// The eeprom log header includes this header through the eeprom driver, so only declare what we point to
+struct eeprom_log;
+// The stream queues its ticks to main through the call queue and includes this header for it
+struct stream;
+// The pipeline does the same
+struct pipeline;
+struct pipeline_bench;
+// The scheduler of main, its statistics come back as a result
+struct task_sched;
+struct task_sched_snapshot;
+// Jobs and results are in com_job.h, which needs the eeprom log
+struct com_job;
+struct com_log_query_payload;
+struct com_log_append_payload;
+// The BMP180 header includes this header as well, its printers take copies of its values
+struct bmp180_measurements;
+struct bmp180_sample;
+
 // Declare a command structure
 struct cmd{
-    // Holds command
-    char command[COM_PROTO_COMMAND_SIZE];
+    // Holds command, a slice of the RX buffer
+    const char *command;
     // Holds command length
     uint8_t cmd_len;
     // Holds char arguments
     char args[COM_PROTO_ARG_ARRAY_SIZE];
+    // Name of a long option until it is mapped, at the same index as its COM_PROTO_LONG_ARG in args
+    struct cmd_token long_args[COM_PROTO_ARG_ARRAY_SIZE];
     // Holds amount of arguments
     uint8_t arg_len;
-    // Holds the integer arguments. The index of each corresponds to the index of the main arg.
+    // Holds the values. The index of each corresponds to the index of the main arg.
     // For example command 24lc16b -a 50 -w 100 would write 100 to address 50
-    uint32_t int_arg[COM_PROTO_ARG_ARRAY_SIZE];
-    // Holds current list of argument values, must be equal or smaller than arg_len
-    uint8_t int_arg_len;
-    // Temp array to help the integer value to be converted to integer (weird sentence)
-    uint8_t int_tmp[COM_PROTO_ARG_ARRAY_SIZE];
-    // Hold the n amount of numbers present
-    uint8_t int_tmp_len;
+    // values[i].value holds the number, values[i].type tells an integer from fixed point or a string
+    struct cmd_token values[COM_PROTO_ARG_ARRAY_SIZE];
+    // Holds current list of argument values
+    uint8_t value_len;
 
     // Here we declare the states of models that can be called. They are simple pointers
     struct bmp180_model* bmp_180;
+    struct bme280_model* bme_280;
     struct lcb16b_eeprom* eeprom;
+    struct eeprom_log* log;
+    struct i2c_bus* i2c;
+    struct stream* stream;
+    struct pipeline* pipeline;
+    struct task_sched* sched;
+};
+
+// Maps a long option of a binary to its option character
+struct cmd_long_opt {
+    const char *name;
+    char arg;
 };
 
 // Declare our executable binary structure
 typedef struct
 {
-    void *func;
-    char *bin_string;
+    void (*func)(struct cmd *);
+    const char *bin_string;
+    const struct cmd_long_opt *long_opts; // Long options of the binary, may be NULL
+    uint8_t n_long_opts;
 } bin_executable;
 
-// Declare a queue entry
-typedef struct
-{
-    void *func;
-    void *data;
-} queue_entry_t;
+/*
+Binaries live in two tables, both sorted by strcmp on bin_string so a command is found by binary search.
+com_proto_bins is const and thus stays in flash. New built in binaries are added to it in sorted order.
+The runtime registry is a fixed array in RAM for binaries added by drivers or applications at startup,
+kept sorted as com_protocol_register_bin inserts. No heap is used by either.
+A command only matches a binary whose name it equals exactly, "h" no longer runs help.
+*/
+
+// Chip ID reads of every device, run as one batch by the I2C scheduler (i2c -p)
+#define COM_PROTO_N_PROBES _u(3)
+#define COM_PROTO_PROBE_TIMEOUT_US _u(50000)
+
+struct i2c_probe {
+    struct i2c_async_txn txns[COM_PROTO_N_PROBES];
+    uint8_t regs[COM_PROTO_N_PROBES]; // Register written before the read
+    uint8_t ids[COM_PROTO_N_PROBES]; // Byte read back
+    int answer; // Return value of i2c_sched_run
+    uint32_t elapsed_us; // Time the whole batch took
+    bool busy; // Reads of a timed out batch were still queued, the engines own txns so nothing was run
+};
+
+/*
+USB reception is event driven. The stdio chars available callback runs in the USB task on core0 whenever data comes in,
+it moves everything tinyUSB holds into the RX ring and wakes core1 with an event (SEV) once a line end, Ctrl+C, Ctrl+X
+or a frame delimiter (0x00) is in. With COM_PROTO_USER_FEEDBACK_SERIAL every chunk wakes core1, so typing is echoed.
+core1 sleeps in WFE when it has nothing to do. Queue adds of main, the stream and the pipeline send an event too,
+so results go out as soon as they are in and not after an input timeout.
+The ring is an SPSC ring of bytes, the callback the producer and core1 the consumer.
+If the ring is full the bytes are dropped and counted by the ring.
+*/
+struct com_proto_rx {
+    struct spsc_ring ring;
+    uint8_t bytes[COM_PROTO_RX_RING_SIZE];
+};
 
 // Define our queues to be used
 
-// com_protocol will add the needed entry to be used by main
+// com_protocol will add the needed struct com_job to be used by main
 extern queue_t call_queue;
-// Here results are added by main to be printed by com_protocol
+// Here struct com_result are added by main to be printed by com_protocol
 extern queue_t results_queue;
 
 // Define helpers
 
-// Increments some value within a defined space
-uint16_t safe_increment(uint16_t input, uint16_t max);
-
-// Calculate powers of 10
-uint16_t pow_10(uint8_t exponent);
-
-// Reads characters to buffer
+// Reads characters to buffer. Returns the length of a finished line, 0 while it is still coming in.
 uint16_t read_stdin(char *buffer);
-// Read characters to buffer based on the USB interface
+// Read characters to buffer based on the USB interface. Takes what is in the RX ring without waiting.
 uint16_t read_stdin_usb(char *buffer);
+// Returns the next byte of the RX ring, or PICO_ERROR_TIMEOUT if it is empty
+int com_protocol_rx_getc();
 
-// Waits until the rx buffer is clean
+// Drops what is in the RX ring
 void clean_rx_buff();
 // Cleans the stdin buffer sent in as input
 void clean_stdin(char *buffer, uint16_t *len);
 
-// Reads string data and formats it into cmd terms
-void read_stdin_to_cmd(char *std_in, uint16_t *len, struct cmd* cmd_line);
+// Reads string data and formats it into cmd terms. Returns false, and says why, if the line can not be run.
+bool read_stdin_to_cmd(const char *std_in, uint16_t *len, struct cmd* cmd_line);
+// Sets *value to the value at index if there is one and it is an integer, else returns false
+bool cmd_value_int(struct cmd* cmd_line, uint8_t index, int32_t *value);
 // Cleans the cmd_line structure
 void clean_cmd_line(struct cmd* cmd_line);
 
@@ -160,16 +247,22 @@ void clean_cmd_line(struct cmd* cmd_line);
 void com_protocol_init();
 // Initializes the cmd_line structure
 void init_cmd_line(struct cmd* cmd_line);
-// Initializes the bin_executable structure
-void init_bin_executable(bin_executable *bin_array);
+/*
+Registers func as the binary bin_string. func takes a struct cmd* like the built in binaries.
+bin_string and long_opts are not copied, they have to outlive the program (string literals and a const table).
+Core1 reads the registry without locking, so only call this on core0 before com_protocol_init.
+Returns the index in the runtime registry, else COM_PROTO_BIN_EXISTS, COM_PROTO_BIN_FULL or COM_PROTO_BIN_BAD_NAME.
+*/
+int com_protocol_register_bin(void (*func)(struct cmd *), const char *bin_string, const struct cmd_long_opt *long_opts, uint8_t n_long_opts);
 
 /*
-Here we loop the bin_executable array until we find the bin to execute. 
-Then return with index in range [0,COM_PROTO_N_BIN).
-Else return with COM_PROTO_NO_BIN
+Here we search com_proto_bins and then the runtime registry for the bin to execute.
+Then return with index in range [0,COM_PROTO_N_BIN) for built in binaries
+and [COM_PROTO_N_BIN,COM_PROTO_N_BIN + COM_PROTO_N_RUNTIME_BIN) for registered ones.
+Else return with COM_PROTO_NO_BIN, or COM_PROTO_BAD_ARG if a long option is unknown to the binary
 */
 
-int execute_bin(struct cmd* cmd_line, bin_executable *bin_array);
+int execute_bin(struct cmd* cmd_line);
 
 // Main entry loop
 void com_protocol_entry();
@@ -188,28 +281,93 @@ void print_help_bin_help();
 void bmp180_bin(struct cmd* cmd_line);
 void print_help_bmp180_help();
 void bmp180_error(char argument);
-void bmp180_inter_m(queue_entry_t *entry_queue, uint8_t *entry_len, struct cmd* cmd_line, uint8_t index);
+void bmp180_inter_m(struct com_job *entry_queue, uint8_t *entry_len, struct cmd* cmd_line, uint8_t index);
 
+void eeprom_bin(struct cmd* cmd_line);
+void print_help_eeprom_help();
+void eeprom_error(char argument);
+
+void log_bin(struct cmd* cmd_line);
+void print_help_log_help();
+void log_error(char argument);
+
+void i2c_bin(struct cmd* cmd_line);
+void print_help_i2c_help();
+void i2c_error(char argument);
+
+void stream_bin(struct cmd* cmd_line);
+void print_help_stream_help();
+void stream_error(char argument);
+
+void pipe_bin(struct cmd* cmd_line);
+void print_help_pipe_help();
+void pipe_error(char argument);
+
+// Long options of sched, main registers sched with them
+extern const struct cmd_long_opt sched_long_opts[];
+#define SCHED_N_LONG_OPTS _u(6)
+void sched_bin(struct cmd* cmd_line);
+void print_help_sched_help();
+void sched_error(char argument);
+
+// Unlike the others binary does its job without options, -h prints the help
+void binary_bin(struct cmd* cmd_line);
+void print_help_binary_help();
+void binary_error(char argument);
+// Serves one frame of the host while in binary mode. Called by the main loop of core1 in place of reading a line.
+void com_protocol_binary_step(struct cmd* cmd_line);
 
-/*
-We need some output selector
-*/
-int stdout_selector(void *func_pointer);
 
 // Define printing functions here
 
 // Printing functions for the BMP180
 
-void print_temp_results_bmp180(struct bmp180_model* my_chip);
-void print_press_results_bmp180(struct bmp180_model* my_chip);
-void print_altitude_results_bmp180(struct bmp180_model* my_chip);
-void print_relative_pressure_results_bmp180(struct bmp180_model* my_chip);
+// These print a copy of the measurements, see com_job.h. v set prints the intermediate steps as well.
+void print_temp_results_bmp180(const struct bmp180_measurements* measure, uint8_t v);
+void print_press_results_bmp180(const struct bmp180_measurements* measure, uint8_t v);
+void print_altitude_results_bmp180(const struct bmp180_measurements* measure);
+void print_relative_pressure_results_bmp180(const struct bmp180_measurements* measure);
+// Prints a sample read through bmp180_read_sample
+void print_sample_bmp180(const struct bmp180_sample* sample);
 void print_chip_ID_bmp180(struct bmp180_model* my_chip);
 void print_cal_params_bmp180(struct bmp180_model* my_chip);
 
 // Printing functions for the 24LC16B
 
 void print_eeprom_chip_ID(struct lcb16b_eeprom* my_eeprom);
+// Sink for lcb16b_eeprom_stream_read that prints the data as a hex dump
+void print_eeprom_dump_chunk(uint16_t reg, const uint8_t *data, uint16_t len, void *ctx);
+
+// Printing functions for the eeprom log
+
+void print_eeprom_log_query_results(const struct com_log_query_payload* query);
+void print_eeprom_log_append_results(const struct com_log_append_payload* append);
+
+// Printing functions for the I2C bus
+
+void print_i2c_bus_wait_stats(struct i2c_bus* bus);
+// Prints a snapshot of the per address statistics and the occupancy. Briefly takes the bus to copy them.
+void print_i2c_bus_stats(struct i2c_bus* bus);
+// Prints and empties the trace ring of bus in the format i2c_replay.c reads
+void print_i2c_trace(struct i2c_bus* bus);
+// Runs the probe batch. Queued to main since it drives the bus engines.
+void i2c_probe_chips(struct i2c_probe* probe);
+void print_i2c_probe_results(const struct i2c_probe* probe);
+// Prints the max sample rate the current sensor settings allow, from conversion times and theoretical bus time
+void print_sensor_max_sample_rates(struct bmp180_model* bmp_180, struct bme280_model* bme_280);
+
+// Printing functions for the stream
+
+void print_stream_status(struct stream* stream);
+
+// Printing functions for the pipeline
+
+void print_pipeline_status(struct pipeline* pipe);
+void print_pipeline_bench_results(const struct pipeline_bench* bench);
+
+// Printing functions for the scheduler
+
+void print_sched_stats(const struct task_sched_snapshot* snapshot);
 
 // Printing functions for the BME280
 
@@ -0,0 +1,92 @@
+#ifndef __DLOG_H__
+#define __DLOG_H__
+// Deferred, leveled logging for hot paths.
+
+#include <stdio.h>
+#include <stdint.h>
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+#include "spsc_ring.h"
+
+/*
+A printf over USB CDC can block for milliseconds, which is far too long inside a measurement or write loop,
+and it is not safe at all in an interrupt.
+DLOG_DEBUG/INFO/WARN/ERROR take the same format string and arguments as printf, but only store a compact binary record:
+the time, the level, the address of the format string (it stays in flash) and up to DLOG_MAX_ARGS arguments.
+Core1 formats and prints the records later from com_protocol's loop with dlog_drain.
+
+Each core writes to its own ring, so the cores never share a write index and no lock is needed between them.
+Interrupts on the writing core are held off for the few instructions it takes to fill a slot, so logging from an interrupt handler is fine.
+A full ring drops the record and counts it, logging never waits.
+
+Rules:
+Arguments are stored as integers. %d, %u, %x, %c and %s of a string that lives forever (literals, device names) work.
+No floats and no strings on the stack, they are gone by the time the record is printed.
+Levels below DLOG_LEVEL compile out entirely. The per module flags (LCB16B_DEBUG, BME_280_DEBUG_MODE, ...) still apply on top.
+*/
+
+#define DLOG_LEVEL_DEBUG 0
+#define DLOG_LEVEL_INFO 1
+#define DLOG_LEVEL_WARN 2
+#define DLOG_LEVEL_ERROR 3
+#define DLOG_LEVEL_NONE 4
+
+#define DLOG_LEVEL DLOG_LEVEL_INFO // Records below this level are compiled out. DLOG_LEVEL_DEBUG logs every bus transfer and status poll.
+#define DLOG_MAX_ARGS _u(4) // Arguments stored per record
+#define DLOG_RING_LEN _u(64) // Records per core, has to be a power of 2
+#define DLOG_DRAIN_MAX _u(16) // Records com_protocol prints per loop, so logging can not starve the command line
+
+// One log call
+struct dlog_record {
+    uint32_t time_us; // time_us_32 when it was logged
+    const char *fmt; // Format string. Its address doubles as the format id.
+    uint8_t level;
+    uint8_t n_args;
+    uintptr_t args[DLOG_MAX_ARGS];
+};
+
+// Ring of one core. The owning core is the producer, the drain the consumer.
+struct dlog_ring {
+    struct spsc_ring ring; // Of struct dlog_record, counts the records lost to a full ring
+    uint32_t reported; // dropped at the time of the last drop report
+};
+
+// Main functions
+
+// Stores a record in the ring of the calling core. Use the DLOG_* macros instead.
+void dlog_write(uint8_t level, const char *fmt, const uintptr_t *args, uint8_t n_args);
+// Prints up to max records from both rings. Only one core may drain.
+uint32_t dlog_drain(uint32_t max);
+
+// Stores the arguments in an array to count them, the leading 0 allows calls without arguments
+#define DLOG_AT(level, fmt, ...) do { \
+        const uintptr_t dlog_args[] = {0, ##__VA_ARGS__}; \
+        _Static_assert((sizeof(dlog_args) / sizeof(uintptr_t)) - 1 <= DLOG_MAX_ARGS, "Too many arguments for a log record"); \
+        dlog_write((level), (fmt), dlog_args + 1, (sizeof(dlog_args) / sizeof(uintptr_t)) - 1); \
+    } while (0)
+
+#if DLOG_LEVEL <= DLOG_LEVEL_DEBUG
+#define DLOG_DEBUG(fmt, ...) DLOG_AT(DLOG_LEVEL_DEBUG, fmt, ##__VA_ARGS__)
+#else
+#define DLOG_DEBUG(fmt, ...) do {} while (0)
+#endif
+
+#if DLOG_LEVEL <= DLOG_LEVEL_INFO
+#define DLOG_INFO(fmt, ...) DLOG_AT(DLOG_LEVEL_INFO, fmt, ##__VA_ARGS__)
+#else
+#define DLOG_INFO(fmt, ...) do {} while (0)
+#endif
+
+#if DLOG_LEVEL <= DLOG_LEVEL_WARN
+#define DLOG_WARN(fmt, ...) DLOG_AT(DLOG_LEVEL_WARN, fmt, ##__VA_ARGS__)
+#else
+#define DLOG_WARN(fmt, ...) do {} while (0)
+#endif
+
+#if DLOG_LEVEL <= DLOG_LEVEL_ERROR
+#define DLOG_ERROR(fmt, ...) DLOG_AT(DLOG_LEVEL_ERROR, fmt, ##__VA_ARGS__)
+#else
+#define DLOG_ERROR(fmt, ...) do {} while (0)
+#endif
+
+#endif
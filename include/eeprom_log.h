@@ -0,0 +1,101 @@
+#ifndef __EEPROM_LOG_H__
+#define __EEPROM_LOG_H__
+
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "block_storage.h"
+
+/*
+Sample log kept on a block storage backend (see block_storage.h), the 24LC16B unless main picks the flash.
+
+Each sample is stored in the same 8 byte layout lcb16b_set_src produces with a time stamp:
+day, hour, minute, second, followed by the 32 bit value MSB first.
+Samples are written to fixed slots starting at address 0 of the storage and the log wraps around once the last slot is used.
+The eeprom backend leaves the chip ID page out, so it is never part of the log.
+
+Backends that need an erase before a program (flash) are handled by erasing a whole erase unit when the head enters it.
+The oldest records in that unit are lost then, so a full log on such a backend holds one erase unit less than its slots.
+A record smaller than the program size is written by reading the program unit, patching it and programming it again.
+Failures of the storage are returned to the caller, the log only moves on once a record is on the storage.
+
+Time stamps are converted to seconds since the start of the month (see eeprom_log_timestamp).
+This keeps the keys ordered as long as a log does not span a month boundary, the RTC only stores day, hour, min and sec in the log after all.
+
+To answer time window queries without reading the whole storage a sparse index is kept in RAM.
+The slots are split into EEPROM_LOG_INDEX_LEN equal runs, for every run it stores the time stamp of its first slot.
+The index is rebuilt from the storage at boot and kept up to date on every append.
+A query uses the index to find the run the window starts in and only scans forward from there.
+*/
+
+#define EEPROM_LOG_RECORD_SIZE _u(8) // day, hour, min, sec and a 32 bit value
+#define EEPROM_LOG_INDEX_LEN _u(32) // Runs of slots in the sparse index
+#define EEPROM_LOG_SCAN_CHUNK _u(256) // Bytes read at a time while scanning, a multiple of EEPROM_LOG_RECORD_SIZE
+#define EEPROM_LOG_MAX_PROGRAM _u(256) // Largest program size of a backend the log can write to
+#define EEPROM_LOG_QUERY_MAX _u(32) // Max amount of samples a query keeps to be printed. Aggregates always cover every match.
+#define EEPROM_LOG_NO_SLOT _u(0xFFFFFFFF) // Marks an index entry past the last slot
+
+#define EEPROM_LOG_DEBUG 0 // Flag to determine if USB debug statements should be printed.
+#define EEPROM_LOG_INFO 1 // Flag to determine if USB info statements should be printed.
+
+// A single decoded sample
+struct eeprom_log_sample {
+    uint32_t timestamp; // Seconds since the start of the month
+    uint32_t value;
+};
+
+// Sparse index entry, one per run of slots
+struct eeprom_log_index_entry {
+    uint32_t first_slot; // First slot of the run
+    uint32_t first_ts; // Time stamp stored at first_slot
+    bool valid; // Does first_slot hold a record
+};
+
+// Log model
+struct eeprom_log {
+    struct block_storage *storage;
+    uint32_t n_slots; // Records that fit, in whole erase units
+    uint32_t program_slots; // Slots per program unit, a record smaller than the program size shares it with its neighbours
+    uint32_t erase_slots; // Slots per erase unit, 0 if the storage needs no erase
+    uint32_t index_slots; // Slots per index entry
+    struct eeprom_log_index_entry index[EEPROM_LOG_INDEX_LEN];
+    uint32_t head; // Next slot to be written
+    uint32_t count; // Amount of valid records, at most n_slots
+
+    // Query parameters. Set by the com protocol before the query is queued.
+    uint32_t q_start; // Inclusive start of the window
+    uint32_t q_end; // Inclusive end of the window
+    bool q_aggregate; // Only report min, max and mean
+    uint32_t q_value; // Value the com protocol asked to append
+
+    // Query results
+    struct eeprom_log_sample results[EEPROM_LOG_QUERY_MAX];
+    uint16_t n_results; // Samples stored in results
+    uint32_t n_matched; // Samples inside the window, may be more than n_results
+    uint32_t min;
+    uint32_t max;
+    uint32_t mean;
+};
+
+// Helpers
+
+// Converts a day, hour, minute and second to the key used by the log
+uint32_t eeprom_log_timestamp(uint8_t day, uint8_t hour, uint8_t min, uint8_t sec);
+// Converts a ddhhmmss decimal number (as typed in the terminal) to the key used by the log
+uint32_t eeprom_log_timestamp_from_ddhhmmss(uint32_t ddhhmmss);
+// Returns the storage address of a slot
+uint32_t eeprom_log_slot_address(uint32_t slot);
+
+// Main functions. All return BLOCK_STORAGE_OK or the error of the storage.
+
+// Initializes the log on storage and builds the index from it.
+// Returns BLOCK_STORAGE_ALIGN if the program or erase size of the storage does not fit the records.
+int eeprom_log_init(struct eeprom_log *log, struct block_storage *storage);
+// Scans the storage and rebuilds the sparse index, head and count
+int eeprom_log_rebuild_index(struct eeprom_log *log);
+// Appends value with a time stamp from eeprom_log_timestamp. Nothing changes if the storage fails.
+int eeprom_log_append(struct eeprom_log *log, uint32_t timestamp, uint32_t value);
+// Finds all samples in [q_start, q_end] and fills in the results and aggregates
+int eeprom_log_query(struct eeprom_log *log);
+
+#endif
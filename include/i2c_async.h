@@ -0,0 +1,111 @@
+#ifndef __I2C_ASYNC_H__
+#define __I2C_ASYNC_H__
+// Asynchronous I2C transaction engine built on top of the shared bus layer.
+// This example is based off of the PICO SDK
+// Documentation can be found at https://raspberrypi.github.io/pico-sdk-doxygen/index.html
+
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/i2c.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+#include "i2c_bus.h"
+
+/*
+The blocking i2c_bus_* functions keep the calling core busy for the entire transfer.
+At 200 kHz a single byte takes 45 us on the wire, so a 26 byte read holds the core for more than a millisecond.
+
+Here a transaction is described by a struct i2c_async_txn and queued with i2c_async_submit.
+The engine then runs it without the CPU:
+1) The RP2040 I2C controller takes 16 bit command words in IC_DATA_CMD (RP2040 datasheet 4.3.10).
+   Besides the data byte they hold a read bit, a RESTART bit and a STOP bit.
+   The engine turns the transaction into a single stream of command words:
+   write bytes, then one read command per byte to receive, the first read with RESTART and the last word with STOP.
+2) One DMA channel feeds the command words to the TX FIFO, another drains the RX FIFO into the caller's buffer.
+   Both are paced by the I2C DREQs.
+3) The I2C interrupt fires on STOP_DET (transaction done) or TX_ABRT (NACK, lost arbitration).
+   The handler finishes the transaction, fires its callback and starts the next one in the queue.
+4) Every transaction gets I2C_ASYNC_TIMEOUT_US from its start on the wire. A slave stretching SCL forever or a STOP_DET
+   that never comes would otherwise keep the bus owned for good. When the alarm fires first the engine stops both
+   DMA channels, clears the bus with i2c_bus_recover, finishes the transaction as aborted and moves on.
+
+Rules:
+The descriptor and its buffers belong to the engine until status leaves I2C_ASYNC_PENDING. Do not touch them before then.
+Callbacks run in interrupt context, keep them short and do not submit from them.
+The engine takes bus ownership (i2c_bus_acquire) when the first transaction is submitted and releases it
+once the queue runs dry, so blocking i2c_bus_* calls from either core simply wait their turn.
+Only one bus is handled, the one passed to i2c_async_init. Submit from one core only.
+The PIO bus (i2c_pio.h) runs the same descriptors with its own engine. To submit without caring which bus a device
+is on use dev->bus->ops->submit, or i2c_sched.h to run a batch across buses.
+*/
+
+#define I2C_ASYNC_QUEUE_LEN _u(8) // Max amount of queued transactions, including the one on the wire
+#define I2C_ASYNC_MAX_TX _u(17) // Max bytes written per transaction. A register address and a 24LC16B page.
+#define I2C_ASYNC_MAX_RX _u(32) // Max bytes read per transaction
+#define I2C_ASYNC_TIMEOUT_US _u(10000) // Deadline of one transaction on the wire, the longest takes about 5 ms at 100 kHz
+
+#define I2C_ASYNC_DEBUG 0 // Flag to determine if USB debug statements should be logged. Logging happens in interrupt context, see dlog.h.
+#define I2C_ASYNC_INFO 1 // Flag to determine if USB info statements should be printed.
+#define I2C_ASYNC_ERROR 1 // Flag to determine if USB error statements should be logged.
+
+// Return codes of i2c_async_submit
+#define I2C_ASYNC_OK 0
+#define I2C_ASYNC_FULL -1 // Queue is full, try again later
+#define I2C_ASYNC_INVALID -2 // Transaction is larger than the engine supports or empty
+
+// Transaction states
+#define I2C_ASYNC_PENDING 0 // Queued or on the wire
+#define I2C_ASYNC_DONE 1 // Finished, rx holds the data
+#define I2C_ASYNC_ABORTED 2 // The controller aborted, see abort_source. 0 if it ran past I2C_ASYNC_TIMEOUT_US.
+
+struct i2c_async_txn;
+
+// Completion callback. Runs in the I2C interrupt.
+typedef void (*i2c_async_callback_t)(struct i2c_async_txn *txn);
+
+// Transaction descriptor
+struct i2c_async_txn {
+    const struct i2c_device *dev; // Target, must be on the engine's bus
+    const uint8_t *tx; // Bytes to write first, for example the register address
+    uint8_t tx_len; // Can be 0 for a plain read
+    uint8_t *rx; // Buffer for the bytes read after a repeated start
+    uint8_t rx_len; // Can be 0 for a plain write
+    i2c_async_callback_t callback; // Can be NULL
+    void *ctx; // Free for the caller
+    volatile int status; // One of the transaction states
+    uint32_t abort_source; // Copy of IC_TX_ABRT_SOURCE if aborted
+};
+
+// Engine state
+struct i2c_async_engine {
+    struct i2c_bus *bus;
+    int tx_chan; // DMA channel feeding IC_DATA_CMD
+    int rx_chan; // DMA channel draining IC_DATA_CMD
+    uint32_t cmd[I2C_ASYNC_MAX_TX + I2C_ASYNC_MAX_RX]; // Command words of the transaction on the wire
+    struct i2c_async_txn *queue[I2C_ASYNC_QUEUE_LEN]; // Ring of queued transactions
+    uint8_t head; // Next transaction to start
+    volatile uint8_t count; // Queued transactions, the one on the wire included
+    struct i2c_async_txn *active; // Transaction on the wire, NULL when idle
+    bool aborted; // Set by TX_ABRT, the transaction finishes on the STOP that follows
+    uint32_t start_us; // time_us_32 at which the active transaction started, for the bus statistics
+    volatile bool owns_bus; // Has the engine acquired the bus for the current batch of transactions
+    alarm_id_t alarm; // Deadline of the active transaction, 0 if none is set
+    uint32_t seq; // Counts started transactions, tells the alarm of the active one from a stale one
+};
+
+// Main functions
+
+// Claims the DMA channels and installs the interrupt handler for bus
+void i2c_async_init(struct i2c_bus *bus);
+// Queues txn. Starts it immediately if the bus is idle.
+int i2c_async_submit(struct i2c_async_txn *txn);
+// Returns true when nothing is queued or on the wire
+bool i2c_async_idle();
+// Blocks until every queued transaction is done
+void i2c_async_wait_idle();
+// Adds a finished transaction to the statistics and trace of its bus. For engines, the caller has to own the bus.
+void i2c_async_record(struct i2c_async_txn *txn, bool aborted, uint32_t start_us, uint32_t end_us);
+
+#endif
@@ -0,0 +1,176 @@
+#ifndef __I2C_BUS_H__
+#define __I2C_BUS_H__
+// Single I2C bus layer shared by every driver.
+// This example is based off of the PICO SDK
+// Documentation can be found at https://raspberrypi.github.io/pico-sdk-doxygen/index.html
+
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+#include "i2c_config.h"
+#include "dlog.h"
+#include "i2c_stats.h"
+#include "i2c_trace.h"
+#if !PICO_ON_DEVICE
+#include "i2c_replay.h"
+#endif
+
+/*
+Every transfer on the bus goes through here, so batching, timing and statistics only have to be added in one place.
+
+A bus (struct i2c_bus) describes a controller and its pins.
+The controller is reached through struct i2c_bus_ops, so the same layer drives the RP2040 I2C blocks (i2c_bus0)
+and the PIO master in i2c_pio.h (i2c_bus1). Drivers do not see the difference.
+A device (struct i2c_device) describes one 7-bit address on a bus and a name for prints.
+Each driver owns the descriptors of its own chip, for example bmp180_i2c_device in bmp180.c.
+Chips that answer on more than one address (the 24LC16B block select) get one descriptor per address.
+
+Return values follow the pico SDK, the amount of bytes transferred, PICO_ERROR_GENERIC (NACK) or PICO_ERROR_TIMEOUT.
+All functions block until the transfer is done. Only the time on the wire is bounded by their deadline:
+The plain functions use I2C_BUS_DEFAULT_TIMEOUT_US, the _timeout_us and _until variants take their own.
+A failed attempt is retried up to the device's retry budget as long as the deadline has not passed.
+After a timeout the bus is cleared with i2c_bus_recover before the next attempt, a stuck slave would otherwise keep failing it.
+The relative deadlines (plain and _timeout_us) start once the bus is owned, they cover the transfer and not the wait for ownership.
+An absolute deadline (_until) is a point in time, the wait for ownership counts against it.
+If it passed before the bus was owned the transfer returns PICO_ERROR_TIMEOUT without touching the bus and without a recovery.
+The wait for ownership itself has no bound, a ticket can not be given back. It ends when every owner ahead lets go:
+a blocking transfer after its deadline and a recovery, the engines after I2C_ASYNC_TIMEOUT_US per queued transaction.
+An engine that is fed new transactions while it owns the bus keeps it until its queue runs dry.
+
+Each device may run faster than the bus default. The controller is switched to the device's max_baudrate
+right before its transaction, so slow devices on the same bus keep working at the bus default. Transfers that do not need the core can use the async engine in i2c_async.h.
+
+Both cores may use the bus. Ownership is handed out with a ticket lock:
+A hardware spinlock guards the two ticket counters, so taking a ticket is atomic across cores.
+Tickets are served in the order they were taken, so neither core can starve the other.
+While waiting a core sleeps in WFE, the owner sends an event (SEV) when it lets go.
+The time each core spent waiting for the bus is kept as a metric, see struct i2c_bus_wait_stats.
+Every attempt is also recorded in the bus' transaction statistics, see i2c_stats.h.
+While a capture runs every transfer is appended to the bus' trace, see i2c_trace.h.
+In a host build (PICO_PLATFORM=host) there is no controller, transfers are served from a captured trace by i2c_replay.h.
+The host build only has the bus layer, there is no async engine and no PIO bus (submit is NULL). See CMakeLists.txt.
+Every i2c_bus_* transfer takes and releases the bus itself. i2c_bus_write_read holds it across the repeated start.
+i2c_bus_acquire/i2c_bus_release are meant for layers that drive the controller themselves, like the async engine.
+They are not reentrant, so do not call the i2c_bus_* transfers while owning the bus.
+
+One should put any board specific I2C implementation in i2c_bus.c and any board specific constants in i2c_config.h.
+*/
+
+#define I2C_BUS_MAX_WRITE _u(32) // Max data bytes i2c_bus_reg_write sends after the register address
+#define I2C_BUS_N_CORES _u(2) // Wait statistics are kept per core
+#define I2C_BUS_DEFAULT_TIMEOUT_US _u(50000) // Deadline of the plain transfers. A 256 byte read at 200 kHz takes about 12 ms.
+#define I2C_BUS_DEFAULT_RETRIES _u(2) // Retry budget used by the driver descriptors
+#define I2C_BUS_RECOVERY_CLOCKS _u(9) // SCL pulses sent to free a stuck slave
+#define I2C_BUS_RECOVERY_HALF_PERIOD_US _u(5) // Half period of the recovery clock, 100 kHz
+
+#define I2C_BUS_DEBUG 0 // Flag to determine if every transfer should be logged, see dlog.h.
+#define I2C_BUS_ERROR 1 // Flag to determine if failed transfers should be logged, see dlog.h.
+
+// Time a core spent waiting for bus ownership
+struct i2c_bus_wait_stats {
+    uint32_t acquisitions; // Times the bus was taken
+    uint32_t contended; // Times the bus was owned by someone else when asked for
+    uint64_t total_wait_us; // Sum of all waits
+    uint32_t max_wait_us; // Longest single wait
+};
+
+struct i2c_bus;
+struct i2c_async_txn;
+
+// Controller behind a bus. The transfers follow the SDK's i2c_*_blocking_until return values.
+struct i2c_bus_ops {
+    void (*init)(struct i2c_bus *bus); // Sets up the controller and the pins at current_baudrate. Also called after a recovery.
+    void (*set_baudrate)(struct i2c_bus *bus, uint32_t baudrate); // Only called between transactions
+    int (*write)(struct i2c_bus *bus, uint8_t addr, const uint8_t *src, size_t len, bool nostop, absolute_time_t until);
+    int (*read)(struct i2c_bus *bus, uint8_t addr, uint8_t *dst, size_t len, bool nostop, absolute_time_t until);
+    int (*submit)(struct i2c_async_txn *txn); // Queues a transaction without blocking, see i2c_async.h for the rules
+};
+
+// Bus model
+struct i2c_bus {
+    const char *name; // Used in prints
+    const struct i2c_bus_ops *ops;
+    i2c_inst_t *port; // SDK instance of the controller, NULL if the bus is not on an I2C block
+    uint32_t baudrate; // Requested SCL frequency in Hz
+    uint8_t sda; // SDA GPIO
+    uint8_t scl; // SCL GPIO
+    uint32_t current_baudrate; // Rate the controller is set to right now
+    uint32_t recoveries; // Times the bus had to be cleared
+
+    // Ownership
+    spin_lock_t *lock; // Hardware spinlock guarding the tickets
+    volatile uint32_t next_ticket; // Ticket handed to the next core that asks
+    volatile uint32_t now_serving; // Ticket that currently owns the bus
+    struct i2c_bus_wait_stats wait[I2C_BUS_N_CORES]; // Indexed by core number
+
+    // Per address transaction statistics and occupancy
+    struct i2c_stats stats;
+    // Capture of every transfer, off until i2c_trace_start
+    struct i2c_trace trace;
+};
+
+// Device descriptor
+struct i2c_device {
+    struct i2c_bus *bus; // Bus the device sits on
+    uint8_t addr; // 7-bit address
+    const char *name; // Used in prints
+    uint32_t max_baudrate; // Fastest SCL frequency the device supports in Hz. 0 uses the bus default.
+    uint8_t retries; // Extra attempts after a failed transfer
+};
+
+// The bus every driver in this project uses by default. Configured from i2c_config.h.
+extern struct i2c_bus i2c_bus0;
+// Controller of the RP2040 I2C blocks
+extern const struct i2c_bus_ops i2c_bus_hw_ops;
+
+// Main functions
+
+// Initializes the controller and the pins of bus through its ops and claims its spinlock
+void i2c_bus_init(struct i2c_bus *bus);
+
+// Ownership. Blocks until the calling core owns the bus, however long the owners ahead take. Not reentrant, do not acquire twice.
+void i2c_bus_acquire(struct i2c_bus *bus);
+// Hands the bus to the next ticket. Safe to call from an interrupt.
+void i2c_bus_release(struct i2c_bus *bus);
+// Clears the wait statistics of both cores
+void i2c_bus_reset_wait_stats(struct i2c_bus *bus);
+
+// Switches the controller to the rate dev supports, if it is not running at it already. The caller has to own the bus.
+void i2c_bus_set_speed(const struct i2c_device *dev);
+// Frees a slave holding SDA low with 9 SCL clocks and a STOP, then sets the controller up again. The caller has to own the bus.
+void i2c_bus_recover(struct i2c_bus *bus);
+
+/*
+Raw transfers
+    Parameters:
+    dev – Device to talk to
+    src – Pointer to data to send
+    dst – Pointer to buffer to receive data
+    len – Length of data in bytes
+    nostop – If true, master retains control of the bus at the end of the transfer (no Stop is issued), and the next transfer will begin with a Restart rather than a Start.
+*/
+int i2c_bus_write(const struct i2c_device *dev, const uint8_t *src, size_t len, bool nostop);
+int i2c_bus_read(const struct i2c_device *dev, uint8_t *dst, size_t len, bool nostop);
+
+// Writes src and then reads dst_len bytes after a repeated start. The bus is released at the end.
+int i2c_bus_write_read(const struct i2c_device *dev, const uint8_t *src, size_t src_len, uint8_t *dst, size_t dst_len);
+
+// Same as above with a deadline relative to the moment the bus is owned
+int i2c_bus_write_timeout_us(const struct i2c_device *dev, const uint8_t *src, size_t len, bool nostop, uint32_t timeout_us);
+int i2c_bus_read_timeout_us(const struct i2c_device *dev, uint8_t *dst, size_t len, bool nostop, uint32_t timeout_us);
+int i2c_bus_write_read_timeout_us(const struct i2c_device *dev, const uint8_t *src, size_t src_len, uint8_t *dst, size_t dst_len, uint32_t timeout_us);
+
+// Same as above with an absolute deadline
+int i2c_bus_write_until(const struct i2c_device *dev, const uint8_t *src, size_t len, bool nostop, absolute_time_t until);
+int i2c_bus_read_until(const struct i2c_device *dev, uint8_t *dst, size_t len, bool nostop, absolute_time_t until);
+int i2c_bus_write_read_until(const struct i2c_device *dev, const uint8_t *src, size_t src_len, uint8_t *dst, size_t dst_len, absolute_time_t until);
+
+// Register helpers for chips with an 8-bit register pointer that auto increments
+
+// Reads len bytes starting at reg. Returns the bytes read.
+int i2c_bus_reg_read(const struct i2c_device *dev, uint8_t reg, uint8_t *dst, size_t len);
+// Writes reg followed by len bytes of src in one transfer. Returns the data bytes written.
+int i2c_bus_reg_write(const struct i2c_device *dev, uint8_t reg, const uint8_t *src, size_t len);
+
+#endif
@@ -6,17 +6,33 @@
 // Use your own if needed.
 
 #include <stdio.h>
-#include "hardware/i2c.h"
 #include "pico/stdlib.h"
+#if PICO_ON_DEVICE
+#include "hardware/i2c.h"
+#else
+typedef struct i2c_inst i2c_inst_t; //No I2C blocks in a host build, transfers are replayed. See i2c_replay.h
+#endif
 
 //I2C variables
+#if PICO_ON_DEVICE
 #define I2C_PORT i2c0
-#define I2C_BAUDRATE 200000 //200KHZ
+#else
+#define I2C_PORT NULL
+#endif
+#define I2C_BAUDRATE 200000 //200KHZ. Default for devices that do not state their own rate.
+#define I2C_FAST_MODE_BAUDRATE 400000 //400KHZ fast mode
 
 //GPIO Variables
 #define GPIO_I2C0_SDA 4
 #define GPIO_I2C0_SCL 5
 
+//PIO I2C bus variables. See i2c_pio.h
+#define I2C_PIO_INSTANCE pio0
+#define I2C_PIO_BAUDRATE 400000 //400KHZ. Default for devices on the PIO bus that do not state their own rate.
+#define GPIO_PIO_I2C_SDA 6
+#define GPIO_PIO_I2C_SCL 7 //Has to be GPIO_PIO_I2C_SDA + 1
+#define I2C_EEPROM_ON_PIO_BUS 0 //Move the 24LC16B to the PIO bus so its write cycles do not hold up the sensors. Only enable with the eeprom wired to the PIO pins.
+
 void global_i2c_init();
 
 #endif 
\ No newline at end of file
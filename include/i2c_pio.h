@@ -0,0 +1,97 @@
+#ifndef __I2C_PIO_H__
+#define __I2C_PIO_H__
+// Second I2C bus driven by a PIO state machine, behind the shared bus layer.
+// This example is based off of the PICO SDK
+// Documentation can be found at https://raspberrypi.github.io/pico-sdk-doxygen/index.html
+
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/pio.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/clocks.h"
+#include "i2c_config.h"
+#include "i2c_bus.h"
+#include "i2c_async.h"
+
+/*
+The shared bus i2c_bus0 runs every device in turn, so a 24LC16B page write or a long block read holds up the sensors.
+i2c_bus1 is a second, independent bus implemented in PIO (program in i2c_pio.pio) on GPIO_PIO_I2C_SDA/SCL.
+It plugs into the bus layer through struct i2c_bus_ops, so drivers use it by pointing their descriptor at it.
+Set I2C_EEPROM_ON_PIO_BUS in i2c_config.h to move the 24LC16B there.
+
+Every transfer is turned into one stream of 16-bit FIFO words (see the encoding in i2c_pio.pio):
+START or repeated start, the address, the data bytes, then STOP (or nothing if nostop) and a final PUSH.
+One DMA channel feeds the stream to the TX FIFO, another drains one RX byte per byte on the wire plus the PUSH.
+The transfer is over when the RX channel is done, the PUSH only arrives after the STOP.
+A NAK halts the state machine on its IRQ flag. The stream is then dropped, a STOP is sent and PICO_ERROR_GENERIC returned.
+
+Blocking transfers poll for the end. Transactions handed to i2c_pio_submit run in the background instead:
+The RX DMA interrupt (DMA_IRQ_1) finishes them. A NAK raises the PIO interrupt, which drops the stream and starts
+the STOP as a stream of its own, the DMA interrupt of that STOP then finishes the transaction as aborted.
+Neither interrupt waits for the bus. Each background transaction has I2C_ASYNC_TIMEOUT_US, the STOP after a NAK
+included. When the alarm fires first the machine is stopped, the bus recovered and the transaction aborted.
+The engine follows the rules of i2c_async.h
+and uses the same struct i2c_async_txn, so the rest of the project does not care which bus a transaction runs on.
+Only one PIO bus is supported.
+*/
+
+#define I2C_PIO_MAX_LEN _u(256) // Max data bytes in one direction per transfer, a 24LC16B block
+#define I2C_PIO_MAX_WORDS (I2C_PIO_MAX_LEN + I2C_ASYNC_MAX_TX + _u(20)) // FIFO words of the longest stream, control words included
+#define I2C_PIO_RX_OVERHEAD _u(3) // RX bytes besides the data: up to two address echoes and the final PUSH
+#define I2C_PIO_STOP_TIMEOUT_US _u(1000) // Time allowed for the STOP after a NAK
+
+#define I2C_PIO_INFO 1 // Flag to determine if USB info statements should be printed.
+#define I2C_PIO_ERROR 1 // Flag to determine if USB error statements should be printed.
+
+// Bit positions in a FIFO word
+#define I2C_PIO_ICOUNT_LSB 10
+#define I2C_PIO_FINAL_LSB 9
+#define I2C_PIO_DATA_LSB 1
+#define I2C_PIO_NAK_LSB 0
+
+// Indices in i2c_pio_set_scl_sda_program_instructions
+#define I2C_PIO_SC0_SD0 0
+#define I2C_PIO_SC0_SD1 1
+#define I2C_PIO_SC1_SD0 2
+#define I2C_PIO_SC1_SD1 3
+
+// State of the PIO bus
+struct i2c_pio {
+    PIO pio;
+    uint sm;
+    uint offset; // Where the program was loaded
+    int tx_chan; // DMA channel feeding the TX FIFO
+    int rx_chan; // DMA channel draining the RX FIFO
+    bool claimed; // The state machine, program and channels are claimed once. A recovery only sets the machine up again.
+    bool restart; // The last transfer ended without a STOP, the next one starts with a repeated start
+    uint16_t cmd[I2C_PIO_MAX_WORDS]; // Stream of the transfer on the wire
+    uint8_t rx[I2C_PIO_MAX_LEN + I2C_PIO_RX_OVERHEAD]; // Everything the RX FIFO gave back
+    uint16_t rx_offset; // Where the read data starts in rx
+
+    // Background transactions, same scheme as the async engine
+    struct i2c_async_txn *queue[I2C_ASYNC_QUEUE_LEN]; // Ring of queued transactions
+    uint8_t head; // Next transaction to start
+    volatile uint8_t count; // Queued transactions, the one on the wire included
+    struct i2c_async_txn *active; // Transaction on the wire, NULL when idle
+    volatile bool stopping; // active was NAKed, the STOP behind it is on the wire
+    uint32_t start_us; // time_us_32 at which the active transaction started
+    volatile bool owns_bus; // Has the engine acquired the bus for the current batch of transactions
+    alarm_id_t alarm; // Deadline of the active transaction, 0 if none is set
+    uint32_t seq; // Counts started transactions, tells the alarm of the active one from a stale one
+};
+
+// The PIO bus. Initialize it with i2c_bus_init.
+extern struct i2c_bus i2c_bus1;
+// Controller of the PIO bus
+extern const struct i2c_bus_ops i2c_pio_ops;
+
+// Main functions
+
+// Queues txn on the PIO bus. Same return values as i2c_async_submit.
+int i2c_pio_submit(struct i2c_async_txn *txn);
+// Returns true when nothing is queued or on the wire
+bool i2c_pio_idle();
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef __I2C_REPLAY_H__
+#define __I2C_REPLAY_H__
+// Replays a captured I2C trace in place of the controller. Only meant for host builds (PICO_PLATFORM=host).
+
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "i2c_trace.h"
+
+/*
+In a host build there is no controller, the bus layer hands every transfer to the replayer instead.
+The replayer walks through a trace printed by "i2c -d" (see i2c_trace.h) one record per transfer:
+    A read gets the recorded bytes and result.
+    A write is compared against the recorded bytes and gets the recorded result.
+    Both start no earlier than their recorded offset from the first transfer and then take the recorded duration,
+    so the gaps between transfers are kept and the drivers see the same timing as on the board.
+    A driver that comes later than the trace is not made up for, its transfer simply starts late.
+The drivers run the same code paths as in the field, so a problem in the trace shows up the same way on the host.
+
+When the drivers ask for something the trace does not have (other address, direction, STOP or length) the replay has diverged.
+The transfer fails with PICO_ERROR_GENERIC and the divergence is counted. After the last record every transfer fails.
+Records of the async engine are replayed like blocking transfers.
+*/
+
+#define I2C_REPLAY_FILE "i2c_trace.log" // Trace i2c_bus_init opens in host builds
+#define I2C_REPLAY_MAX_LINE _u(1024) // Longest line read from the trace
+
+#define I2C_REPLAY_INFO 1 // Flag to determine if the replay summary should be printed.
+#define I2C_REPLAY_ERROR 1 // Flag to determine if divergences should be printed.
+
+// Replay state
+struct i2c_replay {
+    FILE *file;
+    uint32_t transfers; // Transfers served from the trace
+    uint32_t divergences; // Transfers that did not match the trace
+    bool ended; // The trace has no records left
+    bool started; // The first transfer was served, the start times below are set
+    uint32_t trace_start_us; // start_us of the first record
+    uint32_t host_start_us; // time_us_32 when the first transfer was asked for
+};
+
+// Main functions
+
+// Opens a trace. Returns false if it can not be read.
+bool i2c_replay_open(const char *path);
+// Closes the trace and prints the summary
+void i2c_replay_close();
+// Serves a transfer from the trace. Same arguments and return values as i2c_write_blocking/i2c_read_blocking.
+int i2c_replay_write(uint8_t addr, const uint8_t *src, size_t len, bool nostop);
+int i2c_replay_read(uint8_t addr, uint8_t *dst, size_t len, bool nostop);
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef __I2C_SCHED_H__
+#define __I2C_SCHED_H__
+// Runs a batch of I2C transactions across every bus at the same time.
+
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "i2c_bus.h"
+#include "i2c_async.h"
+
+/*
+Each bus has a background engine (i2c_async.h for i2c_bus0, i2c_pio.h for i2c_bus1) that works through its own queue.
+i2c_sched_run hands every transaction of a batch to the engine of its device's bus (dev->bus->ops->submit)
+and waits for all of them. Transactions on the same bus run in the order given, transactions on different buses
+overlap, so a batch takes as long as its busiest bus instead of the sum of all buses.
+When the queue of a bus is full the rest of that bus waits, the other buses keep being fed.
+
+The transactions follow the rules of i2c_async.h. After PICO_ERROR_TIMEOUT some of them can still be pending,
+their buffers belong to the engines until their status changes. Each one gives up after I2C_ASYNC_TIMEOUT_US on the wire,
+so they all leave I2C_ASYNC_PENDING at the latest I2C_ASYNC_QUEUE_LEN deadlines later.
+
+i2c_bus1 is only brought up with I2C_EEPROM_ON_PIO_BUS set in i2c_config.h, it is off by default.
+Without it every device sits on i2c_bus0 and a batch runs one transaction after the other on the async engine.
+*/
+
+#define I2C_SCHED_MAX_TXNS _u(32) // Max transactions in one batch
+#define I2C_SCHED_MAX_BUSES _u(4) // Max distinct buses in one batch
+
+// Main functions
+
+// Runs n transactions and waits up to timeout_us for all of them to finish.
+// Returns how many finished with I2C_ASYNC_DONE, PICO_ERROR_TIMEOUT or PICO_ERROR_GENERIC for an invalid batch.
+int i2c_sched_run(struct i2c_async_txn *txns, uint8_t n, uint32_t timeout_us);
+
+#endif
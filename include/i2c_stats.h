@@ -0,0 +1,66 @@
+#ifndef __I2C_STATS_H__
+#define __I2C_STATS_H__
+// Transaction statistics of an I2C bus. Kept by the bus layer, see i2c_bus.h.
+
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+
+/*
+Every transaction on the bus, blocking or async, is recorded against the 7-bit address it went to:
+transactions, bytes, NACKs, timeouts and a latency histogram.
+The histogram uses log2 buckets, bucket i counts latencies in [2^i, 2^(i+1)) us. The last bucket also takes everything longer.
+
+Bus occupancy is the share of time a transaction was on the wire.
+It is kept over a sliding window of I2C_STATS_WINDOW_SLOTS slots, the oldest slot is dropped as time moves on.
+
+Recording happens while the bus is owned, so updates from both cores and the async interrupt never overlap.
+Readers that want a consistent view should copy the structure while owning the bus.
+*/
+
+#define I2C_STATS_MAX_ADDR _u(16) // Distinct addresses tracked. Later addresses are counted in dropped.
+#define I2C_STATS_N_BUCKETS _u(16) // Latency histogram buckets, the last one starts at 32 ms
+#define I2C_STATS_WINDOW_SLOTS _u(10) // Slots in the occupancy window
+#define I2C_STATS_SLOT_US _u(100000) // Length of one slot, the window covers one second
+
+#define I2C_STATS_NO_ADDR _u(0xFF) // Marks an unused entry
+
+// Statistics of one address
+struct i2c_stats_entry {
+    uint8_t addr;
+    uint32_t transactions;
+    uint32_t bytes; // Payload bytes, address bytes excluded
+    uint32_t nacks; // Transactions that ended with PICO_ERROR_GENERIC or an abort
+    uint32_t timeouts; // Transactions that ended with PICO_ERROR_TIMEOUT
+    uint64_t total_us; // Sum of all latencies
+    uint32_t max_us;
+    uint32_t histogram[I2C_STATS_N_BUCKETS];
+};
+
+// Statistics of a bus
+struct i2c_stats {
+    struct i2c_stats_entry entries[I2C_STATS_MAX_ADDR];
+    uint32_t dropped; // Transactions to addresses that did not fit in entries
+
+    // Sliding occupancy window
+    uint32_t busy_us[I2C_STATS_WINDOW_SLOTS]; // Time on the wire per slot
+    uint8_t slot; // Slot currently being filled
+    uint32_t slot_start_us; // time_us_32 at which slot started
+};
+
+// Main functions
+
+// Clears everything and starts a new window at now_us
+void i2c_stats_reset(struct i2c_stats *stats, uint32_t now_us);
+// Records one transaction of bytes payload bytes to addr that ran from start_us to end_us and returned result (SDK return value)
+void i2c_stats_record(struct i2c_stats *stats, uint8_t addr, uint32_t bytes, int result, uint32_t start_us, uint32_t end_us);
+// Returns the occupancy of the window ending at now_us in 0.1 % units
+uint32_t i2c_stats_occupancy_permille(struct i2c_stats *stats, uint32_t now_us);
+// Returns the bucket a latency falls in
+uint8_t i2c_stats_bucket(uint32_t latency_us);
+
+// Theoretical time on the wire of a write of tx_len bytes followed by a read of rx_len bytes after a repeated start.
+// Each byte is 9 clocks with its ACK, START, RESTART and STOP are counted as one clock each.
+uint32_t i2c_stats_wire_time_us(uint32_t baudrate, uint32_t tx_len, uint32_t rx_len);
+
+#endif
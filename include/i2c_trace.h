@@ -0,0 +1,71 @@
+#ifndef __I2C_TRACE_H__
+#define __I2C_TRACE_H__
+// Transaction trace of an I2C bus. Kept by the bus layer, see i2c_bus.h.
+
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+
+/*
+While capturing, every transfer on the bus is appended to a RAM ring:
+when it started, how long it took, the address, the direction, the SDK result and the bytes that went over the wire.
+Reads store what was received, so replaying a trace gives the drivers the exact same data.
+
+Records are written while the bus is owned, so both cores and the async interrupt never write at the same time.
+There is a single reader (core1 in com_protocol) that drains the ring while capture keeps running.
+When the ring is full new records are dropped and counted, old ones are never overwritten.
+Only the reader moves tail, also on a restart: i2c_trace_start marks where the new capture begins and the reader
+skips what lies before it on its next pop, or right away with i2c_trace_discard. Until then those records keep their space.
+
+Drained records are printed as one text line each, see I2C_TRACE_TAG. Lines without the tag are ignored by the
+replayer, so a full serial log can be fed to it as is. The replayer is in i2c_replay.h.
+*/
+
+#define I2C_TRACE_BUFFER_SIZE _u(8192) // Bytes in the ring, headers included
+#define I2C_TRACE_MAX_DATA _u(256) // Data bytes stored per record. Longer transfers are truncated and flagged.
+#define I2C_TRACE_TAG "I2CT" // Starts every printed record
+
+// Record flags
+#define I2C_TRACE_READ _u(0x01) // Read, otherwise a write
+#define I2C_TRACE_NOSTOP _u(0x02) // No STOP at the end, the next transfer starts with a repeated start
+#define I2C_TRACE_ASYNC _u(0x04) // Issued by the async engine
+#define I2C_TRACE_TRUNCATED _u(0x08) // Only the first I2C_TRACE_MAX_DATA bytes were kept
+
+// Header stored in front of the data of every record
+struct i2c_trace_record {
+    uint32_t start_us; // time_us_32 when the transfer started
+    uint32_t duration_us;
+    uint16_t len; // Bytes transferred, may be more than what is stored
+    int16_t result; // SDK return value
+    uint8_t addr; // 7-bit address
+    uint8_t flags;
+};
+
+// Trace ring
+struct i2c_trace {
+    volatile bool capturing;
+    volatile uint32_t head; // Free running byte counter, only the writer moves it
+    volatile uint32_t tail; // Free running byte counter, only the reader moves it
+    volatile uint32_t start; // Value of head when the current capture started, only the writer moves it
+    uint32_t records; // Records written since the capture started
+    uint32_t dropped; // Records that did not fit
+    uint8_t buffer[I2C_TRACE_BUFFER_SIZE];
+};
+
+// Main functions
+
+// Starts a new capture, the records of the previous one are skipped by the reader. The caller has to own the bus.
+void i2c_trace_start(struct i2c_trace *trace);
+// Stops capturing, what is in the ring can still be read. The caller has to own the bus.
+void i2c_trace_stop(struct i2c_trace *trace);
+// Appends a transfer if capturing. The caller has to own the bus.
+void i2c_trace_record(struct i2c_trace *trace, uint8_t addr, uint8_t flags, const uint8_t *data, size_t len, int result, uint32_t start_us, uint32_t end_us);
+// Drops the records of captures before the current one. Only the reader may call it.
+void i2c_trace_discard(struct i2c_trace *trace);
+// Takes the oldest record of the current capture out of the ring. data has to hold I2C_TRACE_MAX_DATA bytes. Returns false if the ring is empty.
+bool i2c_trace_pop(struct i2c_trace *trace, struct i2c_trace_record *record, uint8_t *data);
+// Bytes of data stored for a record
+uint16_t i2c_trace_stored_len(const struct i2c_trace_record *record);
+
+#endif
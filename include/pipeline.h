@@ -0,0 +1,137 @@
+#ifndef __PIPELINE_H__
+#define __PIPELINE_H__
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "pico/stdlib.h"
+#include "bmp180.h"
+#include "bme280.h"
+#include "spsc_ring.h"
+#include "sensor_pair.h"
+#include "com_binary.h"
+
+/*
+Acquisition and processing of the sensors split over both cores, set up by the pipe command of com_protocol.
+
+core0 (main) only does the timed bus work. A repeating timer queues pipeline_acquire to main, which starts the conversions,
+waits them out and reads the raw ADC values: ut and up of the BMP180, adc_T, adc_P and adc_H of the BME280.
+With both sensors selected they convert at once, see sensor_pair.h.
+Each read becomes a struct pipeline_raw in an SPSC ring to core1 (see spsc_ring.h). Nothing is compensated on core0.
+
+core1 runs pipeline_process in its loop. It compensates the raw values with the driver formulas on shadow models
+(own measurement structs, the calibration of the real chips), low pass filters every channel, derives the altitude
+from the BMP180 pressure and the dew point from the BME280 temperature and humidity, and sends it all on:
+    PIPE,<time_us>,<sensor>,<quantity>,<value>,<filtered>
+with the sensor and quantity numbers of com_binary.h, or sample frames of the filtered value in binary mode.
+
+pipeline_bench runs the same acquisition and processing n times on core0 alone, then n times split over both cores,
+and reports the sustained rate of each. Output is off while it runs.
+*/
+
+#define PIPELINE_RING_LEN _u(128) // Raw reads waiting for core1, a power of 2
+#define PIPELINE_PROCESS_MAX _u(16) // Raw reads core1 processes per pass of its loop
+#define PIPELINE_MIN_PERIOD_US _u(10000) // Fastest acquisition, 100 Hz
+#define PIPELINE_DEFAULT_PERIOD_US _u(100000) // 10 Hz unless a rate is given
+#define PIPELINE_MAX_PERIOD_US _u(60000000) // Slowest acquisition, once a minute
+#define PIPELINE_FILTER_SHIFT _u(3) // First order low pass, filtered += (value - filtered) / 2^PIPELINE_FILTER_SHIFT
+#define PIPELINE_BENCH_MAX _u(1000) // Most samples per mode of a benchmark
+#define PIPELINE_BENCH_DEFAULT _u(50)
+
+// Magnus formula of the dew point, over water between -45 C and 60 C
+#define PIPELINE_MAGNUS_B 17.62f
+#define PIPELINE_MAGNUS_C 243.12f // C
+
+#define PIPELINE_INFO 1 // Flag to determine if USB info statements should be printed.
+
+// Sensors
+#define PIPELINE_BMP180 (1u << 0)
+#define PIPELINE_BME280 (1u << 1)
+
+// Filtered channels
+#define PIPELINE_CH_BMP180_TEMP _u(0)
+#define PIPELINE_CH_BMP180_PRESS _u(1)
+#define PIPELINE_CH_BMP180_ALT _u(2)
+#define PIPELINE_CH_BME280_TEMP _u(3)
+#define PIPELINE_CH_BME280_PRESS _u(4)
+#define PIPELINE_CH_BME280_HUM _u(5)
+#define PIPELINE_CH_BME280_DEW _u(6)
+#define PIPELINE_N_CH _u(7)
+
+// One read of raw ADC values, from core0 to core1
+struct pipeline_raw {
+    uint32_t time_us; // time_us_32 when it was read
+    uint8_t sensor; // PIPELINE_BMP180 or PIPELINE_BME280
+    int32_t adc[3]; // ut, up of the BMP180. adc_T, adc_P, adc_H of the BME280.
+};
+
+// Result of pipeline_bench
+struct pipeline_bench {
+    uint32_t samples; // Per mode, one sample reads every selected sensor once
+    uint32_t sensors;
+    uint32_t records; // Raw reads per mode
+    uint32_t one_core_us; // Acquire and process on core0
+    uint32_t two_core_us; // Acquire on core0, process on core1, until core1 is done
+    uint32_t acquire_us; // Acquisition time of the two core run
+    uint32_t process_us; // Processing time of core1 in the two core run
+};
+
+// Compensation, filter and derivation state. Only touched by whoever processes, core1 unless a one core benchmark runs.
+struct pipeline_stage {
+    struct bmp180_model bmp_180;
+    struct bmp180_measurements bmp_measure;
+    struct bme280_model bme_280;
+    struct bme280_measurements bme_measure;
+    int32_t filtered[PIPELINE_N_CH];
+    bool primed[PIPELINE_N_CH]; // filtered holds a value
+};
+
+// Pipeline state
+struct pipeline {
+    struct bmp180_model *bmp_180;
+    struct bme280_model *bme_280;
+    repeating_timer_t timer;
+    struct spsc_ring raw; // From main to core1
+    struct pipeline_raw raw_records[PIPELINE_RING_LEN];
+    struct pipeline_stage stage;
+
+    // Set by the pipe command, taken over by pipeline_start
+    uint32_t req_sensors;
+    uint32_t req_period_us;
+
+    // Owned by main
+    uint32_t sensors;
+    uint32_t period_us;
+    volatile bool running;
+    volatile bool pending; // pipeline_acquire is in the call queue
+    volatile bool bench; // A benchmark runs, nothing is sent on
+    volatile bool reprime; // Set by pipeline_start, core1 clears the filters and this
+    volatile uint32_t ticks;
+    volatile uint32_t skipped;
+    uint32_t acquired; // Raw reads taken
+    volatile uint32_t pushed; // Raw reads handed to core1
+    uint32_t acquire_us; // Total time spent in acquisition
+    uint32_t acquire_max_us;
+
+    // Owned by core1
+    volatile uint32_t processed;
+    uint32_t process_us; // Total time spent in processing
+    uint32_t process_max_us;
+};
+
+// Main functions
+
+// Initializer
+void pipeline_init(struct pipeline *pipe, struct bmp180_model *bmp_180, struct bme280_model *bme_280);
+// Starts or restarts acquisition of req_sensors every req_period_us. Wrapper to be executed by main.
+void pipeline_start(struct pipeline *pipe);
+// Stops acquisition. Reads already in the ring are still processed. Wrapper to be executed by main.
+void pipeline_stop(struct pipeline *pipe);
+// Reads the raw values of the sensors once and hands them to core1. Queued to main by the timer.
+void pipeline_acquire(struct pipeline *pipe);
+// Processes at most max raw reads. Returns how many were processed. Only call from core1.
+uint16_t pipeline_process(struct pipeline *pipe, uint16_t max);
+// Runs n samples on one core and n on two, fills in result. Stops acquisition. Wrapper to be executed by main.
+void pipeline_bench(struct pipeline *pipe, uint32_t n, struct pipeline_bench *result);
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef __SENSOR_PAIR_H__
+#define __SENSOR_PAIR_H__
+
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "bmp180.h"
+#include "bme280.h"
+
+/*
+One acquisition of the BMP180 and the BME280 together.
+
+Taken apart, bmp180_get_measurement sleeps through its temperature and pressure conversions
+and only then would a BME280 forced measurement start, so a sample of both takes the sum of the conversion times.
+The bus is idle while either chip converts. sensor_pair_convert starts the BME280 forced measurement and the BMP180
+temperature conversion back to back, then sleeps until whichever result is due next and reads it.
+The BMP180 pressure conversion is started right after its temperature is read.
+A pair takes about as long as the slower of the two and both start within a bus write of each other.
+
+A pair is one conversion of each chip, BMP_180_SS averaging only applies to bmp180_get_measurement.
+In normal mode the BME280 converts on its own and its latest shadowed values are read right away.
+*/
+
+#define SENSOR_PAIR_INFO 1 // Flag to determine if USB info statements should be printed.
+
+// Timing of one pair
+struct sensor_pair_timing {
+    uint32_t time_us; // time_us_32 when both conversions were started, the time stamp of the pair
+    uint32_t elapsed_us; // From the start to the last read
+    uint32_t bmp180_done_us; // From the start to the BMP180 pressure read
+    uint32_t bme280_done_us; // From the start to the BME280 read
+};
+
+// Main functions
+
+// Converts both and leaves the raw values in ut and up of the BMP180 and the adc values of the BME280.
+// Returns BME280_OK, or BME280_SLEEP when the BME280 is in sleep mode, only the BMP180 was read then.
+uint8_t sensor_pair_convert(struct bmp180_model *bmp_180, struct bme280_model *bme_280, struct sensor_pair_timing *timing);
+// sensor_pair_convert, then compensates both and publishes them with the time stamp of the pair
+uint8_t sensor_pair_measure(struct bmp180_model *bmp_180, struct bme280_model *bme_280, struct sensor_pair_timing *timing);
+
+// Helpers
+
+// Time a pair spends waiting on conversions in us, the slower of the two chips
+uint32_t sensor_pair_conversion_time_us(struct bmp180_model *bmp_180, struct bme280_model *bme_280);
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef __SEQLOCK_H__
+#define __SEQLOCK_H__
+// Sequence lock for values with a single writer and readers on either core.
+
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+
+/*
+The writer bumps seq to odd, copies the new values in and bumps seq to even again.
+A reader copies the values out between two reads of seq and keeps the copy only if seq was even and did not move.
+Neither side takes a lock or waits on the other, the writer is never held up by readers.
+
+A reader that keeps overlapping with writes gives up after SEQLOCK_READ_TRIES and returns false.
+This also covers a reader in an interrupt on the writing core, which could otherwise spin forever on a write it interrupted.
+Only one writer per lock. The values have to be plain data, they are copied with memcpy.
+*/
+
+#define SEQLOCK_READ_TRIES _u(8) // Attempts of seqlock_read before it gives up
+
+struct seqlock {
+    volatile uint32_t seq; // Odd while a write is in progress, 0 until the first write
+};
+
+// Initializer
+void seqlock_init(struct seqlock *lock);
+// Copies len bytes of src into the protected values at dst. Only the single writer calls this.
+void seqlock_write(struct seqlock *lock, void *dst, const void *src, size_t len);
+// Copies len bytes of the protected values at src into dst. False if nothing was written yet or no consistent copy was made.
+bool seqlock_read(const struct seqlock *lock, void *dst, const void *src, size_t len);
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef __SPSC_RING_H__
+#define __SPSC_RING_H__
+// Single producer, single consumer ring of fixed size records.
+
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+
+/*
+Hands records from one producer to one consumer, typically from core0 to core1, without a lock.
+The pico/util/queue takes a spin lock on every add and remove. Here the producer only moves head and the consumer only moves tail,
+so each side reads the index of the other and owns its own. A barrier orders the record copy against the index store.
+
+head and tail are free running counters, a slot is index & mask. The length has to be a power of 2.
+The storage is given by the caller (a static array in the owning struct), no heap is used.
+Batch push and pop copy a run of records with at most two memcpy, one on each side of the wrap, and move the index once.
+
+A full ring never waits. The records that did not fit are dropped and counted in dropped.
+high_water holds the highest level the producer saw, to size the ring.
+
+The ring does not send an event (SEV), a producer whose consumer sleeps in WFE does so after its push.
+Cortex-M0+ has no data cache, so there are no cache lines to pad the indices to. The producer and consumer fields are still kept apart.
+If the producer can be interrupted by another producer on the same core, the caller keeps interrupts off around the push.
+*/
+
+// Static initializer for a ring over the array records_array, for rings that are used before any init could run
+#define SPSC_RING_STATIC(records_array) { \
+        .records = (uint8_t *) (records_array), \
+        .size = sizeof((records_array)[0]), \
+        .mask = (sizeof(records_array) / sizeof((records_array)[0])) - 1, \
+    }
+
+struct spsc_ring {
+    uint8_t *records; // len * size bytes, given by the caller
+    uint16_t size; // Bytes per record
+    uint32_t mask; // len - 1
+
+    // Producer side
+    volatile uint32_t head; // Only the producer moves it
+    volatile uint32_t dropped; // Records that found the ring full
+    volatile uint32_t high_water; // Highest level seen after a push
+
+    // Consumer side
+    volatile uint32_t tail; // Only the consumer moves it
+};
+
+// Main functions
+
+// Initializer. records must hold len records of size bytes, len a power of 2.
+void spsc_ring_init(struct spsc_ring *ring, void *records, uint16_t size, uint32_t len);
+// Copies one record in. False and counted in dropped if the ring is full. Producer only.
+bool spsc_ring_push(struct spsc_ring *ring, const void *record);
+// Copies up to n records in. Returns how many fit, the rest is counted in dropped. Producer only.
+uint32_t spsc_ring_push_batch(struct spsc_ring *ring, const void *records, uint32_t n);
+// Copies the oldest record out. False if the ring is empty. Consumer only.
+bool spsc_ring_pop(struct spsc_ring *ring, void *record);
+// Copies up to max records out. Returns how many. Consumer only.
+uint32_t spsc_ring_pop_batch(struct spsc_ring *ring, void *records, uint32_t max);
+// Drops everything in the ring. Consumer only.
+void spsc_ring_flush(struct spsc_ring *ring);
+
+// Helpers
+
+// Records waiting. Exact for either side, a snapshot for anyone else.
+uint32_t spsc_ring_level(const struct spsc_ring *ring);
+bool spsc_ring_is_empty(const struct spsc_ring *ring);
+uint32_t spsc_ring_capacity(const struct spsc_ring *ring);
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef __STREAM_H__
+#define __STREAM_H__
+
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/util/queue.h"
+#include "spsc_ring.h"
+#include "bmp180.h"
+#include "bme280.h"
+#include "com_binary.h"
+
+/*
+Periodic push of sensor channels, set up by the stream command of com_protocol.
+
+Without it every sample is a round trip: the host sends a command, core1 queues it and main runs it.
+A stream instead keeps a repeating timer on core0 that queues stream_sample to main at the requested rate.
+main samples the selected channels and puts one struct stream_sample per value in a bounded SPSC ring (see spsc_ring.h),
+core1 sends them on with stream_drain: sample frames in binary mode (see com_binary.h), one line each in text mode:
+    STREAM,<time_us>,<sensor>,<quantity>,<value>
+with the sensor and quantity numbers of com_binary.h.
+
+Nothing waits on a full queue:
+    A tick while the previous stream_sample has not run yet is skipped and counted in skipped.
+    A sample that finds the ring full is lost and counted in the dropped counter of the ring.
+Both show up in the status of the stream command. Skips mean the rate is too high for the channels, drops mean the link is too slow.
+*/
+
+#define STREAM_RING_LEN _u(64) // Samples waiting for core1, a power of 2
+#define STREAM_DRAIN_MAX _u(16) // Samples core1 sends per pass of its loop
+#define STREAM_TICK_MAX _u(6) // Most samples one tick produces, every channel at once
+#define STREAM_MIN_PERIOD_US _u(10000) // Fastest stream, 100 Hz
+#define STREAM_DEFAULT_PERIOD_US _u(100000) // 10 Hz unless a rate is given
+#define STREAM_MAX_PERIOD_US _u(60000000) // Slowest stream, one sample a minute
+
+#define STREAM_INFO 1 // Flag to determine if USB info statements should be printed.
+
+// Channels
+#define STREAM_CH_BMP180 (1u << 0) // BMP180 temperature and pressure
+#define STREAM_CH_BMP180_ALT (1u << 1) // BMP180 altitude, samples the temperature and pressure as well
+#define STREAM_CH_BME280_TEMP (1u << 2)
+#define STREAM_CH_BME280_PRESS (1u << 3)
+#define STREAM_CH_BME280_HUM (1u << 4)
+#define STREAM_CH_BME280 (STREAM_CH_BME280_TEMP | STREAM_CH_BME280_PRESS | STREAM_CH_BME280_HUM)
+
+// One value on its way to the host
+struct stream_sample {
+    uint32_t time_us; // time_us_32 when it was sampled
+    int32_t value;
+    uint8_t sensor; // COM_BIN_SENSOR_*
+    uint8_t quantity; // COM_BIN_Q_*
+};
+
+// Stream state
+struct stream {
+    struct bmp180_model *bmp_180;
+    struct bme280_model *bme_280;
+    repeating_timer_t timer;
+    struct spsc_ring samples; // From main to core1
+    struct stream_sample sample_records[STREAM_RING_LEN];
+
+    // Set by the stream command, taken over by stream_start
+    uint32_t req_channels;
+    uint32_t req_period_us;
+
+    // Owned by main
+    uint32_t channels;
+    uint32_t period_us;
+    volatile bool running;
+    volatile bool pending; // stream_sample is in the call queue
+
+    // Counters since the last start
+    volatile uint32_t ticks;
+    volatile uint32_t skipped;
+    uint32_t sent; // core1 only
+};
+
+// Main functions
+
+// Initializer
+void stream_init(struct stream *stream, struct bmp180_model *bmp_180, struct bme280_model *bme_280);
+// Starts or restarts the stream with req_channels and req_period_us. Wrapper to be executed by main.
+void stream_start(struct stream *stream);
+// Stops the stream. Samples already queued are still sent. Wrapper to be executed by main.
+void stream_stop(struct stream *stream);
+// Samples the channels once. Queued to main by the timer.
+void stream_sample(struct stream *stream);
+// Sends at most max (up to STREAM_DRAIN_MAX) queued samples. Returns how many were sent. Only call from core1.
+uint16_t stream_drain(struct stream *stream, uint16_t max);
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef __TASK_SCHED_H__
+#define __TASK_SCHED_H__
+
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/timer.h"
+#include "hardware/sync.h"
+
+/*
+Cooperative periodic tasks of main, timed by one hardware alarm.
+
+Every task has a period, a phase and a budget. Task n is released at start + phase + k * period.
+The alarm is always set to the earliest next release. Its interrupt marks the released tasks ready and wakes main (SEV),
+it does not run them. main runs the ready tasks with task_sched_run between jobs of the call queue,
+lowest index first, each to completion. Nothing preempts a task, so a long job or task delays the ones behind it.
+That delay is what the scheduler measures, per task:
+    jitter: from the release to the start.
+    run time: from the start to the end, an overrun when longer than the budget.
+    misses: finished after its deadline, the next release, or released again before it even started.
+A release that finds the task still ready is counted as a miss and dropped, a task never runs twice in a row to catch up.
+
+Periods are changed at runtime with task_sched_set_period, a period of 0 disables the task.
+The sched command of com_protocol shows the statistics and sets the rates of the sensor tasks.
+*/
+
+#define TASK_SCHED_MAX_TASKS _u(8)
+#define TASK_SCHED_MIN_PERIOD_US _u(1000) // Fastest release of any task
+#define TASK_SCHED_MAX_PERIOD_US _u(60000000) // Slowest release, once a minute
+
+#define TASK_SCHED_INFO 1 // Flag to determine if USB info statements should be printed.
+
+// One periodic task
+struct task_sched_task {
+    const char *name;
+    void (*run)(void *ctx);
+    void *ctx;
+    uint32_t period_us; // 0 when disabled
+    uint32_t phase_us; // Offset of the first release from the start and from a period change
+    uint32_t budget_us; // Run time the task is expected to stay within
+
+    // Written by the alarm interrupt, read by main with interrupts off
+    uint64_t release_us; // Next release
+    uint64_t pending_us; // Release of the instance waiting to run
+    bool ready;
+
+    // Statistics
+    uint32_t runs;
+    uint32_t misses;
+    uint32_t overruns;
+    uint32_t jitter_max_us;
+    uint64_t jitter_total_us;
+    uint32_t run_max_us;
+    uint64_t run_total_us;
+};
+
+// Scheduler state. Lives on core0, the alarm is claimed and its interrupt taken there.
+struct task_sched {
+    struct task_sched_task tasks[TASK_SCHED_MAX_TASKS];
+    uint8_t n_tasks;
+    int alarm; // Hardware alarm number
+    bool running;
+    uint64_t start_us; // time_us_64 of task_sched_start or the last reset
+};
+
+// Copy of the statistics of one task, for printing
+struct task_sched_report {
+    const char *name;
+    uint32_t period_us;
+    uint32_t phase_us;
+    uint32_t budget_us;
+    uint32_t runs;
+    uint32_t misses;
+    uint32_t overruns;
+    uint32_t jitter_mean_us;
+    uint32_t jitter_max_us;
+    uint32_t run_mean_us;
+    uint32_t run_max_us;
+};
+
+// Copy of the statistics of every task
+struct task_sched_snapshot {
+    uint8_t n_tasks;
+    uint32_t elapsed_ms; // Since the statistics were started or reset
+    struct task_sched_report tasks[TASK_SCHED_MAX_TASKS];
+};
+
+// Main functions
+
+// Initializer. Claims a hardware alarm, call on core0.
+void task_sched_init(struct task_sched *sched);
+// Adds a task before task_sched_start. Returns its index, or -1 when the table is full.
+int task_sched_add(struct task_sched *sched, const char *name, void (*run)(void *ctx), void *ctx, uint32_t period_us, uint32_t phase_us, uint32_t budget_us);
+// Releases every task at its phase from now on
+void task_sched_start(struct task_sched *sched);
+// Runs the ready tasks once each. Only call from main.
+void task_sched_run(struct task_sched *sched);
+// Sets the period of task index, 0 disables it. The next release is a phase from now. Only call from main.
+void task_sched_set_period(struct task_sched *sched, uint8_t index, uint32_t period_us);
+// Zeroes the statistics of every task. Only call from main.
+void task_sched_reset(struct task_sched *sched);
+// Copies the statistics of every task into snapshot. Only call from main.
+void task_sched_snapshot(struct task_sched *sched, struct task_sched_snapshot *snapshot);
+
+// Helpers
+
+// Returns the index of the task called name, or -1
+int task_sched_find(struct task_sched *sched, const char *name);
+
+#endif
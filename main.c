@@ -1,6 +1,8 @@
 #include "main.h"
-//TODO
-//Define better non blocking sleep function
+#include "include/eeprom_log.h"
+#include "include/com_job.h"
+#include "include/pipeline.h"
+#include "include/sensor_pair.h"
 
 // Initialize the variables here
 struct bmp180_model my_bmp180; 
@@ -11,6 +13,13 @@ struct bme280_calib_param my_bme280_calib_params;
 struct bme280_settings my_bme280_settings; 
 struct bme280_measurements my_bme280_measurements;
 struct lcb16b_eeprom my_eeprom;
+struct eeprom_log my_eeprom_log;
+struct block_storage my_eeprom_storage;
+struct block_storage my_flash_storage;
+struct stream my_stream;
+struct pipeline my_pipeline;
+struct task_sched my_sched;
+static uint8_t led_blink_state = 0; // Holds the current state of the blink
 
 void toggle_led(uint8_t* led_state) {
 
@@ -21,6 +30,42 @@ void toggle_led(uint8_t* led_state) {
 
 }
 
+// Tasks of my_sched, run by main
+
+static void main_task_led(void *ctx){
+    toggle_led((uint8_t *) ctx);
+}
+
+static void main_task_eeprom_flush(void *ctx){
+    // Commit any EEPROM page that has been waiting in the write-back buffer for too long
+    #if LCB16B_WRITE_BUFFER_ENABLE
+    lcb16b_buffer_poll((struct lcb16b_eeprom *) ctx);
+    #endif
+}
+
+static void main_task_bmp180(void *ctx){
+    // Published for bmp180 -l and anyone else through bmp180_read_sample
+    bmp180_get_measurement((struct bmp180_model *) ctx);
+}
+
+static void main_task_bme280(void *ctx){
+    // Published through bme280_read_sample
+    struct bme280_model *bme_280 = (struct bme280_model *) ctx;
+    if (bme_280->settings->mode == 0b11){
+        // The chip converts on its own. The sample read by DMA since the last release is compensated here
+        // while the read of the next one is already on the wire, so what is published is one period old.
+        bme280_get_compensated_measurements_async(bme_280);
+        return;
+    }
+    bme280_get_compensated_measurements_blocked(bme_280);
+}
+
+static void main_task_pair(void *ctx){
+    // Both published with the same time stamp
+    struct sensor_pair_timing timing;
+    sensor_pair_measure(&my_bmp180, &my_bme280, &timing);
+}
+
 // Main init function to initialize all periphirals on program start
 void program_init(){
     // Initialize all standard stdio types linked with binary.
@@ -44,11 +89,45 @@ void program_init(){
     //Init the eeprom
     lcb16b_eeprom_init(&my_eeprom);
 
+    //Init the block storage backends
+    block_storage_eeprom_init(&my_eeprom_storage, &my_eeprom);
+    block_storage_flash_init(&my_flash_storage);
+
+    //Init the sample log on its storage. Builds the time index.
+    #if MAIN_LOG_ON_FLASH
+    eeprom_log_init(&my_eeprom_log, &my_flash_storage);
+    #else
+    eeprom_log_init(&my_eeprom_log, &my_eeprom_storage);
+    #endif
+
     //Init the RTC
     init_pico_rtc(&my_datetime);
 
+    //Init the stream, it only starts on request
+    stream_init(&my_stream, &my_bmp180, &my_bme280);
+
+    //Init the pipeline, it only starts on request. Needs the calibration of both sensors.
+    pipeline_init(&my_pipeline, &my_bmp180, &my_bme280);
+
+    //Register the binaries of main, before com_protocol_init launches core1 which reads the registry
+    if (com_protocol_register_bin(&sched_bin, "sched", sched_long_opts, SCHED_N_LONG_OPTS) < 0){
+        printf("Registering sched failed.\r\n");
+    }
+
     //Init the com protocol
     com_protocol_init();
+
+    //Start the periodic tasks. Sensor budgets are their conversion and bus times with the current settings.
+    task_sched_init(&my_sched);
+    task_sched_add(&my_sched, "led", main_task_led, &led_blink_state, MAIN_LED_PERIOD_MS * 1000, 0, MAIN_LED_BUDGET_US);
+    task_sched_add(&my_sched, "eeprom", main_task_eeprom_flush, &my_eeprom, MAIN_FLUSH_PERIOD_MS * 1000, MAIN_FLUSH_PHASE_MS * 1000, MAIN_FLUSH_BUDGET_US);
+    task_sched_add(&my_sched, "bmp180", main_task_bmp180, &my_bmp180, MAIN_BMP180_PERIOD_MS * 1000, MAIN_BMP180_PHASE_MS * 1000,
+        bmp180_conversion_time_us(&my_bmp180) + bmp180_bus_time_us(&my_bmp180));
+    task_sched_add(&my_sched, "bme280", main_task_bme280, &my_bme280, MAIN_BME280_PERIOD_MS * 1000, MAIN_BME280_PHASE_MS * 1000,
+        bme280_measurement_time_us(&my_bme280) + bme280_bus_time_us(&my_bme280));
+    task_sched_add(&my_sched, "pair", main_task_pair, NULL, 0, MAIN_PAIR_PHASE_MS * 1000,
+        sensor_pair_conversion_time_us(&my_bmp180, &my_bme280) + bmp180_bus_time_us(&my_bmp180) / BMP_180_SS + bme280_bus_time_us(&my_bme280));
+    task_sched_start(&my_sched);
 }
 
 int main() {
@@ -56,38 +135,28 @@ int main() {
     //Init stuff
     program_init();
 
-    // Holds the current state of the blink    
-    uint8_t LED_STATE = 0;
-
-    // Allocate some space to store a queue entry
-    queue_entry_t call_queue_entry;
+    // Allocate some space to store a job
+    struct com_job job;
 
 
     // Main stuff....
     while (true) {
-        sleep_ms(2000);
-        toggle_led(&LED_STATE);
-
-        // Execute anything that might be en the queue
-        // Check if any entry exists in the result queue
-        if (queue_is_empty(&call_queue))
-        {
-            // Empty. For debugging tell me
-            #if MAIN_DEBUG
-            printf("Call queue is empty.\r\n");
-            #endif
+        // Execute everything that is in the queue
+        while (queue_try_remove(&call_queue, &job)){
+            // Runs the job and adds its response to the result queue (stdout)
+            com_job_dispatch(&job);
         }
-        else{
-            // Read in the function and input from stdin
-            queue_remove_blocking(&call_queue, &call_queue_entry);
-            void (*stdin_func)() = (void(*)())(call_queue_entry.func);
-            void *std_in_value = call_queue_entry.data ;
-            // Execute the function
-            (*stdin_func)(std_in_value);
-            // Add response to the result queue (stdout)
-            int res = stdout_selector(call_queue_entry.func);
-        }
-    }
-}
 
+        // Empty. For debugging tell me
+        #if MAIN_DEBUG
+        printf("Call queue is empty.\r\n");
+        #endif
 
+        // Run the periodic tasks released in the meantime
+        task_sched_run(&my_sched);
+
+        // Sleep until something happens. Every queue add and every task release sends an event, every interrupt wakes us as well.
+        // An add between the check above and here leaves the event latched, so WFE returns right away.
+        __wfe();
+    }
+}
@@ -15,11 +15,26 @@
 #include "include/bme280.h"
 #include "include/24LC16B_EEPROM.h"
 #include "include/com_protocol.h"
-#include "include/bmp180_i2c.h"
-#include "include/bme280_i2c.h"
+#include "include/i2c_bus.h"
 #include "include/pico_rtc.h"
+#include "include/block_storage.h"
+#include "include/stream.h"
+#include "include/task_sched.h"
 
 #define MAIN_DEBUG 0 // Should debug prints be done?
+#define MAIN_LOG_ON_FLASH 0 // Keep the sample log on the onboard flash instead of the 24LC16B. Holds 64K samples instead of 254.
+
+// Periodic tasks of main, see task_sched.h. Phases keep the sensor tasks apart so neither waits on the other.
+#define MAIN_LED_PERIOD_MS _u(2000) // Time between LED toggles
+#define MAIN_LED_BUDGET_US _u(2000) // The LED sits behind the CYW43
+#define MAIN_FLUSH_PERIOD_MS _u(100) // Time between checks of the EEPROM write-back buffer
+#define MAIN_FLUSH_PHASE_MS _u(10)
+#define MAIN_FLUSH_BUDGET_US (LCB16B_PAGE_WRITE_TIME * LCB16B_PAGE_WRITE_TIME_SAFETY * 1000) // One page write
+#define MAIN_BMP180_PERIOD_MS _u(1000) // Time between BMP180 samples, the sched command changes it
+#define MAIN_BMP180_PHASE_MS _u(250)
+#define MAIN_BME280_PERIOD_MS _u(1000) // Time between BME280 samples, the sched command changes it
+#define MAIN_BME280_PHASE_MS _u(500)
+#define MAIN_PAIR_PHASE_MS _u(750) // Both sensors in one conversion, off until the sched command sets a rate
 
 //In order to use the bmp180 library initialize an object instance of each of the following structs
 extern struct bmp180_model my_bmp180; //used as variable to pass to save the current BMP state.
@@ -35,4 +50,21 @@ extern struct bme280_measurements my_bme280_measurements; //used as a variable t
 //In order to use the 24LC16B eeprom driver initialize the needed object
 extern struct lcb16b_eeprom my_eeprom; //Used as structure to store ID and pointer
 
+//In order to use the sample log initialize the needed object. Needs an initialized block storage backend, see MAIN_LOG_ON_FLASH.
+extern struct eeprom_log my_eeprom_log; //Stores the sparse time index and query state
+
+//Block storage backends. Anything that needs to persist data can use these through the block_storage_* functions.
+extern struct block_storage my_eeprom_storage; //The 24LC16B behind the block storage interface
+extern struct block_storage my_flash_storage; //The unused tail of the onboard flash
+
+//Periodic push of sensor channels, driven by the stream command
+extern struct stream my_stream;
+
+//Raw acquisition on core0, compensation and filtering on core1, driven by the pipe command.
+//The sensor headers include this one, so pipeline.h is included where it is used.
+extern struct pipeline my_pipeline;
+
+//Runs the LED blink, the EEPROM write-back flush and the sensor sampling at their rates
+extern struct task_sched my_sched;
+
 #endif
\ No newline at end of file
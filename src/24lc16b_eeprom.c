@@ -7,31 +7,45 @@ uint8_t return_device_address(uint16_t register_address){
     The next three bits of the controlbyte are the block-select bits (B2, B1, B0)
     Thus for some 11-bit register address we need to append the 3 MSB bits to the device control address
 
-    This is done by shifting the 4-bit LCB16B_ADDR 3 spaces to the left then OR with MSB 11,10 and 9 of register_address
+    This is done by shifting the 4-bit LCB16B_ADDR 3 spaces to the left then OR with bits 10, 9 and 8 of register_address
     */
-    return LCB16B_ADDR << 3 | ((register_address & 0x70) >> 8); //Get the MSB
+    return (LCB16B_ADDR << 3) | ((register_address >> 8) & 0x07); //Get the 3 MSB
+}
+
+// Every block-select value is its own I2C address
+struct i2c_device lcb16b_i2c_devices[LCB16B_N_BLOCKS] = {
+    {.bus = LCB16B_I2C_BUS, .addr = (LCB16B_ADDR << 3) | 0, .name = "24LC16B", .max_baudrate = I2C_FAST_MODE_BAUDRATE, .retries = I2C_BUS_DEFAULT_RETRIES},
+    {.bus = LCB16B_I2C_BUS, .addr = (LCB16B_ADDR << 3) | 1, .name = "24LC16B", .max_baudrate = I2C_FAST_MODE_BAUDRATE, .retries = I2C_BUS_DEFAULT_RETRIES},
+    {.bus = LCB16B_I2C_BUS, .addr = (LCB16B_ADDR << 3) | 2, .name = "24LC16B", .max_baudrate = I2C_FAST_MODE_BAUDRATE, .retries = I2C_BUS_DEFAULT_RETRIES},
+    {.bus = LCB16B_I2C_BUS, .addr = (LCB16B_ADDR << 3) | 3, .name = "24LC16B", .max_baudrate = I2C_FAST_MODE_BAUDRATE, .retries = I2C_BUS_DEFAULT_RETRIES},
+    {.bus = LCB16B_I2C_BUS, .addr = (LCB16B_ADDR << 3) | 4, .name = "24LC16B", .max_baudrate = I2C_FAST_MODE_BAUDRATE, .retries = I2C_BUS_DEFAULT_RETRIES},
+    {.bus = LCB16B_I2C_BUS, .addr = (LCB16B_ADDR << 3) | 5, .name = "24LC16B", .max_baudrate = I2C_FAST_MODE_BAUDRATE, .retries = I2C_BUS_DEFAULT_RETRIES},
+    {.bus = LCB16B_I2C_BUS, .addr = (LCB16B_ADDR << 3) | 6, .name = "24LC16B", .max_baudrate = I2C_FAST_MODE_BAUDRATE, .retries = I2C_BUS_DEFAULT_RETRIES},
+    {.bus = LCB16B_I2C_BUS, .addr = (LCB16B_ADDR << 3) | 7, .name = "24LC16B", .max_baudrate = I2C_FAST_MODE_BAUDRATE, .retries = I2C_BUS_DEFAULT_RETRIES},
+};
+
+const struct i2c_device* lcb16b_i2c_device(uint16_t register_address){
+    return &lcb16b_i2c_devices[(register_address >> 8) & 0x07];
 }
 
 void lcb16b_eeprom_init(struct lcb16b_eeprom* my_eeprom){
 
     sleep_ms(1000); //Just standard thing to let everything settle after powering on the EEPROM
-    uint8_t device_addr = return_device_address(LCB16B_CHIP_ID_ADDR);
+    const struct i2c_device* device = lcb16b_i2c_device(LCB16B_CHIP_ID_ADDR);
 
     #if LCB16B_INIT
     //First write the needed chipID
-    uint8_t write_buff[2];
-    write_buff[0] = (LCB16B_CHIP_ID_ADDR & 0x0FF); //Only care about 8 LSB
-    write_buff[1] = LCB16B_CHIP_ID;
+    uint8_t chip_id = LCB16B_CHIP_ID;
 
     //Write the chip_ID
-    lc16b_eeprom_i2c_write(device_addr,write_buff,2,false); //Stop after write
+    i2c_bus_reg_write(device,(LCB16B_CHIP_ID_ADDR & 0x0FF),&chip_id,1); //Only care about 8 LSB
     sleep_ms(LCB16B_PAGE_WRITE_TIME_SAFETY * LCB16B_PAGE_WRITE_TIME);
     #endif
 
     //We now read the chip ID
     uint8_t read_buff[1];
     uint8_t addr = (LCB16B_CHIP_ID_ADDR & 0x0FF); //Only care about 8 LSB
-    lc16b_eeprom_i2c_read(device_addr,&addr,read_buff,1,false);//Release control
+    i2c_bus_reg_read(device,addr,read_buff,1);//Release control
 
     // Is chip ID correct
     if (read_buff[0] != LCB16B_CHIP_ID)
@@ -51,17 +65,25 @@ void lcb16b_eeprom_init(struct lcb16b_eeprom* my_eeprom){
     my_eeprom->src_len = 0;
     my_eeprom->dst_len = 0;
 
+    #if LCB16B_WRITE_BUFFER_ENABLE
+    lcb16b_buffer_init(my_eeprom);
+    #endif
+
+    #if LCB16B_MIRROR_ENABLE
+    lcb16b_mirror_load(my_eeprom);
+    #endif
+
     #if LCB16B_DEBUG
     print_eeprom_chip_ID(my_eeprom);
     #endif
 }
 
-void lcb16b_eeprom_random_write(struct lcb16b_eeprom* my_eeprom) {
+uint16_t lcb16b_eeprom_random_write(struct lcb16b_eeprom* my_eeprom) {
     //Uses the pointer stored in my_eeprom to point to where to write
     //Additionally increments the internal pointer
 
     #if LCB16B_DEBUG
-    printf("Writing %u bytes starting from address %i \r\n", my_eeprom->src_len, my_eeprom->pointer);
+    DLOG_DEBUG("Writing %u bytes starting from address %i \r\n", my_eeprom->src_len, my_eeprom->pointer);
     #endif
 
     // We need to see if a wrap around will take place. If it does it needs to be shifted to fall back into the valid range of registers.
@@ -75,19 +97,19 @@ void lcb16b_eeprom_random_write(struct lcb16b_eeprom* my_eeprom) {
         overflow = 0;
     }
 
-    uint8_t device_addr = return_device_address(my_eeprom->pointer);
-    uint8_t * write_buffer = (uint8_t *) malloc((1 + (my_eeprom->src_len - overflow)) * sizeof(uint8_t)); // Allocate some buffer in memory. If overflowed we need to offset by that amount
-    const uint8_t a[] = {my_eeprom->pointer & 0x0FF};
-    memcpy(write_buffer, a, sizeof(uint8_t)); // Copy the content into memory
-    memcpy(write_buffer + sizeof(uint8_t), my_eeprom->src, sizeof(uint8_t) * (my_eeprom->src_len - overflow)); //Copy src to memory. If overflow we need to offset len by that amount
-
     // Write the contents to EEPROM
     // If overflow we need to offset len by that amount
-    lc16b_eeprom_i2c_write(device_addr,write_buffer,(my_eeprom->src_len - overflow)+1,false); //Stop after write
-    sleep_ms(LCB16B_PAGE_WRITE_TIME_SAFETY * LCB16B_PAGE_WRITE_TIME);
-
-    //Free malloc memory
-    free(write_buffer);
+    uint16_t len = my_eeprom->src_len - overflow;
+    uint16_t taken = lcb16b_eeprom_write(my_eeprom, my_eeprom->pointer, my_eeprom->src, len);
+    if (taken < len){
+        // A page could not be committed, for example a failed page still waits in the write-back buffer.
+        // Only move past what was taken and leave the rest, including the wrap around, to the caller.
+        #if LCB16B_DEBUG
+        DLOG_ERROR("Write at address %u only took %u of %u bytes.\r\n", my_eeprom->pointer, taken, len);
+        #endif
+        my_eeprom->pointer = (my_eeprom->pointer + taken) % (LCB16B_STOP_REG);
+        return taken;
+    }
 
     // Move pointer up, we have to do it in modulo space in order for wrap around to work
     if ( overflow != 0)
@@ -96,22 +118,22 @@ void lcb16b_eeprom_random_write(struct lcb16b_eeprom* my_eeprom) {
         my_eeprom->pointer = LCB16B_START_REG + (my_eeprom->pointer + (my_eeprom->src_len - overflow)) % (LCB16B_STOP_REG);
 
         #if LCB16B_DEBUG
-        printf("Writing process has overflowed with %u bytes. Pointer moved to %u and writing remaining bytes \r\n", overflow, my_eeprom->pointer);
+        DLOG_DEBUG("Writing process has overflowed with %u bytes. Pointer moved to %u and writing remaining bytes \r\n", overflow, my_eeprom->pointer);
         #endif
 
         // Additionally in this case we know some of the data did not write. Recursively call the function to finish that left overs
         // Shift src by what was written
         my_eeprom->src += ((my_eeprom->src_len - overflow) * sizeof(uint8_t));
         my_eeprom->src_len = overflow;
-        lcb16b_eeprom_random_write(my_eeprom);
+        return taken + lcb16b_eeprom_random_write(my_eeprom);
     }
     else {
         my_eeprom->pointer = (my_eeprom->pointer + (my_eeprom->src_len - overflow)) % (LCB16B_STOP_REG);
     }
-
+    return taken;
 }
 
-void lcb16b_eeprom_point_write(struct lcb16b_eeprom* my_eeprom, uint16_t reg){
+uint16_t lcb16b_eeprom_point_write(struct lcb16b_eeprom* my_eeprom, uint16_t reg){
     //Uses reg to point to where to write
     //Additionally increments the internal pointer
 
@@ -119,7 +141,7 @@ void lcb16b_eeprom_point_write(struct lcb16b_eeprom* my_eeprom, uint16_t reg){
     // Implementation choice is made to move it to the first valid number, aka start register
     if ( reg < LCB16B_START_REG || reg > LCB16B_STOP_REG){
         #if LCB16B_DEBUG
-        printf("Address %i not in allowed range [%u, %u]. Setting it to first valid index %u.\r\n", reg, LCB16B_START_REG, LCB16B_STOP_REG, LCB16B_START_REG);
+        DLOG_DEBUG("Address %i not in allowed range [%u, %u]. Setting it to first valid index %u.\r\n", reg, LCB16B_START_REG, LCB16B_STOP_REG, LCB16B_START_REG);
         #endif
 
         reg = LCB16B_START_REG;
@@ -129,8 +151,7 @@ void lcb16b_eeprom_point_write(struct lcb16b_eeprom* my_eeprom, uint16_t reg){
     my_eeprom->pointer = reg;
 
     //We can now use random write fot the remaining functionality
-    lcb16b_eeprom_random_write(my_eeprom);
-
+    return lcb16b_eeprom_random_write(my_eeprom);
 }
 
 void lcb16b_eeprom_random_read(struct lcb16b_eeprom* my_eeprom){
@@ -138,7 +159,7 @@ void lcb16b_eeprom_random_read(struct lcb16b_eeprom* my_eeprom){
     // Additionally increments the internal pointer
 
     #if LCB16B_DEBUG
-    printf("Reading %u bytes starting from address %i \r\n", my_eeprom->dst_len, my_eeprom->pointer);
+    DLOG_DEBUG("Reading %u bytes starting from address %i \r\n", my_eeprom->dst_len, my_eeprom->pointer);
     #endif
 
     // We need to see if a wrap around will take place. If it does it needs to be shifted to fall back into the valid range of registers.
@@ -152,9 +173,24 @@ void lcb16b_eeprom_random_read(struct lcb16b_eeprom* my_eeprom){
         overflow = 0;
     }
 
-    uint8_t device_addr = return_device_address(my_eeprom->pointer);
-    uint8_t addr = (my_eeprom->pointer & 0x0FF); //Only care about 8 LSB
-    lc16b_eeprom_i2c_read(device_addr,&addr,my_eeprom->dst,(my_eeprom->dst_len - overflow),false);//Release control
+    bool from_mirror = false;
+    #if LCB16B_MIRROR_ENABLE
+    if (my_eeprom->mirror_valid){
+        // The mirror already holds pending writes, so no overlay is needed
+        memcpy(my_eeprom->dst, my_eeprom->mirror + my_eeprom->pointer, my_eeprom->dst_len - overflow);
+        from_mirror = true;
+    }
+    #endif
+
+    if (!from_mirror){
+        uint8_t addr = (my_eeprom->pointer & 0x0FF); //Only care about 8 LSB
+        i2c_bus_reg_read(lcb16b_i2c_device(my_eeprom->pointer),addr,my_eeprom->dst,(my_eeprom->dst_len - overflow));//Release control
+
+        // Bytes still waiting in the write-back buffer are newer than what the chip holds
+        #if LCB16B_WRITE_BUFFER_ENABLE
+        lcb16b_buffer_overlay(my_eeprom, my_eeprom->pointer, my_eeprom->dst, my_eeprom->dst_len - overflow);
+        #endif
+    }
 
     // Move pointer up, we have to do it in modulo space in order for wrap around to work
     if ( overflow != 0)
@@ -163,7 +199,7 @@ void lcb16b_eeprom_random_read(struct lcb16b_eeprom* my_eeprom){
         my_eeprom->pointer = LCB16B_START_REG + (my_eeprom->pointer + (my_eeprom->dst_len - overflow)) % (LCB16B_STOP_REG);
 
         #if LCB16B_DEBUG
-        printf("Reading process has overflowed with %u bytes. Pointer moved to %u and writing remaining bytes \r\n", overflow, my_eeprom->pointer);
+        DLOG_DEBUG("Reading process has overflowed with %u bytes. Pointer moved to %u and writing remaining bytes \r\n", overflow, my_eeprom->pointer);
         #endif
 
         // Addtionally in this case we know some of the data did not write. Recursively call the function to finish that left overs.
@@ -185,7 +221,7 @@ void lcb16b_eeprom_point_read(struct lcb16b_eeprom* my_eeprom, uint16_t reg){
     // Implementation choice is made to move it to the first valid number, aka start register
     if ( reg < LCB16B_START_REG || reg > LCB16B_STOP_REG){
         #if LCB16B_DEBUG
-        printf("Address %i not in allowed range [%u, %u]. Setting it to first valid index %u.\r\n", reg, LCB16B_START_REG, LCB16B_STOP_REG, LCB16B_START_REG);
+        DLOG_DEBUG("Address %i not in allowed range [%u, %u]. Setting it to first valid index %u.\r\n", reg, LCB16B_START_REG, LCB16B_STOP_REG, LCB16B_START_REG);
         #endif
 
         reg = LCB16B_START_REG;
@@ -199,6 +235,269 @@ void lcb16b_eeprom_point_read(struct lcb16b_eeprom* my_eeprom, uint16_t reg){
 
 }
 
+uint16_t lcb16b_eeprom_stream_read(struct lcb16b_eeprom* my_eeprom, uint16_t reg, uint16_t len, lcb16b_sink_t sink, void *ctx){
+    // A sequential read only auto increments within the block selected in the control byte 24LC16B_DOC_10,
+    // so we issue one read per block and hand each block to the sink before moving on.
+    // Only one block is ever held in RAM, a full dump does not need a chip sized buffer.
+    if (reg >= LCB16B_SIZE){
+        return 0;
+    }
+    if ((reg + len) > LCB16B_SIZE){
+        len = LCB16B_SIZE - reg;
+    }
+
+    uint8_t block_buffer[LCB16B_BLOCK_SIZE];
+    uint16_t delivered = 0;
+    while (delivered < len){
+        uint16_t chunk = LCB16B_BLOCK_SIZE - (reg % LCB16B_BLOCK_SIZE); // Bytes left in this block
+        if (chunk > (len - delivered)){
+            chunk = len - delivered;
+        }
+
+        #if LCB16B_MIRROR_ENABLE
+        if (my_eeprom->mirror_valid){
+            // No bus traffic at all
+            sink(reg, my_eeprom->mirror + reg, chunk, ctx);
+            reg += chunk;
+            delivered += chunk;
+            continue;
+        }
+        #endif
+
+        uint8_t addr = reg & 0x0FF; //Only care about 8 LSB
+        int answer = i2c_bus_reg_read(lcb16b_i2c_device(reg),addr,block_buffer,chunk);//Release control
+        if (answer != chunk){
+            #if LCB16B_DEBUG
+            DLOG_DEBUG("Streaming read failed at address %u.\r\n", reg);
+            #endif
+            return delivered;
+        }
+
+        #if LCB16B_WRITE_BUFFER_ENABLE
+        lcb16b_buffer_overlay(my_eeprom, reg, block_buffer, chunk);
+        #endif
+
+        sink(reg, block_buffer, chunk, ctx);
+        reg += chunk;
+        delivered += chunk;
+    }
+    return delivered;
+}
+
+void lcb16b_eeprom_dump(struct lcb16b_eeprom* my_eeprom){
+    lcb16b_eeprom_stream_read(my_eeprom, 0, LCB16B_SIZE, print_eeprom_dump_chunk, NULL);
+}
+
+uint16_t lcb16b_eeprom_write(struct lcb16b_eeprom* my_eeprom, uint16_t reg, const uint8_t *src, uint16_t len){
+    #if LCB16B_WRITE_BUFFER_ENABLE
+    uint16_t taken = lcb16b_buffer_write(my_eeprom, reg, src, len);
+    #else
+    int answer = lcb16b_eeprom_page_write(reg, src, len);
+    uint16_t taken = (answer > 0) ? (uint16_t) answer : 0;
+    #endif
+    // The mirror holds the newest data, but only what the chip or the buffer actually took
+    #if LCB16B_MIRROR_ENABLE
+    lcb16b_mirror_update(my_eeprom, reg, src, taken);
+    #endif
+    #if LCB16B_DEBUG
+    if (taken != len){
+        DLOG_DEBUG("Write of %u bytes at address %u stopped after %u bytes.\r\n", len, reg, taken);
+    }
+    #endif
+    return taken;
+}
+
+int lcb16b_eeprom_page_write(uint16_t reg, const uint8_t *src, uint16_t len){
+    // From 24LC16B_DOC_9 a page write rolls over to the start of the same page if it runs past the page boundary.
+    // Thus we split the data on page boundaries and pay one write cycle per page.
+    int written = 0;
+    while (len > 0){
+        uint8_t chunk = LCB16B_PAGE_SIZE - (reg % LCB16B_PAGE_SIZE); // Bytes left in this page
+        if (chunk > len){
+            chunk = len;
+        }
+
+        int answer = i2c_bus_reg_write(lcb16b_i2c_device(reg),reg & 0x0FF,src,chunk); //Only care about 8 LSB. Stop after write
+        if (answer != chunk){
+            // Pages already written stay written, the caller learns where it stopped
+            return (written > 0) ? written : ((answer < 0) ? answer : PICO_ERROR_GENERIC);
+        }
+        sleep_ms(LCB16B_PAGE_WRITE_TIME_SAFETY * LCB16B_PAGE_WRITE_TIME);
+
+        reg += chunk;
+        src += chunk;
+        len -= chunk;
+        written += chunk;
+    }
+    return written;
+}
+
+#if LCB16B_WRITE_BUFFER_ENABLE
+void lcb16b_buffer_init(struct lcb16b_eeprom* my_eeprom){
+    memset(my_eeprom->wbuf, 0xFF, sizeof(my_eeprom->wbuf));
+    my_eeprom->wbuf_page = 0;
+    my_eeprom->wbuf_mask = 0;
+    my_eeprom->wbuf_time = 0;
+}
+
+uint16_t lcb16b_buffer_write(struct lcb16b_eeprom* my_eeprom, uint16_t reg, const uint8_t *src, uint16_t len){
+    uint16_t taken = 0;
+    while (len > 0){
+        uint16_t page = reg - (reg % LCB16B_PAGE_SIZE);
+        uint8_t offset = reg % LCB16B_PAGE_SIZE;
+        uint8_t chunk = LCB16B_PAGE_SIZE - offset;
+        if (chunk > len){
+            chunk = len;
+        }
+
+        // Only one page is held at a time, so moving to another page commits the current one
+        // If it cannot be committed there is no room for this page, the rest is not taken
+        if ((my_eeprom->wbuf_mask != 0) && (page != my_eeprom->wbuf_page) && !lcb16b_buffer_sync(my_eeprom)){
+            return taken;
+        }
+        if (my_eeprom->wbuf_mask == 0){
+            my_eeprom->wbuf_page = page;
+            my_eeprom->wbuf_time = to_ms_since_boot(get_absolute_time());
+        }
+
+        // Overlapping writes simply overwrite the pending bytes
+        memcpy(my_eeprom->wbuf + offset, src, chunk);
+        my_eeprom->wbuf_mask |= (uint16_t) (((1u << chunk) - 1) << offset);
+
+        #if LCB16B_DEBUG
+        DLOG_DEBUG("Buffered %u bytes for page %u, pending mask 0x%04x \r\n", chunk, page, my_eeprom->wbuf_mask);
+        #endif
+
+        // Full page, commit it in one write cycle. On failure it stays pending and the bytes still count as taken.
+        if (my_eeprom->wbuf_mask == 0xFFFF){
+            lcb16b_buffer_sync(my_eeprom);
+        }
+
+        reg += chunk;
+        src += chunk;
+        len -= chunk;
+        taken += chunk;
+    }
+    return taken;
+}
+
+bool lcb16b_buffer_sync(struct lcb16b_eeprom* my_eeprom){
+    uint16_t mask = my_eeprom->wbuf_mask;
+    if (mask == 0){
+        return true;
+    }
+
+    // Find the first and last pending byte
+    uint8_t first = 0;
+    while (((mask >> first) & 0x01) == 0){
+        first++;
+    }
+    uint8_t last = LCB16B_PAGE_SIZE - 1;
+    while (((mask >> last) & 0x01) == 0){
+        last--;
+    }
+
+    // If there are holes between them we fill those from the chip so the page still costs only one write cycle
+    uint16_t span = (uint16_t) (((1u << (last - first + 1)) - 1) << first);
+    if ((mask & span) != span){
+        uint8_t chip_page[LCB16B_PAGE_SIZE];
+        bool from_mirror = false;
+        #if LCB16B_MIRROR_ENABLE
+        if (my_eeprom->mirror_valid){
+            // Holes are never pending, so the mirror matches the chip there
+            memcpy(chip_page, my_eeprom->mirror + my_eeprom->wbuf_page, LCB16B_PAGE_SIZE);
+            from_mirror = true;
+        }
+        #endif
+        if (!from_mirror){
+            uint8_t addr = (my_eeprom->wbuf_page + first) & 0x0FF; //Only care about 8 LSB
+            int answer = i2c_bus_reg_read(lcb16b_i2c_device(my_eeprom->wbuf_page),addr,chip_page + first,last - first + 1);//Release control
+            if (answer != (last - first + 1)){
+                // chip_page holds garbage, writing it would overwrite bytes nobody asked to change
+                #if LCB16B_DEBUG
+                DLOG_DEBUG("Filling the holes of page %u failed, it stays pending.\r\n", my_eeprom->wbuf_page);
+                #endif
+                return false;
+            }
+        }
+        for (uint8_t i = first; i <= last; i++){
+            if (((mask >> i) & 0x01) == 0){
+                my_eeprom->wbuf[i] = chip_page[i];
+            }
+        }
+    }
+
+    #if LCB16B_DEBUG
+    DLOG_DEBUG("Flushing page %u bytes [%u, %u] \r\n", my_eeprom->wbuf_page, first, last);
+    #endif
+
+    // first and last are on the same page, so this is one transfer that is either all written or not at all
+    if (lcb16b_eeprom_page_write(my_eeprom->wbuf_page + first, my_eeprom->wbuf + first, last - first + 1) != (last - first + 1)){
+        #if LCB16B_DEBUG
+        DLOG_DEBUG("Flushing page %u failed, it stays pending.\r\n", my_eeprom->wbuf_page);
+        #endif
+        return false;
+    }
+    my_eeprom->wbuf_mask = 0;
+    return true;
+}
+
+void lcb16b_buffer_poll(struct lcb16b_eeprom* my_eeprom){
+    if (my_eeprom->wbuf_mask == 0){
+        return;
+    }
+    uint32_t now = to_ms_since_boot(get_absolute_time());
+    if ((now - my_eeprom->wbuf_time) >= LCB16B_WRITE_BUFFER_TIMEOUT){
+        lcb16b_buffer_sync(my_eeprom);
+    }
+}
+
+void lcb16b_buffer_overlay(struct lcb16b_eeprom* my_eeprom, uint16_t reg, uint8_t *dst, uint16_t len){
+    if (my_eeprom->wbuf_mask == 0){
+        return;
+    }
+    for (uint16_t i = 0; i < len; i++){
+        uint16_t offset = reg + i - my_eeprom->wbuf_page;
+        if ((offset < LCB16B_PAGE_SIZE) && ((my_eeprom->wbuf_mask >> offset) & 0x01)){
+            dst[i] = my_eeprom->wbuf[offset];
+        }
+    }
+}
+#endif
+
+#if LCB16B_MIRROR_ENABLE
+void lcb16b_mirror_load(struct lcb16b_eeprom* my_eeprom){
+    // The chip auto increments the address within a block, so a whole block is one sequential read 24LC16B_DOC_10
+    my_eeprom->mirror_valid = false;
+    for (uint16_t block = 0; block < LCB16B_N_BLOCKS; block++){
+        uint16_t reg = block * LCB16B_BLOCK_SIZE;
+        uint8_t addr = 0; // Start of the block
+        int answer = i2c_bus_reg_read(lcb16b_i2c_device(reg),addr,my_eeprom->mirror + reg,LCB16B_BLOCK_SIZE);//Release control
+        if (answer != LCB16B_BLOCK_SIZE){
+            #if LCB16B_DEBUG
+            DLOG_DEBUG("Loading the 24LC16B mirror failed at block %u. Reads fall back to I2C.\r\n", block);
+            #endif
+            return;
+        }
+    }
+    my_eeprom->mirror_valid = true;
+
+    #if LCB16B_INFO
+    printf("24LC16B mirror loaded with %u bytes.\r\n", LCB16B_SIZE);
+    #endif
+}
+
+void lcb16b_mirror_update(struct lcb16b_eeprom* my_eeprom, uint16_t reg, const uint8_t *src, uint16_t len){
+    if (reg >= LCB16B_SIZE){
+        return;
+    }
+    if ((reg + len) > LCB16B_SIZE){
+        len = LCB16B_SIZE - reg;
+    }
+    memcpy(my_eeprom->mirror + reg, src, len);
+}
+#endif
+
 // Creates space in memory and assigns the src value to an 8-bit buffer
 void lcb16b_set_src(struct lcb16b_eeprom* my_eeprom, uint32_t src_value, bool time_stamp){
     // Check if some malloc has been used.
@@ -0,0 +1,49 @@
+#include "../include/block_storage.h"
+
+// Checks that [addr, addr + len) is inside the storage and aligned to align
+static int block_storage_check(struct block_storage *storage, uint32_t addr, uint32_t len, uint32_t align){
+    if ((addr > storage->size) || (len > storage->size - addr)){
+        #if BLOCK_STORAGE_DEBUG
+        DLOG_ERROR("[BLOCK_STORAGE]: %s request [%u, %u) is out of range.\r\n", (uintptr_t) storage->name, addr, addr + len);
+        #endif
+        return BLOCK_STORAGE_RANGE;
+    }
+    if ((align > 1) && (((addr % align) != 0) || ((len % align) != 0))){
+        #if BLOCK_STORAGE_DEBUG
+        DLOG_ERROR("[BLOCK_STORAGE]: %s request [%u, %u) is not aligned to %u.\r\n", (uintptr_t) storage->name, addr, addr + len, align);
+        #endif
+        return BLOCK_STORAGE_ALIGN;
+    }
+    return BLOCK_STORAGE_OK;
+}
+
+int block_storage_read(struct block_storage *storage, uint32_t addr, uint8_t *dst, uint32_t len){
+    int res = block_storage_check(storage, addr, len, 1);
+    if ((res != BLOCK_STORAGE_OK) || (len == 0)){
+        return res;
+    }
+    return storage->ops->read(storage, addr, dst, len);
+}
+
+int block_storage_program(struct block_storage *storage, uint32_t addr, const uint8_t *src, uint32_t len){
+    int res = block_storage_check(storage, addr, len, storage->program_size);
+    if ((res != BLOCK_STORAGE_OK) || (len == 0)){
+        return res;
+    }
+    return storage->ops->program(storage, addr, src, len);
+}
+
+int block_storage_erase(struct block_storage *storage, uint32_t addr, uint32_t len){
+    int res = block_storage_check(storage, addr, len, storage->erase_size);
+    if ((res != BLOCK_STORAGE_OK) || (len == 0)){
+        return res;
+    }
+    return storage->ops->erase(storage, addr, len);
+}
+
+int block_storage_sync(struct block_storage *storage){
+    if (storage->ops->sync == NULL){
+        return BLOCK_STORAGE_OK;
+    }
+    return storage->ops->sync(storage);
+}
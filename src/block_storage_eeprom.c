@@ -0,0 +1,78 @@
+#include "../include/block_storage.h"
+#include "../include/24LC16B_EEPROM.h"
+
+/*
+Block storage backend for the 24LC16B.
+The first page holds the chip ID, so the region starts at the second page to keep every exposed page whole.
+The eeprom has no real erase, erasing simply writes erase_value over the range. Programs overwrite, no erase is needed.
+Everything goes through lcb16b_eeprom_write so the RAM mirror and write-back buffer stay coherent with the rest of the driver.
+A program that the driver could not take, or a buffered page that could not be committed, is reported as BLOCK_STORAGE_ERROR.
+*/
+
+#define BLOCK_STORAGE_EEPROM_BASE LCB16B_PAGE_SIZE // First chip register exposed as address 0
+
+// Context used to copy streamed blocks into the caller's buffer
+struct block_storage_eeprom_copy {
+    uint8_t *dst;
+    uint16_t base; // Chip register dst[0] corresponds to
+};
+
+static void block_storage_eeprom_copy_sink(uint16_t reg, const uint8_t *data, uint16_t len, void *ctx){
+    struct block_storage_eeprom_copy *copy = (struct block_storage_eeprom_copy *) ctx;
+    memcpy(copy->dst + (reg - copy->base), data, len);
+}
+
+static int block_storage_eeprom_read(struct block_storage *storage, uint32_t addr, uint8_t *dst, uint32_t len){
+    uint16_t reg = BLOCK_STORAGE_EEPROM_BASE + addr;
+    struct block_storage_eeprom_copy copy = {.dst = dst, .base = reg};
+    uint16_t delivered = lcb16b_eeprom_stream_read((struct lcb16b_eeprom *) storage->ctx, reg, len, block_storage_eeprom_copy_sink, &copy);
+    return (delivered == len) ? BLOCK_STORAGE_OK : BLOCK_STORAGE_ERROR;
+}
+
+static int block_storage_eeprom_program(struct block_storage *storage, uint32_t addr, const uint8_t *src, uint32_t len){
+    uint16_t taken = lcb16b_eeprom_write((struct lcb16b_eeprom *) storage->ctx, BLOCK_STORAGE_EEPROM_BASE + addr, src, len);
+    return (taken == len) ? BLOCK_STORAGE_OK : BLOCK_STORAGE_ERROR;
+}
+
+static int block_storage_eeprom_erase(struct block_storage *storage, uint32_t addr, uint32_t len){
+    uint8_t blank[LCB16B_PAGE_SIZE];
+    memset(blank, storage->erase_value, LCB16B_PAGE_SIZE);
+    for (uint32_t offset = 0; offset < len; offset += LCB16B_PAGE_SIZE){
+        if (lcb16b_eeprom_write((struct lcb16b_eeprom *) storage->ctx, BLOCK_STORAGE_EEPROM_BASE + addr + offset, blank, LCB16B_PAGE_SIZE) != LCB16B_PAGE_SIZE){
+            return BLOCK_STORAGE_ERROR;
+        }
+    }
+    return BLOCK_STORAGE_OK;
+}
+
+static int block_storage_eeprom_sync(struct block_storage *storage){
+    #if LCB16B_WRITE_BUFFER_ENABLE
+    if (!lcb16b_buffer_sync((struct lcb16b_eeprom *) storage->ctx)){
+        return BLOCK_STORAGE_ERROR;
+    }
+    #endif
+    return BLOCK_STORAGE_OK;
+}
+
+static const struct block_storage_ops block_storage_eeprom_ops = {
+    .read = block_storage_eeprom_read,
+    .program = block_storage_eeprom_program,
+    .erase = block_storage_eeprom_erase,
+    .sync = block_storage_eeprom_sync,
+};
+
+void block_storage_eeprom_init(struct block_storage *storage, struct lcb16b_eeprom *my_eeprom){
+    storage->ops = &block_storage_eeprom_ops;
+    storage->name = "eeprom";
+    storage->size = LCB16B_SIZE - BLOCK_STORAGE_EEPROM_BASE;
+    // Any byte can be written, the write-back buffer gathers them into page writes
+    storage->program_size = 1;
+    storage->erase_size = LCB16B_PAGE_SIZE;
+    storage->erase_value = 0xFF;
+    storage->needs_erase = false;
+    storage->ctx = my_eeprom;
+
+    #if BLOCK_STORAGE_INFO
+    printf("[BLOCK_STORAGE]: eeprom backend with %u bytes.\r\n", storage->size);
+    #endif
+}
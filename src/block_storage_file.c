@@ -0,0 +1,118 @@
+#include "../include/block_storage.h"
+
+#if !PICO_ON_DEVICE
+#include <stdlib.h>
+
+/*
+Block storage backend backed by a file on the host. Only meant for host builds.
+It follows NOR flash rules, a program can only clear bits, so code that forgets to erase before programming
+misbehaves on the host the same way it would on the flash backend.
+*/
+
+// Backend state
+struct block_storage_file {
+    FILE *file;
+};
+
+static int block_storage_file_read(struct block_storage *storage, uint32_t addr, uint8_t *dst, uint32_t len){
+    struct block_storage_file *state = (struct block_storage_file *) storage->ctx;
+    if ((fseek(state->file, addr, SEEK_SET) != 0) || (fread(dst, 1, len, state->file) != len)){
+        return BLOCK_STORAGE_ERROR;
+    }
+    return BLOCK_STORAGE_OK;
+}
+
+static int block_storage_file_program(struct block_storage *storage, uint32_t addr, const uint8_t *src, uint32_t len){
+    struct block_storage_file *state = (struct block_storage_file *) storage->ctx;
+    uint8_t page[storage->program_size];
+    for (uint32_t offset = 0; offset < len; offset += storage->program_size){
+        if (block_storage_file_read(storage, addr + offset, page, storage->program_size) != BLOCK_STORAGE_OK){
+            return BLOCK_STORAGE_ERROR;
+        }
+        for (uint32_t i = 0; i < storage->program_size; i++){
+            page[i] &= src[offset + i];
+        }
+        if ((fseek(state->file, addr + offset, SEEK_SET) != 0) || (fwrite(page, 1, storage->program_size, state->file) != storage->program_size)){
+            return BLOCK_STORAGE_ERROR;
+        }
+    }
+    return BLOCK_STORAGE_OK;
+}
+
+static int block_storage_file_erase(struct block_storage *storage, uint32_t addr, uint32_t len){
+    struct block_storage_file *state = (struct block_storage_file *) storage->ctx;
+    uint8_t blank[storage->erase_size];
+    memset(blank, storage->erase_value, storage->erase_size);
+    for (uint32_t offset = 0; offset < len; offset += storage->erase_size){
+        if ((fseek(state->file, addr + offset, SEEK_SET) != 0) || (fwrite(blank, 1, storage->erase_size, state->file) != storage->erase_size)){
+            return BLOCK_STORAGE_ERROR;
+        }
+    }
+    return BLOCK_STORAGE_OK;
+}
+
+static int block_storage_file_sync(struct block_storage *storage){
+    struct block_storage_file *state = (struct block_storage_file *) storage->ctx;
+    return (fflush(state->file) == 0) ? BLOCK_STORAGE_OK : BLOCK_STORAGE_ERROR;
+}
+
+static const struct block_storage_ops block_storage_file_ops = {
+    .read = block_storage_file_read,
+    .program = block_storage_file_program,
+    .erase = block_storage_file_erase,
+    .sync = block_storage_file_sync,
+};
+
+int block_storage_file_init(struct block_storage *storage, const char *path, uint32_t size, uint32_t erase_size, uint32_t program_size){
+    struct block_storage_file *state = (struct block_storage_file *) malloc(sizeof(struct block_storage_file));
+    if (state == NULL){
+        return BLOCK_STORAGE_ERROR;
+    }
+
+    storage->ops = &block_storage_file_ops;
+    storage->name = path;
+    storage->size = size;
+    storage->program_size = program_size;
+    storage->erase_size = erase_size;
+    storage->erase_value = 0xFF;
+    storage->needs_erase = true;
+    storage->ctx = state;
+
+    // Reuse an existing image so data survives between test runs
+    state->file = fopen(path, "r+b");
+    if (state->file == NULL){
+        state->file = fopen(path, "w+b");
+        if (state->file == NULL){
+            free(state);
+            return BLOCK_STORAGE_ERROR;
+        }
+    }
+
+    // Grow the image to size, new space reads as erased
+    fseek(state->file, 0, SEEK_END);
+    long current = ftell(state->file);
+    if ((current >= 0) && ((uint32_t) current < size)){
+        uint32_t start = (uint32_t) current - ((uint32_t) current % erase_size);
+        if (block_storage_file_erase(storage, start, size - start) != BLOCK_STORAGE_OK){
+            block_storage_file_deinit(storage);
+            return BLOCK_STORAGE_ERROR;
+        }
+    }
+
+    #if BLOCK_STORAGE_INFO
+    printf("[BLOCK_STORAGE]: file backend %s with %u bytes.\r\n", path, size);
+    #endif
+    return BLOCK_STORAGE_OK;
+}
+
+void block_storage_file_deinit(struct block_storage *storage){
+    struct block_storage_file *state = (struct block_storage_file *) storage->ctx;
+    if (state == NULL){
+        return;
+    }
+    fclose(state->file);
+    free(state);
+    storage->ctx = NULL;
+}
+
+#endif
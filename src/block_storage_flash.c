@@ -0,0 +1,85 @@
+#include "../include/block_storage.h"
+#include "hardware/flash.h"
+#include "hardware/sync.h"
+#include "pico/multicore.h"
+
+/*
+Block storage backend for the unused tail of the onboard QSPI flash.
+Reads go straight through the XIP window.
+While a sector is erased or a page programmed the flash can not be executed from, so:
+1) The other core is paused with multicore_lockout if it has registered as a victim.
+2) Interrupts are disabled, handlers live in flash as well.
+3) The functions touching the flash are placed in RAM with __not_in_flash_func.
+Every page and sector gets its own critical section so interrupts are never held off for more than one flash operation.
+The flash gives no status back, so programmed pages are compared with the source through the XIP window afterwards.
+*/
+
+// Pauses the other core if it allows us to. Returns true if it was paused.
+static bool __not_in_flash_func(block_storage_flash_lockout_start)(){
+    uint other_core = get_core_num() ^ 1;
+    if (!multicore_lockout_victim_is_initialized(other_core)){
+        return false;
+    }
+    multicore_lockout_start_blocking();
+    return true;
+}
+
+static int block_storage_flash_read(struct block_storage *storage, uint32_t addr, uint8_t *dst, uint32_t len){
+    memcpy(dst, (const uint8_t *) (XIP_BASE + BLOCK_STORAGE_FLASH_OFFSET + addr), len);
+    return BLOCK_STORAGE_OK;
+}
+
+static int __not_in_flash_func(block_storage_flash_program)(struct block_storage *storage, uint32_t addr, const uint8_t *src, uint32_t len){
+    bool locked = block_storage_flash_lockout_start();
+    for (uint32_t offset = 0; offset < len; offset += FLASH_PAGE_SIZE){
+        uint32_t ints = save_and_disable_interrupts();
+        flash_range_program(BLOCK_STORAGE_FLASH_OFFSET + addr + offset, src + offset, FLASH_PAGE_SIZE);
+        restore_interrupts(ints);
+    }
+    if (locked){
+        multicore_lockout_end_blocking();
+    }
+    // A program can only clear bits, a page that was not erased first reads back wrong
+    if (memcmp((const uint8_t *) (XIP_BASE + BLOCK_STORAGE_FLASH_OFFSET + addr), src, len) != 0){
+        #if BLOCK_STORAGE_DEBUG
+        DLOG_ERROR("[BLOCK_STORAGE]: flash range [%u, %u) does not read back as programmed.\r\n", addr, addr + len);
+        #endif
+        return BLOCK_STORAGE_ERROR;
+    }
+    return BLOCK_STORAGE_OK;
+}
+
+static int __not_in_flash_func(block_storage_flash_erase)(struct block_storage *storage, uint32_t addr, uint32_t len){
+    bool locked = block_storage_flash_lockout_start();
+    for (uint32_t offset = 0; offset < len; offset += FLASH_SECTOR_SIZE){
+        uint32_t ints = save_and_disable_interrupts();
+        flash_range_erase(BLOCK_STORAGE_FLASH_OFFSET + addr + offset, FLASH_SECTOR_SIZE);
+        restore_interrupts(ints);
+    }
+    if (locked){
+        multicore_lockout_end_blocking();
+    }
+    return BLOCK_STORAGE_OK;
+}
+
+static const struct block_storage_ops block_storage_flash_ops = {
+    .read = block_storage_flash_read,
+    .program = block_storage_flash_program,
+    .erase = block_storage_flash_erase,
+    .sync = NULL, // Programs are committed before they return
+};
+
+void block_storage_flash_init(struct block_storage *storage){
+    storage->ops = &block_storage_flash_ops;
+    storage->name = "flash";
+    storage->size = BLOCK_STORAGE_FLASH_SIZE;
+    storage->program_size = FLASH_PAGE_SIZE;
+    storage->erase_size = FLASH_SECTOR_SIZE;
+    storage->erase_value = 0xFF;
+    storage->needs_erase = true;
+    storage->ctx = NULL;
+
+    #if BLOCK_STORAGE_INFO
+    printf("[BLOCK_STORAGE]: flash backend with %u bytes at offset 0x%x.\r\n", storage->size, BLOCK_STORAGE_FLASH_OFFSET);
+    #endif
+}
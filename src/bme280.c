@@ -2,6 +2,7 @@
 #include "bme280.h"
 
 // Initialize all external variables
+struct i2c_device bme280_i2c_device = {.bus = &i2c_bus0, .addr = BME_280_ADDR, .name = "BME280", .max_baudrate = I2C_FAST_MODE_BAUDRATE, .retries = I2C_BUS_DEFAULT_RETRIES};
 uint8_t bme280_osrs_h_mode_array[6] = {0,0,0,0,0,0};
 uint8_t bme280_osrs_p_mode_array[6] = {0,0,0,0,0,0};
 uint8_t bme280_osrs_t_mode_array[6] = {0,0,0,0,0,0};
@@ -13,7 +14,7 @@ void read_bme280_chip_id(struct bme280_model *my_chip){
     uint8_t chipID[1];
     uint8_t addr = BME_280_CHIP_ID_ADDR;
 
-    bme280_i2c_read(BME_280_ADDR,&addr,chipID,1,false);
+    i2c_bus_reg_read(&bme280_i2c_device,addr,chipID,1);
 
     if (chipID[0] != BME_280_CHIP_ID){
         while (true){
@@ -41,7 +42,7 @@ void read_bme280_callibration_params(struct bme280_model *my_chip, struct bme280
     // First read in temperature values
     uint8_t rx_temp_buffer[6] = {0};
     uint8_t addr = BME_280_REG_T1_LSB;
-    bme280_i2c_read(BME_280_ADDR,&addr,rx_temp_buffer,6,false);
+    i2c_bus_reg_read(&bme280_i2c_device,addr,rx_temp_buffer,6);
     // The values are split [7:0]/[15:8] thus LSB is first
     params->dig_T1 = (uint16_t) (rx_temp_buffer[1] << 8) | rx_temp_buffer[0];
     params->dig_T2 = (int16_t) (rx_temp_buffer[3] << 8) | rx_temp_buffer[2]; 
@@ -50,7 +51,7 @@ void read_bme280_callibration_params(struct bme280_model *my_chip, struct bme280
     // Read pressure values
     uint8_t rx_pressure_buff[18];
     addr = BME_280_REG_P1_LSB;
-    bme280_i2c_read(BME_280_ADDR,&addr,rx_pressure_buff,18,false);
+    i2c_bus_reg_read(&bme280_i2c_device,addr,rx_pressure_buff,18);
     // The values are split [7:0]/[15:8] thus LSB is first
     params->dig_P1 = (uint16_t) (rx_pressure_buff[1] << 8) | rx_pressure_buff[0];
     params->dig_P2 = (int16_t) (rx_pressure_buff[3] << 8) | rx_pressure_buff[2];
@@ -66,14 +67,14 @@ void read_bme280_callibration_params(struct bme280_model *my_chip, struct bme280
     // This one is rather weird....
     uint8_t reg_h1[1];
     addr = BME_280_REG_H1;
-    bme280_i2c_read(BME_280_ADDR,&addr,reg_h1,1,false);
+    i2c_bus_reg_read(&bme280_i2c_device,addr,reg_h1,1);
     // First value is splt [7:0]
     params->dig_H1 = (uint8_t) reg_h1[0];
     // We then need to go to another part of storage and read the rest
     // The weird split rules are defined at BME280_DOC_23
-    uint8_t rx_humidity_buff[7];
+    uint8_t rx_humidity_buff[8];
     addr = BME_280_REG_H2_LSB;
-    bme280_i2c_read(BME_280_ADDR,&addr,rx_humidity_buff,8,false);
+    i2c_bus_reg_read(&bme280_i2c_device,addr,rx_humidity_buff,8);
     // Split [7:0]/[15:8]
     params->dig_H2 = (int16_t) (rx_humidity_buff[1] << 8) | rx_humidity_buff[0];
     // Split [7:0]
@@ -178,6 +179,9 @@ void bme280_init(struct bme280_model *my_chip, struct bme280_calib_param *params
 
     // Now set the initial conditions
     my_chip->measure = meas;
+    my_chip->async.in_flight = false;
+    my_chip->async.retries = 0;
+    seqlock_init(&my_chip->sample_lock);
     bme280_set_config(my_chip);
     bme280_set_ctrl_hum(my_chip); // because set_ctrl_hum also needs to set the ctrl_meas to take effect we only need to call this.
 
@@ -237,7 +241,7 @@ void bme280_set_config(struct bme280_model *my_chip){
     */
     write_buffer[1] = (uint8_t) (((my_chip->settings->t_sb << 5) & 0xE0) | ((my_chip->settings->filter << 2) & 0x1C) | (my_chip->settings->spi3w_en & 0x01));
     // Now update the config
-    bme280_i2c_write(BME_280_ADDR,write_buffer,2,false);
+    i2c_bus_write(&bme280_i2c_device,write_buffer,2,false);
 
     if ( tmp_mode != 0 ){
         // Case 4 we need to switch back to the original mode
@@ -273,7 +277,7 @@ uint8_t bme280_set_ctrl_meas(struct bme280_model *my_chip){
     }
 
     // Now update the mode
-    bme280_i2c_write(BME_280_ADDR,write_buffer,2,false);
+    i2c_bus_write(&bme280_i2c_device,write_buffer,2,false);
     return BME280_OK;
 }
 
@@ -289,7 +293,7 @@ void bme280_set_ctrl_hum(struct bme280_model *my_chip){
     write_buffer[0] = BME_280_REG_CTRL_HUM;
     write_buffer[1] = (uint8_t) (my_chip->settings->osrs_h & 0x07);
     // Now update the mode
-    bme280_i2c_write(BME_280_ADDR,write_buffer,2,false);
+    i2c_bus_write(&bme280_i2c_device,write_buffer,2,false);
 
     // In order to make changes stick send write to ctrl_meas. I want it to block for now.
     uint8_t ctrl_result = bme280_set_ctrl_meas(my_chip);
@@ -307,12 +311,12 @@ void bme280_read_ctrl_meas(struct bme280_model *my_chip){
     these are obtained from BME280_DOC_27
     */
     uint8_t addr = BME_280_REG_CTRL_MEAS;
-    uint8_t reg[0];
-    bme280_i2c_read(BME_280_ADDR,&addr,reg,1,false);
+    uint8_t reg[1];
+    i2c_bus_reg_read(&bme280_i2c_device,addr,reg,1);
 
     // Debug lines
     #if BME_280_DEBUG_MODE
-    printf("CTRL_REG = %u \r\n",reg[0]);
+    DLOG_DEBUG("CTRL_REG = %u \r\n",reg[0]);
     #endif
 
     // Mode is [1:0]
@@ -324,9 +328,9 @@ void bme280_read_ctrl_meas(struct bme280_model *my_chip){
 
     // Debug lines
     #if BME_280_DEBUG_MODE
-    printf("BME280 mode = %u\r\n",my_chip->settings->mode);
-    printf("BME280 osrs_p = %u\r\n",my_chip->settings->osrs_p);
-    printf("BME280 osrs_t = %u\r\n",my_chip->settings->osrs_t);
+    DLOG_DEBUG("BME280 mode = %u\r\n",my_chip->settings->mode);
+    DLOG_DEBUG("BME280 osrs_p = %u\r\n",my_chip->settings->osrs_p);
+    DLOG_DEBUG("BME280 osrs_t = %u\r\n",my_chip->settings->osrs_t);
     #endif
 }
 
@@ -337,12 +341,12 @@ void bme280_read_config(struct bme280_model *my_chip){
     these are obtained from BME280_DOC_28
     */
     uint8_t addr = BME_280_REG_CONFIG;
-    uint8_t reg[0];
-    bme280_i2c_read(BME_280_ADDR,&addr,reg,1,false);
+    uint8_t reg[1];
+    i2c_bus_reg_read(&bme280_i2c_device,addr,reg,1);
 
     // Debug lines
     #if BME_280_DEBUG_MODE
-    printf("CONFIG_REG = %u \r\n",reg[0]);
+    DLOG_DEBUG("CONFIG_REG = %u \r\n",reg[0]);
     #endif
 
     // spi3w_en is [0]
@@ -354,9 +358,9 @@ void bme280_read_config(struct bme280_model *my_chip){
 
     // Debug lines
     #if BME_280_DEBUG_MODE
-    printf("BME280 spi3w_en = %u\r\n",my_chip->settings->spi3w_en);
-    printf("BME280 filter = %u\r\n",my_chip->settings->filter);
-    printf("BME280 t_sb = %u\r\n",my_chip->settings->t_sb);
+    DLOG_DEBUG("BME280 spi3w_en = %u\r\n",my_chip->settings->spi3w_en);
+    DLOG_DEBUG("BME280 filter = %u\r\n",my_chip->settings->filter);
+    DLOG_DEBUG("BME280 t_sb = %u\r\n",my_chip->settings->t_sb);
     #endif
 }
 
@@ -367,12 +371,12 @@ void bme280_read_ctrl_hum(struct bme280_model *my_chip){
     these are obtained from BME280_DOC_26
     */
     uint8_t addr = BME_280_REG_CTRL_HUM;
-    uint8_t reg[0];
-    bme280_i2c_read(BME_280_ADDR,&addr,reg,1,false);
+    uint8_t reg[1];
+    i2c_bus_reg_read(&bme280_i2c_device,addr,reg,1);
 
     // Debug lines
     #if BME_280_DEBUG_MODE
-    printf("CTRL_HUM_REG = %u \r\n",reg[0]);
+    DLOG_DEBUG("CTRL_HUM_REG = %u \r\n",reg[0]);
     #endif
 
     // osrs_h is [2:0]
@@ -380,24 +384,24 @@ void bme280_read_ctrl_hum(struct bme280_model *my_chip){
 
     // Debug lines
     #if BME_280_DEBUG_MODE
-    printf("BME280 osrs_h = %u\r\n",my_chip->settings->osrs_h);
+    DLOG_DEBUG("BME280 osrs_h = %u\r\n",my_chip->settings->osrs_h);
     #endif
 }
 
 void bme280_read_status(uint8_t *reg){
     // Simple read of CTRL_MEAS reg
     uint8_t addr = BME_280_REG_STATUS;
-    bme280_i2c_read(BME_280_ADDR,&addr,reg,1,false);
+    i2c_bus_reg_read(&bme280_i2c_device,addr,reg,1);
 }
 
 bool bme280_is_doing_conversion(){
-    uint8_t status[0];
+    uint8_t status[1];
     // Read status
     bme280_read_status(status);
 
     // Debug lines
     #if BME_280_DEBUG_MODE
-    printf("STATUS_REG = %u \r\n",status[0]);
+    DLOG_DEBUG("STATUS_REG = %u \r\n",status[0]);
     #endif
 
     // Looking if bit 3 is set (BME280_DOC_26)
@@ -529,7 +533,7 @@ uint8_t bme280_start_measurements(struct bme280_model *my_chip){
         else {
             // We are in sleep mode warn the user
             #if BME_280_DEBUG_MODE
-            printf("WARNING: BME280 is currently in sleep mode. Please set to either force mode or normal mode.");
+            DLOG_DEBUG("WARNING: BME280 is currently in sleep mode. Please set to either force mode or normal mode.");
             #endif
             return BME280_SLEEP;
         }
@@ -542,6 +546,13 @@ uint8_t bme280_start_measurements(struct bme280_model *my_chip){
     return BME280_OK;
 }
 
+// Unpacks the burst read of 0xF7 to 0xFE into the adc values
+static void bme280_decode_uncompensated(struct bme280_model *my_chip, const uint8_t *read_buff){
+    my_chip->measure->adc_P = ((uint32_t)read_buff[0] << 12) | ((uint32_t)read_buff[1] << 4) | ((uint32_t)read_buff[2] >> 4);
+    my_chip->measure->adc_T = ((uint32_t)read_buff[3] << 12) | ((uint32_t)read_buff[4] << 4) | ((uint32_t)read_buff[5] >> 4);
+    my_chip->measure->adc_H = ((uint32_t)read_buff[6] << 8) | ((uint32_t)read_buff[7]);
+}
+
 uint8_t bme280_get_uncompensated_measurements(struct bme280_model *my_chip){
     /*
     BME280_DOC_21 suggests that one should rather perform a burst read from 0xF7 to 0xFE.
@@ -555,17 +566,35 @@ uint8_t bme280_get_uncompensated_measurements(struct bme280_model *my_chip){
 
     uint8_t addr = BME_280_REG_PRESS_MSB;
     uint8_t read_buff[8] = {0};
-    bme280_i2c_read(BME_280_ADDR,&addr,read_buff,8,false);
+    i2c_bus_reg_read(&bme280_i2c_device,addr,read_buff,8);
 
-    // Read in the uncompensated data
-    my_chip->measure->adc_P = ((uint32_t)read_buff[0] << 12) | ((uint32_t)read_buff[1] << 4) | ((uint32_t)read_buff[2] >> 4);
-    my_chip->measure->adc_T = ((uint32_t)read_buff[3] << 12) | ((uint32_t)read_buff[4] << 4) | ((uint32_t)read_buff[5] >> 4);
-    my_chip->measure->adc_H = ((uint32_t)read_buff[6] << 8) | ((uint32_t)read_buff[7]);
+    bme280_decode_uncompensated(my_chip, read_buff);
 
     return BME280_OK;
 }
 
 
+void bme280_compensate(struct bme280_model *my_chip){
+    // Pressure and humidity need t_fine of the temperature
+    bme280_compensate_temp(my_chip);
+    bme280_compensate_press(my_chip);
+    bme280_compensate_hum(my_chip);
+}
+
+void bme280_publish_at(struct bme280_model *my_chip, uint32_t time_us){
+    struct bme280_sample sample = {time_us, my_chip->measure->T, my_chip->measure->P, my_chip->measure->H};
+    seqlock_write(&my_chip->sample_lock, &my_chip->sample, &sample, sizeof(sample));
+}
+
+// Publishes the compensated values of measure, stamped now
+static void bme280_publish(struct bme280_model *my_chip){
+    bme280_publish_at(my_chip, time_us_32());
+}
+
+bool bme280_read_sample(struct bme280_model *my_chip, struct bme280_sample *sample){
+    return seqlock_read(&my_chip->sample_lock, sample, &my_chip->sample, sizeof(struct bme280_sample));
+}
+
 void bme280_get_compensated_measurements_blocked(struct bme280_model * my_chip)
 {
     /*
@@ -591,9 +620,8 @@ void bme280_get_compensated_measurements_blocked(struct bme280_model * my_chip)
     }
 
     // Perform compensation
-    bme280_compensate_temp(my_chip);
-    bme280_compensate_press(my_chip);
-    bme280_compensate_hum(my_chip);
+    bme280_compensate(my_chip);
+    bme280_publish(my_chip);
 
 
 }
@@ -614,9 +642,108 @@ uint8_t bme280_get_compensated_measurements_non_blocked(struct bme280_model *my_
         return status;
     }
 
-    bme280_compensate_temp(my_chip);
-    bme280_compensate_press(my_chip);
-    bme280_compensate_hum(my_chip);
+    bme280_compensate(my_chip);
+    bme280_publish(my_chip);
+
+    return BME280_OK;
+}
+
+// Puts the next burst read on the wire
+static void bme280_async_submit(struct bme280_model *my_chip){
+    struct bme280_async *async = &my_chip->async;
+    async->reg = BME_280_REG_PRESS_MSB;
+    async->txn.dev = &bme280_i2c_device;
+    async->txn.tx = &async->reg;
+    async->txn.tx_len = 1;
+    async->txn.rx = async->raw;
+    async->txn.rx_len = 8;
+    async->txn.callback = NULL;
+    async->txn.ctx = my_chip;
+    async->in_flight = (i2c_async_submit(&async->txn) == I2C_ASYNC_OK);
+}
+
+uint8_t bme280_get_compensated_measurements_async(struct bme280_model *my_chip){
+    struct bme280_async *async = &my_chip->async;
+
+    if (!async->in_flight){
+        // Nothing on the wire yet, prime the pipeline
+        bme280_async_submit(my_chip);
+        return BME280_BUSY;
+    }
+    if (async->txn.status == I2C_ASYNC_PENDING){
+        return BME280_BUSY;
+    }
+    if (async->txn.status == I2C_ASYNC_ABORTED){
+        if (async->retries >= BME_280_ASYNC_RETRIES){
+            // Most likely no chip, stop hammering the bus. The next call starts over.
+            #if BME_280_DEBUG_MODE
+            DLOG_DEBUG("BME280 async read aborted %u times in a row. Giving up.\r\n", async->retries + 1);
+            #endif
+            async->retries = 0;
+            async->in_flight = false;
+            return BME280_FAILED;
+        }
+        #if BME_280_DEBUG_MODE
+        DLOG_DEBUG("BME280 async read aborted with source 0x%x. Retrying.\r\n", async->txn.abort_source);
+        #endif
+        async->retries++;
+        bme280_async_submit(my_chip);
+        return BME280_BUSY;
+    }
+    async->retries = 0;
+
+    // Take the sample out of the DMA buffer before the next read lands in it
+    bme280_decode_uncompensated(my_chip, async->raw);
+    bme280_async_submit(my_chip);
+
+    // Compensate while the next sample is on the wire
+    bme280_compensate(my_chip);
+    bme280_publish(my_chip);
 
     return BME280_OK;
-}
\ No newline at end of file
+}
+
+// Turns an osrs register value into the amount of samples taken, BME280_DOC_27
+static uint32_t bme280_oversampling(uint8_t osrs){
+    if (osrs == 0){
+        return 0; // Skipped
+    }
+    if (osrs > 5){
+        osrs = 5; // All other values are x16
+    }
+    return 1 << (osrs - 1);
+}
+
+uint32_t bme280_measurement_time_us(struct bme280_model *my_chip){
+    // t_measure,max = 1.25 + 2.3 * osrs_t + (2.3 * osrs_p + 0.575) + (2.3 * osrs_h + 0.575) ms, terms of skipped measurements drop out
+    uint32_t t = bme280_oversampling(my_chip->settings->osrs_t);
+    uint32_t p = bme280_oversampling(my_chip->settings->osrs_p);
+    uint32_t h = bme280_oversampling(my_chip->settings->osrs_h);
+    uint32_t time = 1250 + 2300 * t;
+    if (p != 0){
+        time += 2300 * p + 575;
+    }
+    if (h != 0){
+        time += 2300 * h + 575;
+    }
+    return time;
+}
+
+uint32_t bme280_bus_time_us(struct bme280_model *my_chip){
+    uint32_t baudrate = bme280_i2c_device.max_baudrate;
+    // The burst read of 0xF7 to 0xFE
+    uint32_t time = i2c_stats_wire_time_us(baudrate, 1, 8);
+    if (my_chip->settings->mode != 0b11){
+        // Forced mode has to write ctrl_meas and poll the status register at least once
+        time += i2c_stats_wire_time_us(baudrate, 2, 0) + i2c_stats_wire_time_us(baudrate, 1, 1);
+    }
+    return time;
+}
+
+uint32_t bme280_sample_period_us(struct bme280_model *my_chip){
+    if (my_chip->settings->mode == 0b11){
+        // Normal mode cycles between measuring and standby on its own, BME280_DOC_16
+        return bme280_measurement_time_us(my_chip) + bme280_t_sb_timing_array[my_chip->settings->t_sb & 0x07];
+    }
+    return bme280_measurement_time_us(my_chip) + bme280_bus_time_us(my_chip);
+}
@@ -2,6 +2,7 @@
 // #include "com_protocol.c"
 
 // Define the variables here 
+struct i2c_device bmp180_i2c_device = {.bus = &i2c_bus0, .addr = BMP_180_ADDR, .name = "BMP180", .max_baudrate = I2C_FAST_MODE_BAUDRATE, .retries = I2C_BUS_DEFAULT_RETRIES};
 uint16_t pressure_oss[4] = {0,0,0,0};
 uint16_t pressure_time[4] = {0,0,0,0};
 
@@ -12,7 +13,7 @@ void bmp180_get_cal(struct bmp180_calib_param* params,struct bmp180_model* my_ch
     uint8_t out_buff[BMP_180_N_CAL_PARAMS] = {0};
     uint8_t reg_start = BMP_180_REG_A1_MSB;
 
-    bmp180_i2c_read(BMP_180_ADDR,&reg_start,out_buff,BMP_180_N_CAL_PARAMS,false);
+    i2c_bus_reg_read(&bmp180_i2c_device,reg_start,out_buff,BMP_180_N_CAL_PARAMS);
 
     //Just some basic manipulations
     // Remember MSB is sent first from the stream.
@@ -64,7 +65,7 @@ void bmp180_init(struct bmp180_model* my_chip, struct bmp180_calib_param* my_par
     uint8_t chipID[1];
     uint8_t addr = BMP_180_CHIP_ID_ADDR;
 
-    bmp180_i2c_read(BMP_180_ADDR,&addr,chipID,1,false);
+    i2c_bus_reg_read(&bmp180_i2c_device,addr,chipID,1);
 
     if (chipID[0] != BMP_180_CHIP_ID){
         while (true){
@@ -85,6 +86,7 @@ void bmp180_init(struct bmp180_model* my_chip, struct bmp180_calib_param* my_par
     my_chip->chipID = chipID[0];
     //Assign the input measurement structure to the chip structure
     my_chip->measurement_params = measures;
+    seqlock_init(&my_chip->sample_lock);
     #if BMP_180_COM_PROTO_ENABLE
     my_chip->m = 1; // Assigns the value for the m argument
     my_chip->v = 0;
@@ -95,44 +97,72 @@ void bmp180_init(struct bmp180_model* my_chip, struct bmp180_calib_param* my_par
 
 //Here we follow the use case in BMP180_DOC_15. This function is meant to be called by the main temp processing function.
 void bmp180_get_ut(struct bmp180_model* my_chip){
+    bmp180_start_ut(my_chip);
+    //We wait the conversion time
+    sleep_us(bmp180_ut_wait_us());
+    bmp180_read_ut(my_chip);
+}
+
+void bmp180_start_ut(struct bmp180_model* my_chip){
     //First write to begin temp sampling
     uint8_t write_buff[2];
-    uint8_t read_buff[2];
     write_buff[0] = BMP_180_REG_CTRL_MEAS; //We first tell it to write to this register
     write_buff[1] = BMP_180_SET_TMP; //We tell it then to write this value to it
     //Tell the bmp180 to start sampling temperature
-    bmp180_i2c_write(BMP_180_ADDR,write_buff,2,false); //No blocking
-    //We wait the conversion time
-    sleep_ms(BMP_180_TMP_TIME*2); //Wait twice as long for safety
+    i2c_bus_write(&bmp180_i2c_device,write_buff,2,false); //No blocking
+}
+
+void bmp180_read_ut(struct bmp180_model* my_chip){
+    uint8_t read_buff[2];
     //Read the values now, optionally we should check if bit sco is still set BMP180_DOC_18
     uint8_t addr = BMP_180_REG_OUT_MSB;
-    bmp180_i2c_read(BMP_180_ADDR,&addr,read_buff,2,false);//Release control
+    i2c_bus_reg_read(&bmp180_i2c_device,addr,read_buff,2);//Release control
     //Assign our results
     my_chip->measurement_params->ut = (read_buff[0] << 8) | read_buff[1]; //Remember MSB first
 }
 
+uint32_t bmp180_ut_wait_us(){
+    return BMP_180_TMP_TIME * 2 * 1000; //Wait twice as long for safety
+}
+
 void bmp180_get_up(struct bmp180_model* my_chip){
-    //First write to begin temp sampling
+    bmp180_start_up(my_chip);
+    //We wait the conversion time based on the OSS sampling setting
+    sleep_us(bmp180_up_wait_us());
+    bmp180_read_up(my_chip);
+}
+
+void bmp180_start_up(struct bmp180_model* my_chip){
+    //First write to begin pressure sampling
     uint8_t write_buff[2];
-    uint8_t read_buff[3];
     write_buff[0] = BMP_180_REG_CTRL_MEAS; //We first tell it to write to this register
     write_buff[1] = pressure_oss[BMP_180_OSS]; //We tell it then to write this value to it
     //Tell the bmp180 to start sampling pressure
-    bmp180_i2c_write(BMP_180_ADDR,write_buff,2,false); //No blocking
-    //We wait the conversion time based on the OSS sampling setting
-    sleep_ms(pressure_time[BMP_180_OSS]*3); //Wait twice as long for safety
+    i2c_bus_write(&bmp180_i2c_device,write_buff,2,false); //No blocking
+}
+
+void bmp180_read_up(struct bmp180_model* my_chip){
+    uint8_t read_buff[3];
     //Read the values now, optionally we should check if bit sco is still set BMP180_DOC_18
     //Checking for the bit ensures full conversion is done.
     uint8_t addr = BMP_180_REG_OUT_MSB;
-    bmp180_i2c_read(BMP_180_ADDR,&addr,read_buff,3,false);//We also read the XLSB 
+    i2c_bus_reg_read(&bmp180_i2c_device,addr,read_buff,3);//We also read the XLSB 
     //Read in the final results
     //Equation is given at BMP180_DOC_15. 
     my_chip->measurement_params->up = ((read_buff[0] << 16) | (read_buff[1] << 8) | read_buff[2]) >> (8 - BMP_180_OSS);//Remember MSB first
 }
 
+uint32_t bmp180_up_wait_us(){
+    return pressure_time[BMP_180_OSS] * 3 * 1000; //Wait three times as long for safety
+}
+
 void bmp180_get_temp(struct bmp180_model* my_chip){
     //First read in the raw value
     bmp180_get_ut(my_chip);
+    bmp180_compensate_temp(my_chip);
+}
+
+void bmp180_compensate_temp(struct bmp180_model* my_chip){
     //Calculation outlined in BMP180_DOC_15
     my_chip->measurement_params->X1_tmp = ((my_chip->measurement_params->ut - my_chip->cal_params->AC6) * my_chip->cal_params->AC5) >> 15; //Remember >>15 = /2^15
     my_chip->measurement_params->X2_tmp = (my_chip->cal_params->MC << 11)/(my_chip->measurement_params->X1_tmp+my_chip->cal_params->MD);
@@ -145,6 +175,10 @@ void bmp180_get_temp(struct bmp180_model* my_chip){
 void bmp180_get_pressure(struct bmp180_model* my_chip){
     //First read in the raw data
     bmp180_get_up(my_chip);
+    bmp180_compensate_pressure(my_chip);
+}
+
+void bmp180_compensate_pressure(struct bmp180_model* my_chip){
     //Calculation outlined in BMP180_DOC_15.
     //Example code can be seen at https://github.com/BoschSensortec/BMP180_driver
     //Unfortunately the reasoning behind the calculations seem to be proprietary https://community.bosch-sensortec.com/t5/MEMS-sensors-forum/BMP180-datasheet/m-p/7503#M454
@@ -175,6 +209,36 @@ void bmp180_get_pressure(struct bmp180_model* my_chip){
     my_chip->measurement_params->p_sum += my_chip->measurement_params->p_inter + (long)(((float)(my_chip->measurement_params->X1_p_4 + my_chip->measurement_params->X2_p_3 + 3791))/powf((float)2, (float) 4));
 }
 
+void bmp180_compensate(struct bmp180_model* my_chip){
+    // One conversion, so the sums are the values
+    my_chip->measurement_params->T_sum = 0;
+    my_chip->measurement_params->p_sum = 0;
+    bmp180_compensate_temp(my_chip);
+    bmp180_compensate_pressure(my_chip);
+    my_chip->measurement_params->T = my_chip->measurement_params->T_sum;
+    my_chip->measurement_params->p = my_chip->measurement_params->p_sum;
+}
+
+void bmp180_publish_at(struct bmp180_model* my_chip, uint32_t time_us){
+    struct bmp180_sample sample = {
+        time_us,
+        (int32_t) my_chip->measurement_params->T,
+        (int32_t) my_chip->measurement_params->p,
+        my_chip->measurement_params->altitude,
+        my_chip->measurement_params->p_relative,
+    };
+    seqlock_write(&my_chip->sample_lock, &my_chip->sample, &sample, sizeof(sample));
+}
+
+// Publishes the final values of measurement_params, stamped now
+static void bmp180_publish(struct bmp180_model* my_chip){
+    bmp180_publish_at(my_chip, time_us_32());
+}
+
+bool bmp180_read_sample(struct bmp180_model* my_chip, struct bmp180_sample* sample){
+    return seqlock_read(&my_chip->sample_lock, sample, &my_chip->sample, sizeof(struct bmp180_sample));
+}
+
 void bmp180_get_temp_pressure(struct bmp180_model* my_chip)
 {
     // So this is basic wrapper 
@@ -182,15 +246,20 @@ void bmp180_get_temp_pressure(struct bmp180_model* my_chip)
     bmp180_get_pressure(my_chip);
 }
 
+float bmp180_altitude_from_pressure(long p){
+    //The following altitude calculations are defined in BMP180_DOC_16
+    float p_ratio = (float) ( (float) p/BMP_180_SEA_PRESSURE);
+    float inter_term = (float) (1- powf(p_ratio,(float) (1/5.255)));
+    return (float) ( (float) 44330 *inter_term);
+}
+
 void bmp180_get_altitude(struct bmp180_model* my_chip)
 {
     // We need to first get measurements
     bmp180_get_measurement(my_chip);
-    //The following altitude calculations are defined in BMP180_DOC_16
-    float p_ratio = (float) ( (float) my_chip->measurement_params->p/BMP_180_SEA_PRESSURE);
-    float inter_term = (float) (1- powf(p_ratio,(float) (1/5.255)));
     // Assign the altitude
-    my_chip->measurement_params->altitude = (float) ( (float) 44330 *inter_term);
+    my_chip->measurement_params->altitude = bmp180_altitude_from_pressure(my_chip->measurement_params->p);
+    bmp180_publish(my_chip);
 
     // Debug lines
     #if BMP_180_DEBUG_MODE 
@@ -203,6 +272,7 @@ void bmp180_get_sea_pressure(struct bmp180_model* my_chip){
     bmp180_get_measurement(my_chip);
     //The following calculations are defined in BMP180_DOC_17
     my_chip->measurement_params->p_relative = (float) ((float) my_chip->measurement_params->p/(powf((float) (1 - ((float) BMP_180_CENTURION_HEIGHT/(float) 44330)),5.255)));
+    bmp180_publish(my_chip);
 
     // Debug lines
     #if BMP_180_DEBUG_MODE 
@@ -225,6 +295,7 @@ void bmp180_get_measurement(struct bmp180_model* my_chip){
     // We then divide by the sampling size variable
     my_chip->measurement_params->p = (long ) (my_chip->measurement_params->p_sum/BMP_180_SS);
     my_chip->measurement_params->T = (long ) (my_chip->measurement_params->T_sum/BMP_180_SS);
+    bmp180_publish(my_chip);
 
     //Print the results
     #if BMP_180_DEBUG_MODE 
@@ -233,3 +304,15 @@ void bmp180_get_measurement(struct bmp180_model* my_chip){
     #endif
 }
 
+uint32_t bmp180_conversion_time_us(struct bmp180_model* my_chip){
+    // Same waits as bmp180_get_ut and bmp180_get_up
+    return BMP_180_SS * (bmp180_ut_wait_us() + bmp180_up_wait_us());
+}
+
+uint32_t bmp180_bus_time_us(struct bmp180_model* my_chip){
+    // Per sample: start the temperature conversion, read 2 bytes, start the pressure conversion, read 3 bytes
+    uint32_t baudrate = bmp180_i2c_device.max_baudrate;
+    uint32_t per_sample = i2c_stats_wire_time_us(baudrate, 2, 0) + i2c_stats_wire_time_us(baudrate, 1, 2)
+                        + i2c_stats_wire_time_us(baudrate, 2, 0) + i2c_stats_wire_time_us(baudrate, 1, 3);
+    return BMP_180_SS * per_sample;
+}
@@ -0,0 +1,145 @@
+#include "../include/cmd_token.h"
+
+// True when c is past the line
+static inline bool cmd_token_at_end(const char *c, const char *end){
+    return (c >= end) || (*c == '\0');
+}
+
+// Value of the digit c in base, -1 if it is not one
+static int cmd_token_digit(char c, uint8_t base){
+    if ((c >= '0') && (c <= '9')){
+        return c - '0';
+    }
+    if (base == 16){
+        if ((c >= 'a') && (c <= 'f')){
+            return c - 'a' + 10;
+        }
+        if ((c >= 'A') && (c <= 'F')){
+            return c - 'A' + 10;
+        }
+    }
+    return -1;
+}
+
+// Parses the number starting at c, with digits starting at p. Falls back to a word if a character does not fit.
+static const char *cmd_token_number(const char *c, const char *p, const char *end, bool negative, struct cmd_token *token){
+    uint8_t base = 10;
+    if ((p[0] == '0') && !cmd_token_at_end(p + 1, end) && ((p[1] == 'x') || (p[1] == 'X'))){
+        base = 16;
+        p += 2;
+    }
+    // One above INT32_MAX is allowed for the negative end of the range
+    const uint64_t limit = negative ? ((uint64_t) INT32_MAX + 1) : (uint64_t) INT32_MAX;
+    uint64_t magnitude = 0;
+    bool has_digits = false;
+    uint8_t decimals = 0;
+    bool fixed = false;
+    bool valid = true;
+    bool overflow = false;
+
+    for (; !cmd_token_at_end(p, end) && (*p != ' '); p++){
+        int digit = cmd_token_digit(*p, base);
+        if (digit >= 0){
+            has_digits = true;
+            // Decimals past what the fixed point keeps are dropped, stop adding once out of range
+            if ((!fixed || (decimals < CMD_TOKEN_FIXED_DECIMALS)) && !overflow){
+                magnitude = magnitude * base + (uint64_t) digit;
+                overflow = magnitude > limit;
+                if (fixed){
+                    decimals++;
+                }
+            }
+        }
+        else if ((*p == '.') && (base == 10) && !fixed){
+            fixed = true;
+        }
+        else {
+            valid = false;
+        }
+    }
+
+    token->start = c;
+    token->len = (uint16_t) (p - c);
+    if (!valid || !has_digits){
+        token->type = CMD_TOKEN_WORD;
+        return p;
+    }
+    if (fixed){
+        for (; decimals < CMD_TOKEN_FIXED_DECIMALS; decimals++){
+            magnitude *= 10;
+        }
+    }
+    if (overflow || (magnitude > limit)){
+        token->type = CMD_TOKEN_ERROR;
+        return p;
+    }
+    token->type = fixed ? CMD_TOKEN_FIXED : CMD_TOKEN_INT;
+    token->value = (int32_t) (negative ? -(int64_t) magnitude : (int64_t) magnitude);
+    return p;
+}
+
+bool cmd_token_next(const char **cursor, const char *end, struct cmd_token *token){
+    const char *c = *cursor;
+    while (!cmd_token_at_end(c, end) && (*c == ' ')){
+        c++;
+    }
+    if (cmd_token_at_end(c, end)){
+        *cursor = c;
+        return false;
+    }
+    token->value = 0;
+
+    // Quoted string, runs until the closing quote spaces included
+    if (*c == '"'){
+        token->start = ++c;
+        while (!cmd_token_at_end(c, end) && (*c != '"')){
+            c++;
+        }
+        token->len = (uint16_t) (c - token->start);
+        if (cmd_token_at_end(c, end)){
+            token->type = CMD_TOKEN_ERROR;
+        }
+        else {
+            token->type = CMD_TOKEN_STRING;
+            c++;
+        }
+        *cursor = c;
+        return true;
+    }
+
+    // Number, optionally signed
+    const char *p = c;
+    bool negative = false;
+    if (((*p == '+') || (*p == '-')) && !cmd_token_at_end(p + 1, end) && (cmd_token_digit(p[1], 10) >= 0)){
+        negative = *p == '-';
+        p++;
+    }
+    if (cmd_token_digit(*p, 10) >= 0){
+        *cursor = cmd_token_number(c, p, end, negative, token);
+        return true;
+    }
+
+    // Options and words
+    if ((*c == '-') && !cmd_token_at_end(c + 1, end) && (c[1] == '-')){
+        token->type = CMD_TOKEN_LONG_OPT;
+        token->start = c + 2;
+    }
+    else if (*c == '-'){
+        token->type = CMD_TOKEN_SHORT_OPTS;
+        token->start = c + 1;
+    }
+    else {
+        token->type = CMD_TOKEN_WORD;
+        token->start = c;
+    }
+    while (!cmd_token_at_end(c, end) && (*c != ' ')){
+        c++;
+    }
+    token->len = (uint16_t) (c - token->start);
+    *cursor = c;
+    return true;
+}
+
+bool cmd_token_equals(const struct cmd_token *token, const char *str){
+    return (strncmp(token->start, str, token->len) == 0) && (str[token->len] == '\0');
+}
@@ -0,0 +1,231 @@
+#include "../include/com_binary.h"
+
+#if PICO_ON_DEVICE
+#include "pico/stdio_usb.h"
+#endif
+
+static struct com_binary com_binary;
+
+// CRC16-CCITT a nibble at a time
+static const uint16_t com_binary_crc_table[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7,
+    0x8108, 0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad, 0xe1ce, 0xf1ef,
+};
+
+uint16_t com_binary_crc16(const uint8_t *data, uint16_t len){
+    uint16_t crc = 0xffff;
+    for (uint16_t i = 0; i < len; i++){
+        crc = (uint16_t) ((crc << 4) ^ com_binary_crc_table[(crc >> 12) ^ (data[i] >> 4)]);
+        crc = (uint16_t) ((crc << 4) ^ com_binary_crc_table[(crc >> 12) ^ (data[i] & 0x0f)]);
+    }
+    return crc;
+}
+
+uint16_t com_binary_cobs_encode(const uint8_t *src, uint16_t len, uint8_t *dst){
+    uint16_t code_index = 0; // Where the length of the current block goes
+    uint16_t out = 1;
+    uint8_t code = 1;
+    for (uint16_t i = 0; i < len; i++){
+        if (src[i] == 0){
+            dst[code_index] = code;
+            code_index = out++;
+            code = 1;
+            continue;
+        }
+        dst[out++] = src[i];
+        code++;
+        if (code == 0xff){
+            // Longest block, start a new one
+            dst[code_index] = code;
+            code_index = out++;
+            code = 1;
+        }
+    }
+    dst[code_index] = code;
+    return out;
+}
+
+int com_binary_cobs_decode(const uint8_t *src, uint16_t len, uint8_t *dst){
+    uint16_t in = 0;
+    uint16_t out = 0;
+    while (in < len){
+        uint8_t code = src[in++];
+        if ((code == 0) || ((uint16_t) (in + code - 1) > len)){
+            return -1;
+        }
+        for (uint8_t i = 1; i < code; i++){
+            if (src[in] == 0){
+                return -1;
+            }
+            dst[out++] = src[in++];
+        }
+        // A block shorter than 0xff stands for a zero, unless it ends the frame
+        if ((code != 0xff) && (in < len)){
+            dst[out++] = 0;
+        }
+    }
+    return out;
+}
+
+uint8_t *com_binary_put_u16(uint8_t *dst, uint16_t value){
+    dst[0] = (uint8_t) value;
+    dst[1] = (uint8_t) (value >> 8);
+    return dst + 2;
+}
+
+uint8_t *com_binary_put_u32(uint8_t *dst, uint32_t value){
+    dst[0] = (uint8_t) value;
+    dst[1] = (uint8_t) (value >> 8);
+    dst[2] = (uint8_t) (value >> 16);
+    dst[3] = (uint8_t) (value >> 24);
+    return dst + 4;
+}
+
+// Puts bytes on the link as is
+static void com_binary_write(const uint8_t *buf, uint16_t len){
+    #if PICO_ON_DEVICE
+    stdio_usb.out_chars((const char *) buf, len);
+    #else
+    fwrite(buf, 1, len, stdout);
+    fflush(stdout);
+    #endif
+}
+
+// Encodes and sends one frame. Holds tx_mutex.
+static void com_binary_send_locked(uint8_t type, uint8_t seq, const uint8_t *data, uint16_t len){
+    // Payload and CRC are put together, then encoded into tx_frame
+    uint8_t payload[COM_BIN_MAX_PAYLOAD + 2];
+    payload[0] = type;
+    payload[1] = seq;
+    if (len > 0){
+        memcpy(&payload[COM_BIN_HEADER_LEN], data, len);
+    }
+    uint16_t payload_len = COM_BIN_HEADER_LEN + len;
+    com_binary_put_u16(&payload[payload_len], com_binary_crc16(payload, payload_len));
+    uint16_t frame_len = com_binary_cobs_encode(payload, payload_len + 2, com_binary.tx_frame);
+    com_binary.tx_frame[frame_len++] = 0;
+    com_binary_write(com_binary.tx_frame, frame_len);
+}
+
+void com_binary_send(uint8_t type, uint8_t seq, const uint8_t *data, uint16_t len){
+    if (len > (COM_BIN_MAX_PAYLOAD - COM_BIN_HEADER_LEN)){
+        len = COM_BIN_MAX_PAYLOAD - COM_BIN_HEADER_LEN;
+    }
+    mutex_enter_blocking(&com_binary.tx_mutex);
+    com_binary_send_locked(type, seq, data, len);
+    mutex_exit(&com_binary.tx_mutex);
+}
+
+// Frames sent on our own count up
+static void com_binary_send_unsolicited(uint8_t type, const uint8_t *data, uint16_t len){
+    mutex_enter_blocking(&com_binary.tx_mutex);
+    com_binary_send_locked(type, com_binary.tx_seq++, data, len);
+    mutex_exit(&com_binary.tx_mutex);
+}
+
+void com_binary_send_sample(uint8_t sensor, uint8_t quantity, uint32_t time_us, int32_t value){
+    uint8_t data[COM_BIN_SAMPLE_LEN];
+    data[0] = sensor;
+    data[1] = quantity;
+    uint8_t *next = com_binary_put_u32(&data[2], time_us);
+    com_binary_put_u32(next, (uint32_t) value);
+    com_binary_send_unsolicited(COM_BIN_MSG_SAMPLE, data, COM_BIN_SAMPLE_LEN);
+}
+
+#if PICO_ON_DEVICE
+// stdio driver used while in binary mode. Output is wrapped in COM_BIN_MSG_TEXT frames, input is the USB as is.
+static void com_binary_text_out(const char *buf, int len){
+    while (len > 0){
+        uint16_t chunk = (len > (int) (COM_BIN_MAX_PAYLOAD - COM_BIN_HEADER_LEN)) ? (COM_BIN_MAX_PAYLOAD - COM_BIN_HEADER_LEN) : (uint16_t) len;
+        com_binary_send_unsolicited(COM_BIN_MSG_TEXT, (const uint8_t *) buf, chunk);
+        buf += chunk;
+        len -= chunk;
+    }
+}
+
+static int com_binary_text_in(char *buf, int len){
+    return stdio_usb.in_chars(buf, len);
+}
+
+static stdio_driver_t com_binary_stdio = {
+    .out_chars = com_binary_text_out,
+    .in_chars = com_binary_text_in,
+};
+#endif
+
+void com_binary_init(){
+    mutex_init(&com_binary.tx_mutex);
+    com_binary.active = false;
+    com_binary.tx_seq = 0;
+    com_binary.rx_len = 0;
+    com_binary.rx_overflow = false;
+}
+
+void com_binary_enter(){
+    #if COM_BIN_INFO
+    printf("[COM_BIN]: Entering binary mode.\r\n");
+    #endif
+    com_binary.rx_len = 0;
+    com_binary.rx_overflow = false;
+    #if PICO_ON_DEVICE
+    // Every printf from here on goes out as a text frame
+    stdio_set_driver_enabled(&com_binary_stdio, true);
+    stdio_filter_driver(&com_binary_stdio);
+    #endif
+    com_binary.active = true;
+}
+
+void com_binary_exit(){
+    com_binary.active = false;
+    #if PICO_ON_DEVICE
+    stdio_filter_driver(NULL);
+    stdio_set_driver_enabled(&com_binary_stdio, false);
+    #endif
+    #if COM_BIN_INFO
+    printf("[COM_BIN]: Back to text mode.\r\n");
+    #endif
+}
+
+bool com_binary_active(){
+    return com_binary.active;
+}
+
+// Checks and decodes a received frame into payload. Answers bad ones.
+static bool com_binary_decode(uint8_t *payload, uint16_t *len){
+    if (com_binary.rx_overflow || (com_binary.rx_len < (COM_BIN_HEADER_LEN + 2))){
+        com_binary_send_unsolicited(COM_BIN_MSG_ERROR, (const uint8_t []) {COM_BIN_ERR_LENGTH}, 1);
+        return false;
+    }
+    uint8_t decoded[COM_BIN_MAX_FRAME];
+    int decoded_len = com_binary_cobs_decode(com_binary.rx_frame, com_binary.rx_len, decoded);
+    if ((decoded_len < (int) (COM_BIN_HEADER_LEN + 2)) || (decoded_len > (int) (COM_BIN_MAX_PAYLOAD + 2))){
+        com_binary_send_unsolicited(COM_BIN_MSG_ERROR, (const uint8_t []) {COM_BIN_ERR_COBS}, 1);
+        return false;
+    }
+    uint16_t payload_len = (uint16_t) decoded_len - 2;
+    uint16_t crc = (uint16_t) (decoded[payload_len] | (decoded[payload_len + 1] << 8));
+    if (crc != com_binary_crc16(decoded, payload_len)){
+        com_binary_send_unsolicited(COM_BIN_MSG_ERROR, (const uint8_t []) {COM_BIN_ERR_CRC}, 1);
+        return false;
+    }
+    memcpy(payload, decoded, payload_len);
+    *len = payload_len;
+    return true;
+}
+
+bool com_binary_feed(uint8_t byte, uint8_t *payload, uint16_t *len){
+    if (byte == 0){
+        // End of a frame
+        bool valid = (com_binary.rx_len > 0) && com_binary_decode(payload, len);
+        com_binary.rx_len = 0;
+        com_binary.rx_overflow = false;
+        return valid;
+    }
+    if (com_binary.rx_len < sizeof(com_binary.rx_frame)){
+        com_binary.rx_frame[com_binary.rx_len++] = byte;
+    }
+    else {
+        com_binary.rx_overflow = true;
+    }
+    return false;
+}
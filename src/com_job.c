@@ -0,0 +1,270 @@
+#include "../include/com_job.h"
+#include "../include/stream.h"
+#include "../include/pico_rtc.h"
+
+// Payloads and the list of free ones. The free list is a queue so both cores can use it without a lock.
+static struct com_payload com_job_pool[COM_JOB_POOL_LEN];
+static queue_t com_job_free;
+
+struct com_payload *com_job_payload_alloc(){
+    struct com_payload *payload;
+    queue_remove_blocking(&com_job_free, &payload);
+    return payload;
+}
+
+void com_job_payload_free(struct com_payload *payload){
+    if (payload != NULL){
+        queue_add_blocking(&com_job_free, &payload);
+    }
+}
+
+// Queues a result with a payload from the pool that the caller filled in
+static void com_job_publish(uint8_t kind, const struct com_job *job, struct com_payload *payload){
+    struct com_result result = {kind, job->flags, time_us_32(), payload};
+    queue_add_blocking(&results_queue, &result);
+}
+
+// Copies the measurements of the BMP180 and queues them as kind
+static void com_job_publish_bmp180(uint8_t kind, const struct com_job *job){
+    struct bmp180_model *chip = (struct bmp180_model *) job->handle;
+    struct com_payload *payload = com_job_payload_alloc();
+    memcpy(&payload->bmp180, chip->measurement_params, sizeof(struct bmp180_measurements));
+    com_job_publish(kind, job, payload);
+}
+
+// Job handlers, run by main
+
+static void com_job_bmp180_measure(const struct com_job *job){
+    bmp180_get_measurement((struct bmp180_model *) job->handle);
+    com_job_publish_bmp180(COM_RES_BMP180_MEASURE, job);
+}
+
+static void com_job_bmp180_altitude(const struct com_job *job){
+    bmp180_get_altitude((struct bmp180_model *) job->handle);
+    com_job_publish_bmp180(COM_RES_BMP180_ALTITUDE, job);
+}
+
+static void com_job_bmp180_sea_pressure(const struct com_job *job){
+    bmp180_get_sea_pressure((struct bmp180_model *) job->handle);
+    com_job_publish_bmp180(COM_RES_BMP180_SEA_PRESSURE, job);
+}
+
+static void com_job_eeprom_dump(const struct com_job *job){
+    // The dump streams its own output while reading, nothing to queue
+    lcb16b_eeprom_dump((struct lcb16b_eeprom *) job->handle);
+}
+
+static void com_job_log_append(const struct com_job *job){
+    struct eeprom_log *log = (struct eeprom_log *) job->handle;
+    // Only main touches the query fields of the log
+    log->q_value = job->params.value;
+    sample_pico_rtc(&my_datetime);
+    int status = eeprom_log_append(log, eeprom_log_timestamp(my_datetime.day, my_datetime.hour, my_datetime.min, my_datetime.sec), log->q_value);
+
+    struct com_payload *payload = com_job_payload_alloc();
+    payload->log_append.value = log->q_value;
+    payload->log_append.count = log->count;
+    payload->log_append.status = status;
+    com_job_publish(COM_RES_LOG_APPEND, job, payload);
+}
+
+static void com_job_log_query(const struct com_job *job){
+    struct eeprom_log *log = (struct eeprom_log *) job->handle;
+    log->q_start = job->params.query.start;
+    log->q_end = job->params.query.end;
+    log->q_aggregate = job->params.query.aggregate;
+    int status = eeprom_log_query(log);
+
+    struct com_payload *payload = com_job_payload_alloc();
+    struct com_log_query_payload *query = &payload->log_query;
+    query->status = status;
+    query->n_results = log->n_results;
+    query->n_matched = log->n_matched;
+    query->count = log->count;
+    query->aggregate = log->q_aggregate;
+    query->min = log->min;
+    query->max = log->max;
+    query->mean = log->mean;
+    // Aggregates have no samples to copy
+    if (!query->aggregate){
+        memcpy(query->results, log->results, log->n_results * sizeof(struct eeprom_log_sample));
+    }
+    com_job_publish(COM_RES_LOG_QUERY, job, payload);
+}
+
+static void com_job_i2c_probe(const struct com_job *job){
+    struct i2c_probe *probe = (struct i2c_probe *) job->handle;
+    i2c_probe_chips(probe);
+
+    struct com_payload *payload = com_job_payload_alloc();
+    memcpy(&payload->probe, probe, sizeof(struct i2c_probe));
+    com_job_publish(COM_RES_I2C_PROBE, job, payload);
+}
+
+static void com_job_stream_start(const struct com_job *job){
+    stream_start((struct stream *) job->handle);
+}
+
+static void com_job_stream_stop(const struct com_job *job){
+    stream_stop((struct stream *) job->handle);
+}
+
+static void com_job_stream_sample(const struct com_job *job){
+    stream_sample((struct stream *) job->handle);
+}
+
+static void com_job_pipeline_start(const struct com_job *job){
+    pipeline_start((struct pipeline *) job->handle);
+}
+
+static void com_job_pipeline_stop(const struct com_job *job){
+    pipeline_stop((struct pipeline *) job->handle);
+}
+
+static void com_job_pipeline_acquire(const struct com_job *job){
+    pipeline_acquire((struct pipeline *) job->handle);
+}
+
+static void com_job_pipeline_bench(const struct com_job *job){
+    struct com_payload *payload = com_job_payload_alloc();
+    pipeline_bench((struct pipeline *) job->handle, job->params.value, &payload->pipe_bench);
+    com_job_publish(COM_RES_PIPELINE_BENCH, job, payload);
+}
+
+static void com_job_sched_stats(const struct com_job *job){
+    struct com_payload *payload = com_job_payload_alloc();
+    task_sched_snapshot((struct task_sched *) job->handle, &payload->sched);
+    com_job_publish(COM_RES_SCHED_STATS, job, payload);
+}
+
+static void com_job_sched_reset(const struct com_job *job){
+    task_sched_reset((struct task_sched *) job->handle);
+}
+
+static void com_job_sched_period(const struct com_job *job){
+    task_sched_set_period((struct task_sched *) job->handle, job->params.task.index, job->params.task.period_us);
+}
+
+// Indexed by COM_JOB_*
+static void (*const com_job_handlers[COM_N_JOB])(const struct com_job *job) = {
+    [COM_JOB_BMP180_MEASURE] = &com_job_bmp180_measure,
+    [COM_JOB_BMP180_ALTITUDE] = &com_job_bmp180_altitude,
+    [COM_JOB_BMP180_SEA_PRESSURE] = &com_job_bmp180_sea_pressure,
+    [COM_JOB_EEPROM_DUMP] = &com_job_eeprom_dump,
+    [COM_JOB_LOG_APPEND] = &com_job_log_append,
+    [COM_JOB_LOG_QUERY] = &com_job_log_query,
+    [COM_JOB_I2C_PROBE] = &com_job_i2c_probe,
+    [COM_JOB_STREAM_START] = &com_job_stream_start,
+    [COM_JOB_STREAM_STOP] = &com_job_stream_stop,
+    [COM_JOB_STREAM_SAMPLE] = &com_job_stream_sample,
+    [COM_JOB_PIPELINE_START] = &com_job_pipeline_start,
+    [COM_JOB_PIPELINE_STOP] = &com_job_pipeline_stop,
+    [COM_JOB_PIPELINE_ACQUIRE] = &com_job_pipeline_acquire,
+    [COM_JOB_PIPELINE_BENCH] = &com_job_pipeline_bench,
+    [COM_JOB_SCHED_STATS] = &com_job_sched_stats,
+    [COM_JOB_SCHED_RESET] = &com_job_sched_reset,
+    [COM_JOB_SCHED_PERIOD] = &com_job_sched_period,
+};
+
+void com_job_dispatch(const struct com_job *job){
+    if (job->op >= COM_N_JOB){
+        #if COM_JOB_DEBUG
+        printf("Invalid job %u entered to com_job_dispatch.\r\n", job->op);
+        #endif
+        return;
+    }
+    com_job_handlers[job->op](job);
+}
+
+// Result printers, run by core1
+
+static void com_result_print_bmp180_measure(const struct com_result *result){
+    uint8_t v = (result->flags & COM_JOB_VERBOSE) ? 1 : 0;
+    print_temp_results_bmp180(&result->payload->bmp180, v);
+    print_press_results_bmp180(&result->payload->bmp180, v);
+}
+
+static void com_result_print_bmp180_altitude(const struct com_result *result){
+    print_altitude_results_bmp180(&result->payload->bmp180);
+}
+
+static void com_result_print_bmp180_sea_pressure(const struct com_result *result){
+    print_relative_pressure_results_bmp180(&result->payload->bmp180);
+}
+
+static void com_result_print_log_query(const struct com_result *result){
+    print_eeprom_log_query_results(&result->payload->log_query);
+}
+
+static void com_result_print_log_append(const struct com_result *result){
+    print_eeprom_log_append_results(&result->payload->log_append);
+}
+
+static void com_result_print_i2c_probe(const struct com_result *result){
+    print_i2c_probe_results(&result->payload->probe);
+}
+
+static void com_result_print_pipeline_bench(const struct com_result *result){
+    print_pipeline_bench_results(&result->payload->pipe_bench);
+}
+
+static void com_result_print_sched_stats(const struct com_result *result){
+    print_sched_stats(&result->payload->sched);
+}
+
+// Binary mode forms, sent as COM_BIN_MSG_SAMPLE frames
+
+static void com_result_send_bmp180_measure(const struct com_result *result){
+    com_binary_send_sample(COM_BIN_SENSOR_BMP180, COM_BIN_Q_TEMPERATURE, result->time_us, (int32_t) result->payload->bmp180.T);
+    com_binary_send_sample(COM_BIN_SENSOR_BMP180, COM_BIN_Q_PRESSURE, result->time_us, (int32_t) result->payload->bmp180.p);
+}
+
+static void com_result_send_bmp180_altitude(const struct com_result *result){
+    com_binary_send_sample(COM_BIN_SENSOR_BMP180, COM_BIN_Q_ALTITUDE, result->time_us, (int32_t) (result->payload->bmp180.altitude * 1000.0f));
+}
+
+static void com_result_send_bmp180_sea_pressure(const struct com_result *result){
+    com_binary_send_sample(COM_BIN_SENSOR_BMP180, COM_BIN_Q_SEA_PRESSURE, result->time_us, (int32_t) result->payload->bmp180.p_relative);
+}
+
+// Indexed by COM_RES_*. Kinds without a binary form print as they are, their text goes out in text frames.
+static const struct {
+    void (*print)(const struct com_result *result);
+    void (*send)(const struct com_result *result);
+} com_result_routes[COM_N_RES] = {
+    [COM_RES_BMP180_MEASURE] = {&com_result_print_bmp180_measure, &com_result_send_bmp180_measure},
+    [COM_RES_BMP180_ALTITUDE] = {&com_result_print_bmp180_altitude, &com_result_send_bmp180_altitude},
+    [COM_RES_BMP180_SEA_PRESSURE] = {&com_result_print_bmp180_sea_pressure, &com_result_send_bmp180_sea_pressure},
+    [COM_RES_LOG_QUERY] = {&com_result_print_log_query, NULL},
+    [COM_RES_LOG_APPEND] = {&com_result_print_log_append, NULL},
+    [COM_RES_I2C_PROBE] = {&com_result_print_i2c_probe, NULL},
+    [COM_RES_PIPELINE_BENCH] = {&com_result_print_pipeline_bench, NULL},
+    [COM_RES_SCHED_STATS] = {&com_result_print_sched_stats, NULL},
+};
+
+void com_result_route(const struct com_result *result){
+    if (result->kind < COM_N_RES){
+        if (com_binary_active() && (com_result_routes[result->kind].send != NULL)){
+            com_result_routes[result->kind].send(result);
+        }
+        else {
+            com_result_routes[result->kind].print(result);
+        }
+    }
+    #if COM_JOB_DEBUG
+    else {
+        printf("Invalid result %u entered to com_result_route.\r\n", result->kind);
+    }
+    #endif
+    com_job_payload_free(result->payload);
+}
+
+void com_job_init(){
+    queue_init(&call_queue, sizeof(struct com_job), COM_PROTO_QUEUE_LEN);
+    queue_init(&results_queue, sizeof(struct com_result), COM_PROTO_QUEUE_LEN);
+    queue_init(&com_job_free, sizeof(struct com_payload *), COM_JOB_POOL_LEN);
+    for (uint8_t i = 0; i < COM_JOB_POOL_LEN; i++){
+        struct com_payload *payload = &com_job_pool[i];
+        queue_add_blocking(&com_job_free, &payload);
+    }
+}
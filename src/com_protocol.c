@@ -1,45 +1,131 @@
 #include "../include/com_protocol.h"
+#include "../include/eeprom_log.h"
+#include "../include/stream.h"
+#include "../include/pipeline.h"
+#include "../include/task_sched.h"
+#include "../include/sensor_pair.h"
+#include "../include/com_job.h"
+
+#if PICO_ON_DEVICE
+// The RX callback reads the CDC FIFO itself
+#include "tusb.h"
+#endif
 
 // TODO find some generic way to initialize cmd by using struct declared in main
-// TODO find out why I get the weird char malloc definitions. exe help)��@(kl
 
 // Define variables here
 queue_t call_queue;
 queue_t results_queue;
+// Probe batch shared by i2c -p and its printer
+static struct i2c_probe i2c_probe_batch;
+// Bytes received over USB, filled by the chars available callback
+static struct com_proto_rx com_proto_rx;
+
+// Long options of the built in binaries
+static const struct cmd_long_opt binary_long_opts[] = {
+    {"help", 'h'},
+};
+static const struct cmd_long_opt bmp180_long_opts[] = {
+    {"altitude", 'a'}, {"calibration", 'c'}, {"help", 'h'}, {"last", 'l'}, {"measure", 'm'}, {"sea-pressure", 's'}, {"verbose", 'v'},
+};
+static const struct cmd_long_opt eeprom_long_opts[] = {
+    {"dump", 'd'}, {"help", 'h'},
+};
+static const struct cmd_long_opt help_long_opts[] = {
+    {"help", 'h'},
+};
+static const struct cmd_long_opt i2c_long_opts[] = {
+    {"bus", 'b'}, {"capture", 'c'}, {"drain", 'd'}, {"help", 'h'}, {"probe", 'p'}, {"reset", 'r'}, {"stats", 's'}, {"wait", 'w'},
+    {"stop", 'x'},
+};
+static const struct cmd_long_opt stream_long_opts[] = {
+    {"altitude", 'a'}, {"status", 'd'}, {"rate", 'f'}, {"help", 'h'}, {"bmp180", 'm'}, {"pressure", 'p'}, {"stop", 's'},
+    {"temperature", 't'}, {"humidity", 'u'},
+};
+static const struct cmd_long_opt log_long_opts[] = {
+    {"aggregate", 'a'}, {"from", 'f'}, {"help", 'h'}, {"query", 'q'}, {"to", 't'}, {"write", 'w'},
+};
+static const struct cmd_long_opt pipe_long_opts[] = {
+    {"bench", 'b'}, {"status", 'd'}, {"bme280", 'e'}, {"rate", 'f'}, {"help", 'h'}, {"bmp180", 'm'}, {"stop", 's'},
+};
+const struct cmd_long_opt sched_long_opts[SCHED_N_LONG_OPTS] = {
+    {"status", 'd'}, {"bme280", 'e'}, {"help", 'h'}, {"bmp180", 'm'}, {"pair", 'p'}, {"reset", 'r'},
+};
+
+#define COM_PROTO_LONG_OPTS(opts) opts, (uint8_t) (sizeof(opts) / sizeof(opts[0]))
+
+// Built in binaries. Keep sorted by name, execute_bin searches them by halving.
+static const bin_executable com_proto_bins[COM_PROTO_N_BIN] = {
+    {&binary_bin, "binary", COM_PROTO_LONG_OPTS(binary_long_opts)},
+    {&bmp180_bin, "bmp180", COM_PROTO_LONG_OPTS(bmp180_long_opts)},
+    {&eeprom_bin, "eeprom", COM_PROTO_LONG_OPTS(eeprom_long_opts)},
+    {&help_bin, "help", COM_PROTO_LONG_OPTS(help_long_opts)},
+    {&i2c_bin, "i2c", COM_PROTO_LONG_OPTS(i2c_long_opts)},
+    {&log_bin, "log", COM_PROTO_LONG_OPTS(log_long_opts)},
+    {&pipe_bin, "pipe", COM_PROTO_LONG_OPTS(pipe_long_opts)},
+    {&stream_bin, "stream", COM_PROTO_LONG_OPTS(stream_long_opts)},
+};
+// Binaries registered at startup, sorted as they are inserted
+static bin_executable com_proto_runtime_bins[COM_PROTO_N_RUNTIME_BIN];
+static uint8_t com_proto_runtime_bins_len = 0;
 
-// Increments some value within a defined space
-uint16_t safe_increment(uint16_t input, uint16_t max){
-    if ( (input + 1) == max)
-        return input;
-    else
-        return input + 1;
+void clean_rx_buff(){
+    // Everything the callback put in so far is forgotten
+    spsc_ring_flush(&com_proto_rx.ring);
+    #if COM_PROTO_INFO
+    printf("RX buffer now clean :D.\r\n");
+    #endif
 }
 
-// Redumentary function to calculate 10^exponent. O(n) so eh?
-uint16_t pow_10(uint8_t exponent){
-    uint16_t output = 1;
-    for (uint8_t i = 0; i < exponent; i++){
-        output *= 10;
-    }
-    return output;
+// True for the bytes that finish a line or frame
+static inline bool com_protocol_rx_is_end(uint8_t c){
+    return (c == 0) || (c == 3) || (c == 13) || (c == 24);
 }
 
-void clean_rx_buff(){
-    //Create state variables
-    bool bflag = true;
-    int result;
+// Moves the received bytes into the RX ring. Only the callback writes the ring.
+static void com_protocol_rx_push(const uint8_t *data, uint32_t len, bool *end){
+    uint32_t fit = spsc_ring_push_batch(&com_proto_rx.ring, data, len);
+    for (uint32_t i = 0; (i < fit) && !*end; i++){
+        *end = com_protocol_rx_is_end(data[i]);
+    }
+}
 
-    // We first clean whatever might be in the RX
-    while (bflag){
-        result = getchar_timeout_us(1000);
-        if ( result == PICO_ERROR_TIMEOUT) {
-            // We are done cleaning
-            bflag = false;
-            #if COM_PROTO_INFO
-            printf("RX buffer now clean :D.\r\n");
-            #endif
+#if PICO_ON_DEVICE
+// stdio chars available callback. Runs in the USB task, which already owns tinyUSB, so it reads the CDC FIFO directly.
+static void com_protocol_rx_callback(void *param){
+    uint8_t chunk[64];
+    bool end = COM_PROTO_USER_FEEDBACK_SERIAL;
+    while (tud_cdc_available() > 0){
+        uint32_t len = tud_cdc_read(chunk, sizeof(chunk));
+        if (len == 0){
+            break;
         }
+        com_protocol_rx_push(chunk, len, &end);
+    }
+    if (end){
+        // Wake core1
+        __sev();
+    }
+}
+#else
+// Host builds have no USB task, core1 moves stdin over itself
+static void com_protocol_rx_poll(){
+    bool end = false;
+    int result = getchar_timeout_us(0);
+    while (result != PICO_ERROR_TIMEOUT){
+        uint8_t c = (uint8_t) result;
+        com_protocol_rx_push(&c, 1, &end);
+        result = getchar_timeout_us(0);
+    }
+}
+#endif
+
+int com_protocol_rx_getc(){
+    uint8_t c;
+    if (!spsc_ring_pop(&com_proto_rx.ring, &c)){
+        return PICO_ERROR_TIMEOUT;
     }
+    return c;
 }
 
 void clean_stdin(char *buffer, uint16_t *len){
@@ -50,232 +136,177 @@ void clean_stdin(char *buffer, uint16_t *len){
 }
 
 void clean_cmd_line(struct cmd* cmd_line){
-    // Clean the command
-    for (uint16_t i = 0; i<cmd_line->cmd_len; i++){
-        cmd_line->command[i] = (char) 0;
-    }
+    // The command and values point into the stdin buffer, forgetting them is enough
+    cmd_line->command = NULL;
     cmd_line->cmd_len = 0;
-
-    // Clean the args
-    for (uint16_t i = 0; i<cmd_line->arg_len; i++){
-        cmd_line->args[i] = (char) 0;
-    }
-
-    // Clean the additional arg values
-    for (uint16_t i = 0; i<cmd_line->arg_len; i++){
-        cmd_line->int_arg[i] = 0;
-    }
-
-    // Clean the temp array
-    for (uint8_t i = 0; i<cmd_line->int_tmp_len; i++){
-        cmd_line->int_tmp[i] = 0;
-    }
-
-    cmd_line->int_tmp_len = 0;
     cmd_line->arg_len = 0;
-    cmd_line->int_arg_len = 0;
+    cmd_line->value_len = 0;
 }
 
 // Read in stdin into the cmd holder
-void read_stdin_to_cmd(char *std_in, uint16_t *len, struct cmd* cmd_line){
-    /*
-    State variable:
-    0 - Reading in command
-    1 - Reading in arguments
-    2 - Done unless more arguments
-    3 - Reading in argument values
-    */
-    uint8_t state = 0;
-
-    // We have that last terminate character to read in so read until len + 1
-    for (uint16_t i = 0; i<*len+1;i++){
-        switch (state){
-            case 0:
-                if ((uint8_t)std_in[i] == 0){
-                    // This is a null character thus we treat it as an escape to be done
-                    cmd_line->cmd_len = i ;
-                }
-                else if ((uint8_t)std_in[i] == 32){
-                    // This is a space thus the command read is done
-                    // We can now go to state 2 to wait for the args
-                    cmd_line->cmd_len = i ;
-                    state = 2;
-                }
-                else{
-                    cmd_line->command[i] = std_in[i];
-                }
-                break;
-            
-            case 1:
-                if ((uint8_t)std_in[i] == 32){
-                    // This is a space thus the arg read is done
-                    state = 2;
-                }
-                else if ((uint8_t)std_in[i] != 0){
-                    // Also ignore terminate char if found
-                    // Here we read in the arguments
-                    cmd_line->args[cmd_line->arg_len] = std_in[i];
-                    cmd_line->arg_len = (uint8_t) safe_increment((uint16_t) cmd_line->arg_len, (uint16_t) COM_PROTO_ARG_ARRAY_SIZE);
+bool read_stdin_to_cmd(const char *std_in, uint16_t *len, struct cmd* cmd_line){
+    const char *cursor = std_in;
+    const char *end = std_in + *len;
+    struct cmd_token token;
+
+    // The first token is the command
+    if (!cmd_token_next(&cursor, end, &token)){
+        // Only spaces
+        return false;
+    }
+    if ((token.type != CMD_TOKEN_WORD) || (token.len >= COM_PROTO_COMMAND_SIZE)){
+        #if USE_USB
+        printf("Expected a command, got %.*s.\r\n", token.len, token.start);
+        #endif
+        return false;
+    }
+    cmd_line->command = token.start;
+    cmd_line->cmd_len = (uint8_t) token.len;
+
+    // Then options and values in any order
+    while (cmd_token_next(&cursor, end, &token)){
+        switch (token.type){
+            case CMD_TOKEN_SHORT_OPTS:
+                // Each char is a separate option
+                for (uint16_t i = 0; i < token.len; i++){
+                    if (cmd_line->arg_len == COM_PROTO_ARG_ARRAY_SIZE){
+                        #if USE_USB
+                        printf("More than %u options given.\r\n", COM_PROTO_ARG_ARRAY_SIZE);
+                        #endif
+                        return false;
+                    }
+                    cmd_line->args[cmd_line->arg_len] = token.start[i];
+                    cmd_line->long_args[cmd_line->arg_len].len = 0;
+                    cmd_line->arg_len++;
                 }
                 break;
-            
-            case 2:
-                
-                if ((uint8_t)std_in[i] == 45){
-                    // This is the character -, thus arguments are starting so switch over
-                    state = 1;
-                }
-                else if (((uint8_t)std_in[i] != 32) && ((uint8_t)std_in[i] != 45)){
-                    // Not a - or space. Assume value since we are here
-                    // Here we move to value read and read in the first valid value if a value is expected
-                    if ((cmd_line->int_arg_len < cmd_line->arg_len) && ((uint8_t) std_in[i] >= 48)){
-                    state = 3;
-                    // Add to the temp array
-                    cmd_line->int_tmp[cmd_line->int_tmp_len] = (uint8_t) std_in[i] - 48;
-                    cmd_line->int_tmp_len = (uint8_t) safe_increment((uint16_t) cmd_line->int_tmp_len, (uint16_t) COM_PROTO_ARG_ARRAY_SIZE);
-                    } 
+
+            case CMD_TOKEN_LONG_OPT:
+                // Mapped to the option character of the binary by execute_bin
+                if (cmd_line->arg_len == COM_PROTO_ARG_ARRAY_SIZE){
+                    #if USE_USB
+                    printf("More than %u options given.\r\n", COM_PROTO_ARG_ARRAY_SIZE);
+                    #endif
+                    return false;
                 }
+                cmd_line->args[cmd_line->arg_len] = COM_PROTO_LONG_ARG;
+                cmd_line->long_args[cmd_line->arg_len] = token;
+                cmd_line->arg_len++;
                 break;
-            
-            case 3:
-                if ((uint8_t)std_in[i] == 0){
-                    // This is a null character thus we treat it as an escape to be done
-                    // Read in the temp 
-                    for ( uint8_t v = 0; v<cmd_line->int_tmp_len; v++){
-                        cmd_line->int_arg[cmd_line->int_arg_len] += cmd_line->int_tmp[v] * pow_10(cmd_line->int_tmp_len - 1 - v);
-                    }
-                    // Reset the temp
-                    memset( cmd_line->int_tmp, 0 , cmd_line->int_tmp_len);
-                    cmd_line->int_tmp_len = 0;
-                    // Increment the int arg amount
-                    cmd_line->int_arg_len = (uint8_t) safe_increment((uint16_t) cmd_line->int_arg_len, (uint16_t) COM_PROTO_ARG_ARRAY_SIZE);
-                }
-                else if ((uint8_t)std_in[i] == 32){
-                    // This is a space thus the value read is done
-                    state = 2;
 
-                    // Read in the temp 
-                    for ( uint8_t v = 0; v<cmd_line->int_tmp_len; v++){
-                        cmd_line->int_arg[cmd_line->int_arg_len] += cmd_line->int_tmp[v] * pow_10(cmd_line->int_tmp_len - 1 - v);
-                    }
-                    // Reset the temp
-                    memset( cmd_line->int_tmp, 0 , cmd_line->int_tmp_len);
-                    cmd_line->int_tmp_len = 0;
-                    // Increment the int arg amount
-                    cmd_line->int_arg_len = (uint8_t) safe_increment((uint16_t) cmd_line->int_arg_len, (uint16_t) COM_PROTO_ARG_ARRAY_SIZE);
+            case CMD_TOKEN_ERROR:
+                #if USE_USB
+                printf("Invalid value %.*s. Numbers must fit in 32 bits and quotes must be closed.\r\n", token.len, token.start);
+                #endif
+                return false;
+
+            default:
+                // Integers, fixed point, strings and words are all values
+                if (cmd_line->value_len == COM_PROTO_ARG_ARRAY_SIZE){
+                    #if USE_USB
+                    printf("More than %u values given.\r\n", COM_PROTO_ARG_ARRAY_SIZE);
+                    #endif
+                    return false;
                 }
-                else if ((cmd_line->int_arg_len < cmd_line->arg_len) && ((uint8_t) std_in[i] >= 48)){
-                    // Add to the temp array
-                    cmd_line->int_tmp[cmd_line->int_tmp_len] = (uint8_t) std_in[i] - 48;
-                    cmd_line->int_tmp_len = (uint8_t) safe_increment((uint16_t) cmd_line->int_tmp_len, (uint16_t) COM_PROTO_ARG_ARRAY_SIZE);
-                } 
+                cmd_line->values[cmd_line->value_len] = token;
+                cmd_line->value_len++;
+                break;
         }
     }
+    return true;
+}
+
+// Sets *value to the value at index if it is an integer
+bool cmd_value_int(struct cmd* cmd_line, uint8_t index, int32_t *value){
+    if ((index >= cmd_line->value_len) || (cmd_line->values[index].type != CMD_TOKEN_INT)){
+        return false;
+    }
+    *value = cmd_line->values[index].value;
+    return true;
 }
 
 // Read in stdin and return length of string. This is the RX USB implementation.
 uint16_t read_stdin_usb(char *buffer){
-    //Create state variables
-    bool bflag = true;
-    bool enter = true;
+    // The line being typed survives between calls
+    static uint16_t index = 0;
     int result;
-    uint16_t index = 0;
-
-    while (bflag){
-        // I did not want some infinite wait. As such I read straight from stdin intead of using scanf and the likes.
-        // PS I could play around with tinyUSB to trigger IRQ but nah that's a future project ;P
-        result = getchar_timeout_us((uint32_t) COM_PROTO_RX_WAIT);
-        if ( (result == PICO_ERROR_TIMEOUT) && (enter)) {
-            // We are done cleaning
-            bflag = false;
+
+    while ((result = com_protocol_rx_getc()) != PICO_ERROR_TIMEOUT){
+        uint16_t len;
+        // We need one free character for a termination point
+        if (index < (COM_PROTO_RX_BUFFER_SIZE - 1))
+        {
             #if COM_PROTO_DEBUG
-            printf("Done reading :D.\r\n");
+            printf("Found result %i \r\n",result);
             #endif
-        }
-        else {
-            // We did receive something, set enter to false so we can disable the exit condition until the user is done
-            enter = false;
-            // We need one free character for a termination point
-            if (index < (COM_PROTO_RX_BUFFER_SIZE - 1))
-            {
-                #if COM_PROTO_DEBUG
-                printf("Found result %i \r\n",result);
-                #endif
-
-                // Based on the character we find we do some generic operations
-                // Special characters are treated first
-                switch (result){
-                    case 3:
-                        // This is the text end character. Triggered by Ctrl+C
-                        // Just escape
-                        #if COM_PROTO_USER_FEEDBACK_SERIAL
-                        printf("\r\n");
-                        #endif
-                        return index;
-                        
-                    case 8:
-                        // This is the backspace. We treat it as if a character was deleted. 
-                        // We move index back , so another character can be written over
-                        // Only move back if no underflow will occur
-                        if ( index > 0){
-                        index -= 1;
-                        buffer[index] = (char)0; // Clear this character
-                        }
-                        break;
-                    
-                    case 13:
-                        // This is a CR. We are going to a new line thus we can assume ENTER was used.
-                        // This can be triggered by ENTER, Ctrl+M
-                        enter = true; // We can now escape the loop
-                        break;
 
-                    case 24:
-                        // This is a CAN, here we assume the user has canceled their input. Return 0
-                        // This is done by Ctrl+X
-                        #if COM_PROTO_USER_FEEDBACK_SERIAL
+            // Based on the character we find we do some generic operations
+            // Special characters are treated first
+            switch (result){
+                case 3:
+                    // This is the text end character. Triggered by Ctrl+C
+                    // Just escape with what we have
+                case 13:
+                    // This is a CR. We are going to a new line thus we can assume ENTER was used.
+                    // This can be triggered by ENTER, Ctrl+M
+                    #if COM_PROTO_USER_FEEDBACK_SERIAL
+                    if (index > 0){
                         printf("\r\n");
+                    }
+                    #endif
+                    buffer[index] = (char) 0;
+                    len = index;
+                    index = 0;
+                    return len;
+
+                case 8:
+                    // This is the backspace. We treat it as if a character was deleted.
+                    // We move index back , so another character can be written over
+                    // Only move back if no underflow will occur
+                    if ( index > 0){
+                    index -= 1;
+                    buffer[index] = (char)0; // Clear this character
+                    }
+                    break;
+
+                case 24:
+                    // This is a CAN, here we assume the user has canceled their input. Return 0
+                    // This is done by Ctrl+X
+                    #if COM_PROTO_USER_FEEDBACK_SERIAL
+                    printf("\r\n");
+                    #endif
+                    memset(buffer, 0, index);
+                    index = 0;
+                    return 0;
+
+                default:
+                    // Non special character, however we only accept [32,126] as useful input, thus here we filter useless out.
+                    if ((result > 31) && (result < 127)){
+                        #if COM_PROTO_DEBUG
+                        printf("Assigning %c = %i to index %i \r\n",(char) result,result, index);
                         #endif
-                        return 0;
-
-                    default:
-                        // Non special character, however we only accept [32,126] as useful input, thus here we filter useless out.
-                        // Further we only accept a buffer size of COM_PROTO_RX_BUFFER_SIZE. If it so happen to be more exit the program 
-                        if ((result > 31) && (result < 127)){
-                            #if COM_PROTO_DEBUG
-                            printf("Assigning %c = %i to index %i \r\n",(char) result,result, index);
-                            #endif
-                            // Only add if smaller than buffer size
-                            buffer[index] = (char) result;
-                            index += 1;
-                        }
-                        break;
-                }
-                // Print updated stdin feedback
-                #if COM_PROTO_USER_FEEDBACK_SERIAL
-                printf("\r[pico_w]:%s ",buffer);
-                #endif
-            }
-            else {
-                // Index is now overflowing return
-                #if COM_PROTO_USER_FEEDBACK_SERIAL
-                printf("\r\n");
-                #endif
-                buffer[index - 1] = (char) 0;
-                return index;
+                        buffer[index] = (char) result;
+                        index += 1;
+                    }
+                    break;
             }
+            // Print updated stdin feedback
+            #if COM_PROTO_USER_FEEDBACK_SERIAL
+            printf("\r[pico_w]:%s ",buffer);
+            #endif
+        }
+        else {
+            // Index is now overflowing return
+            #if COM_PROTO_USER_FEEDBACK_SERIAL
+            printf("\r\n");
+            #endif
+            buffer[index - 1] = (char) 0;
+            len = index;
+            index = 0;
+            return len;
         }
     }
-    #if COM_PROTO_USER_FEEDBACK_SERIAL
-    // Normal return 
-    if (index > 0){
-        printf("\r\n");
-    }
-    else {
-       printf("\r[pico_w]:"); 
-    }
-    #endif
-    buffer[index] = (char) 0;
-    return index;
+    return 0;
 }
 
 // Main entry for read. On compile time the correct function will be entered here.
@@ -288,11 +319,15 @@ uint16_t read_stdin(char *buffer){
 // Init function
 void com_protocol_init()
 {
-    queue_t call_queue;
-    queue_t results_queue;
+    com_job_init();
 
-    queue_init(&call_queue, sizeof(queue_entry_t), COM_PROTO_QUEUE_LEN);
-    queue_init(&results_queue, sizeof(queue_entry_t), COM_PROTO_QUEUE_LEN);
+    com_binary_init();
+
+    spsc_ring_init(&com_proto_rx.ring, com_proto_rx.bytes, 1, COM_PROTO_RX_RING_SIZE);
+    #if PICO_ON_DEVICE
+    // From here on USB input lands in the RX ring as it comes in
+    stdio_set_chars_available_callback(com_protocol_rx_callback, NULL);
+    #endif
 
     #if COM_PROTO_INFO
     printf("Spinning up communication interface.\r\n");
@@ -304,106 +339,243 @@ void com_protocol_init()
 // Init the cmd_line structure
 void init_cmd_line(struct cmd* cmd_line){
     // Setting the defaults for cmd_line
-    memset( cmd_line->command, '\0', sizeof( cmd_line->command ));
     memset( cmd_line->args, '\0', sizeof( cmd_line->args ));
-    memset( cmd_line->int_arg, 0 , sizeof( cmd_line->int_arg ));
-    memset( cmd_line->int_tmp, 0 , sizeof(cmd_line->int_tmp));
-    cmd_line->arg_len = 0;
-    cmd_line->cmd_len = 0;
-    cmd_line->int_arg_len = 0;
-    cmd_line->int_tmp_len = 0;
+    clean_cmd_line(cmd_line);
 
     // TODO find some nicer way to initialize the sensor state variables
     cmd_line->bmp_180 = &my_bmp180;
+    cmd_line->bme_280 = &my_bme280;
     cmd_line->eeprom = &my_eeprom;
+    cmd_line->log = &my_eeprom_log;
+    cmd_line->i2c = &i2c_bus0;
+    cmd_line->stream = &my_stream;
+    cmd_line->pipeline = &my_pipeline;
+    cmd_line->sched = &my_sched;
+}
+
+// Compares the first len characters of command against bin_string like strcmp would the whole strings
+static int compare_bin(const char *command, uint8_t len, const char *bin_string){
+    int result = strncmp(command, bin_string, len);
+    if (result != 0){
+        return result;
+    }
+    // Equal so far, command only matches if bin_string ends here too. Else command is the shorter one.
+    return (bin_string[len] == '\0') ? 0 : -1;
+}
+
+// Binary search of a sorted table. Returns the index of the match or COM_PROTO_NO_BIN.
+static int find_bin(const bin_executable *bins, uint8_t n_bins, const char *command, uint8_t len){
+    int low = 0;
+    int high = (int) n_bins - 1;
+    while (low <= high){
+        int mid = (low + high) / 2;
+        int result = compare_bin(command, len, bins[mid].bin_string);
+        if (result == 0){
+            return mid;
+        }
+        else if (result < 0){
+            high = mid - 1;
+        }
+        else {
+            low = mid + 1;
+        }
+    }
+    return COM_PROTO_NO_BIN;
 }
 
-// Initializes the bin_executable structure
-void init_bin_executable(bin_executable *bin_array){
-    // Define the first entry
-    char * cmd_buffer_1 = (char *) malloc(4 * sizeof(char)); // Allocate some space in memory for the cmd char
-    char command_1[4] = "help";
-    memcpy(cmd_buffer_1, command_1, 4 * sizeof(char)); // Copy the content into memory
-    bin_executable entry_1 = {&help_bin, cmd_buffer_1};
-    bin_array[0] = entry_1;
+int com_protocol_register_bin(void (*func)(struct cmd *), const char *bin_string, const struct cmd_long_opt *long_opts, uint8_t n_long_opts){
+    size_t len = strlen(bin_string);
+    if ((len == 0) || (len >= COM_PROTO_COMMAND_SIZE) || (strchr(bin_string, ' ') != NULL)){
+        return COM_PROTO_BIN_BAD_NAME;
+    }
+    if ((find_bin(com_proto_bins, COM_PROTO_N_BIN, bin_string, (uint8_t) len) != COM_PROTO_NO_BIN) ||
+        (find_bin(com_proto_runtime_bins, com_proto_runtime_bins_len, bin_string, (uint8_t) len) != COM_PROTO_NO_BIN)){
+        return COM_PROTO_BIN_EXISTS;
+    }
+    if (com_proto_runtime_bins_len == COM_PROTO_N_RUNTIME_BIN){
+        return COM_PROTO_BIN_FULL;
+    }
 
-    // Define the second entry
-    char * cmd_buffer_2 = (char *) malloc(6 * sizeof(char)); // Allocate some space in memory for the cmd char
-    char command_2[6] = "bmp180";
-    memcpy(cmd_buffer_2, command_2, 6 * sizeof(char)); // Copy the content into memory
-    bin_executable entry_2 = {&bmp180_bin, cmd_buffer_2};
-    bin_array[1] = entry_2;
+    // Shift the larger names up one to keep the table sorted
+    int index = com_proto_runtime_bins_len;
+    while ((index > 0) && (strcmp(com_proto_runtime_bins[index - 1].bin_string, bin_string) > 0)){
+        com_proto_runtime_bins[index] = com_proto_runtime_bins[index - 1];
+        index--;
+    }
+    com_proto_runtime_bins[index].func = func;
+    com_proto_runtime_bins[index].bin_string = bin_string;
+    com_proto_runtime_bins[index].long_opts = long_opts;
+    com_proto_runtime_bins[index].n_long_opts = n_long_opts;
+    com_proto_runtime_bins_len++;
 
     #if COM_PROTO_INFO
-    printf("init_bin_executable assigned bin string %s to index 0\r\n",bin_array[0].bin_string);
-    printf("init_bin_executable assigned bin string %s to index 1\r\n",bin_array[1].bin_string);
+    printf("com_protocol_register_bin registered bin string %s.\r\n", bin_string);
     #endif
+    return index;
 }
 
-int execute_bin(struct cmd* cmd_line, bin_executable *bin_array){
-    int result;
-    for (uint8_t i = 0; i<COM_PROTO_N_BIN; i++){
-        // Debug code
-        #if COM_PROTO_DEBUG
-        printf("Comparing string %s with string %s until index %i \r\n",cmd_line->command, bin_array[i].bin_string, cmd_line->cmd_len);
-        #endif
+// Maps the long options of cmd_line to the option characters of bin. Returns false if bin does not know one.
+static bool resolve_long_args(struct cmd* cmd_line, const bin_executable *bin){
+    for (uint8_t i = 0; i < cmd_line->arg_len; i++){
+        if (cmd_line->args[i] != COM_PROTO_LONG_ARG){
+            continue;
+        }
+        uint8_t o = 0;
+        while ((o < bin->n_long_opts) && !cmd_token_equals(&cmd_line->long_args[i], bin->long_opts[o].name)){
+            o++;
+        }
+        if (o == bin->n_long_opts){
+            #if USE_USB
+            printf("%s has no option --%.*s.\r\n", bin->bin_string, cmd_line->long_args[i].len, cmd_line->long_args[i].start);
+            #endif
+            return false;
+        }
+        cmd_line->args[i] = bin->long_opts[o].arg;
+    }
+    return true;
+}
 
-        // Check if strings are equal.
-        result = strncmp(cmd_line->command, bin_array[i].bin_string, cmd_line->cmd_len);
-        if ( result == 0){
-            // Execute the binary
-            void (*func)() = (void(*)())(bin_array[i].func);
-            (*func)(cmd_line);
-            return i;
+// Reads the rate of option i in Hz into milli_hz, 0 if there is none or it is not positive.
+// Integers are scaled to mHz, fixed point values already are. Returns false if the rate does not fit in 32 bit mHz.
+static bool parse_rate_milli_hz(struct cmd* cmd_line, uint16_t i, uint32_t *milli_hz){
+    *milli_hz = 0;
+    if ((i >= cmd_line->value_len) || (cmd_line->values[i].value <= 0)){
+        return true;
+    }
+    uint32_t value = (uint32_t) cmd_line->values[i].value;
+    if (cmd_line->values[i].type == CMD_TOKEN_INT){
+        if (value > UINT32_MAX / CMD_TOKEN_FIXED_SCALE){
+            return false;
         }
+        *milli_hz = value * CMD_TOKEN_FIXED_SCALE;
+    }
+    else if (cmd_line->values[i].type == CMD_TOKEN_FIXED){
+        *milli_hz = value;
+    }
+    return true;
+}
+
+int execute_bin(struct cmd* cmd_line){
+    const bin_executable *bin = NULL;
+    // Debug code
+    #if COM_PROTO_DEBUG
+    printf("Looking up command %.*s with length %i \r\n",cmd_line->cmd_len, cmd_line->command, cmd_line->cmd_len);
+    #endif
+
+    int result = find_bin(com_proto_bins, COM_PROTO_N_BIN, cmd_line->command, cmd_line->cmd_len);
+    if (result != COM_PROTO_NO_BIN){
+        bin = &com_proto_bins[result];
+    }
+    else {
+        result = find_bin(com_proto_runtime_bins, com_proto_runtime_bins_len, cmd_line->command, cmd_line->cmd_len);
+        if (result == COM_PROTO_NO_BIN){
+            return COM_PROTO_NO_BIN;
+        }
+        bin = &com_proto_runtime_bins[result];
+        result += COM_PROTO_N_BIN;
+    }
+
+    if (!resolve_long_args(cmd_line, bin)){
+        return COM_PROTO_BAD_ARG;
+    }
+
+    // Execute the binary
+    bin->func(cmd_line);
+    return result;
+}
+
+void com_protocol_binary_step(struct cmd* cmd_line){
+    // Static so the tokens of a command stay valid while its binary runs
+    static uint8_t request[COM_BIN_MAX_PAYLOAD];
+    uint16_t len;
+    int result;
+    // One frame per call, the rest stays in the RX ring for the next pass
+    bool complete = false;
+    while (!complete && ((result = com_protocol_rx_getc()) != PICO_ERROR_TIMEOUT)){
+        complete = com_binary_feed((uint8_t) result, request, &len);
+    }
+    if (!complete){
+        return;
+    }
+    uint8_t type = request[0];
+    uint8_t seq = request[1];
+    uint8_t reply[2];
+
+    switch (type){
+        case COM_BIN_MSG_PING:
+            com_binary_send(COM_BIN_MSG_PONG, seq, NULL, 0);
+            break;
+        case COM_BIN_MSG_CMD: ;
+            // Same path as a typed line
+            uint16_t line_len = len - COM_BIN_HEADER_LEN;
+            result = COM_PROTO_BAD_LINE;
+            if (read_stdin_to_cmd((const char *) &request[COM_BIN_HEADER_LEN], &line_len, cmd_line)){
+                result = execute_bin(cmd_line);
+            }
+            clean_cmd_line(cmd_line);
+            com_binary_put_u16(reply, (uint16_t) (int16_t) result);
+            com_binary_send(COM_BIN_MSG_RESULT, seq, reply, 2);
+            break;
+        case COM_BIN_MSG_EXIT:
+            com_binary_send(COM_BIN_MSG_BYE, seq, NULL, 0);
+            com_binary_exit();
+            break;
+        default:
+            reply[0] = COM_BIN_ERR_TYPE;
+            com_binary_send(COM_BIN_MSG_ERROR, seq, reply, 1);
+            break;
     }
-    return COM_PROTO_NO_BIN;
 }
 
 // Main function entry point
 void com_protocol_entry(){
+    // Allow core0 to pause us while it erases or programs the onboard flash
+    multicore_lockout_victim_init();
     // We create some buffer to store the inputs
     char stdin_buffer[COM_PROTO_RX_BUFFER_SIZE] = {0};
-    // Initialize the command holder
-    struct cmd cmd_line;
+    // Initialize the command holder. Static as its token arrays would take a good bite of the core1 stack.
+    static struct cmd cmd_line;
     init_cmd_line(&cmd_line);
-    // Declare our bin name array
-    bin_executable bin_array[COM_PROTO_N_BIN];
-    // Init bin executables
-    init_bin_executable(bin_array);
     // Store the length of the command
     uint16_t len_str;
     // First clean RX
     clean_rx_buff();    
     // Result of executables
     int res;
-    // Allocate some space to store a queue entry
-    queue_entry_t result_queue_entry;
+    // Allocate some space to store a result
+    struct com_result result;
 
     while(1){
-        // If any user input read it
-        len_str = read_stdin(stdin_buffer);
+        #if !PICO_ON_DEVICE
+        com_protocol_rx_poll();
+        #endif
+        // If any user input read it. In binary mode the host sends frames instead, see com_binary.h
+        if (com_binary_active()){
+            com_protocol_binary_step(&cmd_line);
+            len_str = 0;
+        }
+        else {
+            len_str = read_stdin(stdin_buffer);
+        }
 
         // Read in the command if len != 0
-        if ( len_str != 0 ){
-            read_stdin_to_cmd(stdin_buffer,&len_str,&cmd_line);
-
+        if (( len_str != 0 ) && read_stdin_to_cmd(stdin_buffer,&len_str,&cmd_line)){
             // Debugging lines
             #if COM_PROTO_DEBUG
-            printf("Obtained command %s with char length %i.\r\nArguments were %s with length %i \r\n",cmd_line.command,cmd_line.cmd_len,cmd_line.args,cmd_line.arg_len);
-            for (uint8_t i = 0; i<cmd_line.int_arg_len; i++)
+            printf("Obtained command %.*s with char length %i.\r\nArguments were %.*s with length %i \r\n",cmd_line.cmd_len,cmd_line.command,cmd_line.cmd_len,cmd_line.arg_len,cmd_line.args,cmd_line.arg_len);
+            for (uint8_t i = 0; i<cmd_line.value_len; i++)
             {
-                printf("At index %i the value is %i :\r\n",i,cmd_line.int_arg[i]);
+                printf("At index %i the value is %.*s = %i :\r\n",i,cmd_line.values[i].len,cmd_line.values[i].start,cmd_line.values[i].value);
             }
             #endif
 
             // Execute the binary
-            res = execute_bin(&cmd_line,bin_array);
+            res = execute_bin(&cmd_line);
 
             // Debugging lines
             #if COM_PROTO_DEBUG
             if (res == COM_PROTO_NO_BIN){
-                printf("Command %s does not exist.\r\n",cmd_line.command);
+                printf("Command %.*s does not exist.\r\n",cmd_line.cmd_len,cmd_line.command);
             }
             #endif
         }
@@ -414,28 +586,38 @@ void com_protocol_entry(){
             #endif
         }
 
-        // Check if any entry exists in the result queue
-        if (queue_is_empty(&results_queue))
-        {
+        // Print a result if there is one
+        if (queue_try_remove(&results_queue, &result)){
+            com_result_route(&result);
+        }
+        else{
             // Empty. For debugging tell me
             #if COM_PROTO_DEBUG
             printf("Result queue is empty.\r\n");
             #endif
         }
-        else{
-            // Read in the function and input
-            queue_remove_blocking(&results_queue, &result_queue_entry);
-            void (*stdout_func)() = (void(*)())(result_queue_entry.func);
-            void *std_out_value = result_queue_entry.data ;
-            // Execute the function
-            // We always assume stdout will be of some form of this.
-            (*stdout_func)(std_out_value);
-        }
+
+        // Send on what the stream sampled in the meantime
+        stream_drain(&my_stream, STREAM_DRAIN_MAX);
+
+        // Compensate, filter and send on what the pipeline acquired, see pipeline.h
+        pipeline_process(&my_pipeline, PIPELINE_PROCESS_MAX);
+
+        // Print what the drivers logged in the meantime, see dlog.h
+        dlog_drain(DLOG_DRAIN_MAX);
         
         // Clean stdin after reading
         clean_stdin(stdin_buffer, &len_str);
         // Clean cmd_line after reading
         clean_cmd_line(&cmd_line);
+
+        // Nothing left to do, sleep until the RX callback or a queue add sends an event.
+        // An event sent since the checks is latched, so WFE returns right away and none is missed.
+        // The timeout bounds how long driver logs wait, they do not send an event.
+        if (spsc_ring_is_empty(&com_proto_rx.ring) && queue_is_empty(&results_queue) && spsc_ring_is_empty(&my_stream.samples)
+            && spsc_ring_is_empty(&my_pipeline.raw)){
+            best_effort_wfe_or_timeout(make_timeout_time_ms(COM_PROTO_IDLE_WAKE_MS));
+        }
     }
 }
 
@@ -463,8 +645,14 @@ void help_bin(struct cmd* cmd_line){
 void print_help_bin_help(){
     // USB communications based implementation
     #if USE_USB
-    printf("Usage for help:\r\n-h: Displays this help message.\r\nDefault: Displays this message and entire list of defined binaries.\r\n");
-    printf("List of binaries:\r\n1) help\r\n2) bmp180\r\n");
+    printf("Usage for help:\r\n-h, --help: Displays this help message.\r\nDefault: Displays this message and entire list of defined binaries.\r\n");
+    printf("List of binaries:\r\n");
+    for (uint8_t i = 0; i < COM_PROTO_N_BIN; i++){
+        printf("%i) %s\r\n", i + 1, com_proto_bins[i].bin_string);
+    }
+    for (uint8_t i = 0; i < com_proto_runtime_bins_len; i++){
+        printf("%i) %s\r\n", COM_PROTO_N_BIN + i + 1, com_proto_runtime_bins[i].bin_string);
+    }
     #endif
 }
 
@@ -473,11 +661,11 @@ void bmp180_bin(struct cmd* cmd_line){
     // https://stackoverflow.com/questions/18496282/why-do-i-get-a-label-can-only-be-part-of-a-statement-and-a-declaration-is-not-a
     // We check if the command received any args
 
-    // Start by setting verbose back to 0
-    cmd_line->bmp_180->v = 0;
+    // Verbose is off unless -v is given. It travels with the jobs, main never reads it from the chip model.
+    uint8_t flags = 0;
     // Initialize some space for undefined amount of queue entries
-    // We do this so we can set the unified state of the bmp180 struct if needed
-    queue_entry_t entry_array[COM_PROTO_QUEUE_LEN]; // Can only be max this
+    // We do this so -v applies to every job no matter where it is in the line
+    struct com_job entry_array[COM_PROTO_QUEUE_LEN]; // Can only be max this
     uint8_t entry_array_index = 0;
     // Now we need an arror flag incase bogus inputs were made
     bool valid_case = true;
@@ -495,8 +683,8 @@ void bmp180_bin(struct cmd* cmd_line){
                         // The a case.
                         if (entry_array_index < COM_PROTO_QUEUE_LEN){
                         // Add it to our 'to enter entries'
-                        entry_array[entry_array_index].func = &bmp180_get_altitude;
-                        entry_array[entry_array_index].data = cmd_line->bmp_180;
+                        entry_array[entry_array_index].op = COM_JOB_BMP180_ALTITUDE;
+                        entry_array[entry_array_index].handle = cmd_line->bmp_180;
                         // Step index up
                         entry_array_index+=1;
                         }
@@ -511,6 +699,18 @@ void bmp180_bin(struct cmd* cmd_line){
                         print_help_bmp180_help();
                         i = cmd_line->arg_len;
                         break;
+                    case 108: ;
+                        // The l case. Read straight from the published sample, main is not involved.
+                        struct bmp180_sample sample;
+                        if (bmp180_read_sample(cmd_line->bmp_180, &sample)){
+                            print_sample_bmp180(&sample);
+                        }
+                        else {
+                            #if USE_USB
+                            printf("No BMP180 sample published yet.\r\n");
+                            #endif
+                        }
+                        break;
                     case 109: ; // This empty label is so we can use declerations
                         // The m case
                         bmp180_inter_m(entry_array, &entry_array_index, cmd_line,i);
@@ -520,15 +720,15 @@ void bmp180_bin(struct cmd* cmd_line){
                         // The s case
                         if (entry_array_index < COM_PROTO_QUEUE_LEN){
                         // Add it to our 'to enter entries'
-                        entry_array[entry_array_index].func = &bmp180_get_sea_pressure;
-                        entry_array[entry_array_index].data = cmd_line->bmp_180;
+                        entry_array[entry_array_index].op = COM_JOB_BMP180_SEA_PRESSURE;
+                        entry_array[entry_array_index].handle = cmd_line->bmp_180;
                         // Step index up
                         entry_array_index+=1;
                         }
                         break;
                     case 118: ;
                         // The v case so just set verbose on
-                        cmd_line->bmp_180->v = 1;
+                        flags |= COM_JOB_VERBOSE;
                         break;
                     default:
                         // Invalid input
@@ -545,6 +745,7 @@ void bmp180_bin(struct cmd* cmd_line){
         // If no errors occurred we now add everything to the main queue :)
         for (uint8_t loc=0; loc<entry_array_index; loc++){
         // Add to the queue
+        entry_array[loc].flags = flags;
         queue_add_blocking(&call_queue, &entry_array[loc]);
     }
     }
@@ -553,12 +754,13 @@ void bmp180_bin(struct cmd* cmd_line){
 void print_help_bmp180_help(){
     // USB communications based implementation
     #if USE_USB
-    printf("Usage for bmp180:\r\n-a: Performs altitude estimation.\r\n");
-    printf("-c: Displays the bmp180's calibration parameters.\r\n");
-    printf("-h: Displays this help message.\r\n");
-    printf("-m: Performs full temperature and pressure sampling. Takes in additional integer arguments if one wishes to repeat the process.\r\n");
-    printf("-s: Performs relative sea pressure estimation.\r\n");
-    printf("-v: Prints results in verbose mode. Default this option is turned off.\r\n");
+    printf("Usage for bmp180:\r\n-a, --altitude: Performs altitude estimation.\r\n");
+    printf("-c, --calibration: Displays the bmp180's calibration parameters.\r\n");
+    printf("-h, --help: Displays this help message.\r\n");
+    printf("-l, --last: Prints the last published sample and its age without measuring.\r\n");
+    printf("-m, --measure: Performs full temperature and pressure sampling. Takes in additional integer arguments if one wishes to repeat the process.\r\n");
+    printf("-s, --sea-pressure: Performs relative sea pressure estimation.\r\n");
+    printf("-v, --verbose: Prints results in verbose mode. Default this option is turned off.\r\n");
     printf("Default: Displays this help message.\r\n");
     #endif
 }
@@ -572,11 +774,12 @@ void bmp180_error(char argument){
     print_help_bmp180_help();
 }
 
-void bmp180_inter_m(queue_entry_t *entry_queue, uint8_t *entry_len, struct cmd* cmd_line, uint8_t index)
+void bmp180_inter_m(struct com_job *entry_queue, uint8_t *entry_len, struct cmd* cmd_line, uint8_t index)
 {
-    if (cmd_line->int_arg_len>index){
+    int32_t m;
+    if (cmd_value_int(cmd_line, index, &m) && (m > 0)){
         // We have an entry for this case
-        cmd_line->bmp_180->m = cmd_line->int_arg[index];
+        cmd_line->bmp_180->m = (m > UINT8_MAX) ? UINT8_MAX : (uint8_t) m;
     }
     else {
         // Set to 1
@@ -585,110 +788,905 @@ void bmp180_inter_m(queue_entry_t *entry_queue, uint8_t *entry_len, struct cmd*
     // Go ahead and add entries
     for (uint8_t loc=*entry_len; loc<cmd_line->bmp_180->m; loc++){
         if (*entry_len < COM_PROTO_QUEUE_LEN){
-        entry_queue[loc].func = &bmp180_get_measurement;
-        entry_queue[loc].data = cmd_line->bmp_180;
+        entry_queue[loc].op = COM_JOB_BMP180_MEASURE;
+        entry_queue[loc].handle = cmd_line->bmp_180;
         *entry_len += 1;
         }
     }
 }
 
-// Defines STDOUT selection and enques it to the result queue. This should be called by main. Makes sense to me to keep it here
-int stdout_selector(void *func_pointer){
-    // Can't use a switch statement since pointer is not a constant value....
-    if ((uint32_t) func_pointer == (uint32_t) &bmp180_get_measurement){
-        // Queue the temp results
-        queue_entry_t result_queue_entry_temp = {&print_temp_results_bmp180,&my_bmp180};
-        queue_add_blocking(&results_queue,&result_queue_entry_temp);
-        // Queue the pressure results
-        queue_entry_t result_queue_entry_press = {&print_press_results_bmp180,&my_bmp180};
-        queue_add_blocking(&results_queue,&result_queue_entry_press);
-        return 0;
-    }
-    else if ((uint32_t) func_pointer == (uint32_t) &bmp180_get_altitude)
-    {
-       // Queue the alt results
-        queue_entry_t result_queue_entry_altitude = {&print_altitude_results_bmp180,&my_bmp180};
-        queue_add_blocking(&results_queue,&result_queue_entry_altitude); 
-    }
-    else if ((uint32_t) func_pointer == (uint32_t) &bmp180_get_sea_pressure)
-    {
-       // Queue the alt results
-        queue_entry_t result_queue_entry_sea_pressure = {&print_relative_pressure_results_bmp180,&my_bmp180};
-        queue_add_blocking(&results_queue,&result_queue_entry_sea_pressure); 
+void eeprom_bin(struct cmd* cmd_line){
+    // Same structure as bmp180_bin
+    struct com_job entry_array[COM_PROTO_QUEUE_LEN]; // Can only be max this
+    uint8_t entry_array_index = 0;
+    bool valid_case = true;
+    switch (cmd_line->arg_len){
+        case 0:
+            // No args received print generic help
+            print_help_eeprom_help();
+            valid_case = false;
+            break;
+        default: ; // This empty label is so we can use declerations
+            for (uint16_t i = 0; i<cmd_line->arg_len; i++){
+                switch ((uint8_t) cmd_line->args[i]){
+                    case 100: ;
+                        // The d case. The dump needs the I2C bus so it is executed by main.
+                        if (entry_array_index < COM_PROTO_QUEUE_LEN){
+                        entry_array[entry_array_index].op = COM_JOB_EEPROM_DUMP;
+                        entry_array[entry_array_index].flags = 0;
+                        entry_array[entry_array_index].handle = cmd_line->eeprom;
+                        entry_array_index+=1;
+                        }
+                        break;
+                    case 104:
+                        // The h case. We also break out of the for loop
+                        valid_case = false;
+                        print_help_eeprom_help();
+                        i = cmd_line->arg_len;
+                        break;
+                    default:
+                        // Invalid input
+                        eeprom_error(cmd_line->args[i]);
+                        valid_case = false;
+                        i = cmd_line->arg_len;
+                        break;
+                }
+            }
+            break;
     }
-    else {
-        #if COM_PROTO_DEBUG
-        printf("Invalid function entered to stdout_selector.");
-        #endif
-        return -1;
+    if (valid_case){
+        for (uint8_t loc=0; loc<entry_array_index; loc++){
+        queue_add_blocking(&call_queue, &entry_array[loc]);
+        }
     }
 }
 
-// BMP_180 Print Functions Defines
-
-// Print functions to be called by Serial queries.
-void print_temp_results_bmp180(struct bmp180_model* my_chip)
-{
+void print_help_eeprom_help(){
+    // USB communications based implementation
     #if USE_USB
-    printf("\r==== Temperature Measurement Results ==== \r\n");
-    // Only print these if verbose
-    if (my_chip->v == 1){
-    printf("Obtained UT = %i \r\n",my_chip->measurement_params->ut);
-    printf("Intermittent step X1 = %i \r\n",my_chip->measurement_params->X1_tmp);
-    printf("Intermittent step X2 = %i \r\n",my_chip->measurement_params->X2_tmp);
-    printf("Obtained B5 = %i \r\n",my_chip->measurement_params->B5);
-    printf("Overall sample sum for %u samples = %i \r\n",BMP_180_SS,my_chip->measurement_params->T_sum);
-    }
-    printf("Obtained TMP in 0.1C = %d \r\n",my_chip->measurement_params->T);
+    printf("Usage for eeprom:\r\n-d, --dump: Dumps the entire 24LC16B as hex. Uses one sequential read per 256 byte block.\r\n");
+    printf("-h, --help: Displays this help message.\r\n");
+    printf("Default: Displays this help message.\r\n");
     #endif
 }
 
-void print_press_results_bmp180(struct bmp180_model* my_chip){
+void eeprom_error(char argument){
+    // USB communications based implementation
     #if USE_USB
-    printf("\r==== Pressure Measurement Results ==== \r\n");
-    // Only print these if verbose
-    if (my_chip->v == 1){
-    printf("Obtained UP = %i \r\n",my_chip->measurement_params->up);
-
-    printf("Obtained B6 = %i \r\n",my_chip->measurement_params->B6);
-    printf("Intermittent step X1_1 = %i \r\n",my_chip->measurement_params->X1_p_1);
-    printf("Intermittent step X2_1 = %i \r\n",my_chip->measurement_params->X2_p_1);
-    printf("Intermittent step X3_1 = %i \r\n",my_chip->measurement_params->X3_p_1);
-
-    printf("Intermittent step X1_2 = %i \r\n",my_chip->measurement_params->X1_p_2);
-    printf("Intermittent step X2_2 = %i \r\n",my_chip->measurement_params->X2_p_2);
-    printf("Intermittent step X3_2 = %i \r\n",my_chip->measurement_params->X3_p_2);
-
-    printf("Obtained B3 = %u \r\n",my_chip->measurement_params->B3);
-    printf("Obtained B4 = %u \r\n",my_chip->measurement_params->B4);
-    printf("Obtained B7 = %u \r\n",my_chip->measurement_params->B7);
-    printf("Compensated pressure (P_1) before tuning = %i \r\n",my_chip->measurement_params->p_inter);
+    printf("Recieved invalid character %c with value %u.\r\nThe usage is defined as: \r\n\r\n",argument,argument);
+    #endif
+    // Print generic helper
+    print_help_eeprom_help();
+}
 
-    printf("Intermittent step X1_3 = %i \r\n",my_chip->measurement_params->X1_p_3);
+void log_bin(struct cmd* cmd_line){
+    // Same structure as bmp180_bin. The query and append need the I2C bus so they are executed by main.
+    struct com_job entry_array[COM_PROTO_QUEUE_LEN]; // Can only be max this
+    uint8_t entry_array_index = 0;
+    bool valid_case = true;
+    bool query = false;
+    int32_t value;
 
-    printf("Intermittent step X1_4 = %i \r\n",my_chip->measurement_params->X1_p_4);
-    printf("Intermittent step X2_3 = %i \r\n",my_chip->measurement_params->X2_p_3);
+    // Defaults cover the entire log. The window travels with the job, main owns the query fields of the log.
+    struct com_job_query window = {0, UINT32_MAX, false};
 
-    printf("Overall sample sum for %u samples = %i \r\n",BMP_180_SS,my_chip->measurement_params->p_sum);
+    switch (cmd_line->arg_len){
+        case 0:
+            // No args received print generic help
+            print_help_log_help();
+            valid_case = false;
+            break;
+        default: ; // This empty label is so we can use declerations
+            for (uint16_t i = 0; i<cmd_line->arg_len; i++){
+                switch ((uint8_t) cmd_line->args[i]){
+                    case 97:
+                        // The a case. Only aggregate.
+                        window.aggregate = true;
+                        query = true;
+                        break;
+                    case 102:
+                        // The f case. Start of the window as ddhhmmss.
+                        if (cmd_value_int(cmd_line, i, &value)){
+                            window.start = eeprom_log_timestamp_from_ddhhmmss((uint32_t) value);
+                        }
+                        query = true;
+                        break;
+                    case 104:
+                        // The h case. We also break out of the for loop
+                        valid_case = false;
+                        print_help_log_help();
+                        i = cmd_line->arg_len;
+                        break;
+                    case 113:
+                        // The q case. Query the entire log.
+                        query = true;
+                        break;
+                    case 116:
+                        // The t case. End of the window as ddhhmmss.
+                        if (cmd_value_int(cmd_line, i, &value)){
+                            window.end = eeprom_log_timestamp_from_ddhhmmss((uint32_t) value);
+                        }
+                        query = true;
+                        break;
+                    case 119:
+                        // The w case. Append a value.
+                        if (cmd_value_int(cmd_line, i, &value) && (entry_array_index < COM_PROTO_QUEUE_LEN)){
+                            entry_array[entry_array_index].op = COM_JOB_LOG_APPEND;
+                            entry_array[entry_array_index].flags = 0;
+                            entry_array[entry_array_index].handle = cmd_line->log;
+                            entry_array[entry_array_index].params.value = (uint32_t) value;
+                            entry_array_index+=1;
+                        }
+                        break;
+                    default:
+                        // Invalid input
+                        log_error(cmd_line->args[i]);
+                        valid_case = false;
+                        i = cmd_line->arg_len;
+                        break;
+                }
+            }
+            break;
+    }
+    if (query && (entry_array_index < COM_PROTO_QUEUE_LEN)){
+        entry_array[entry_array_index].op = COM_JOB_LOG_QUERY;
+        entry_array[entry_array_index].flags = 0;
+        entry_array[entry_array_index].handle = cmd_line->log;
+        entry_array[entry_array_index].params.query = window;
+        entry_array_index+=1;
+    }
+    if (valid_case){
+        for (uint8_t loc=0; loc<entry_array_index; loc++){
+        queue_add_blocking(&call_queue, &entry_array[loc]);
+        }
     }
-    printf("Obtained Pressure in 1Pa = %d \r\n",my_chip->measurement_params->p);
-    #endif
 }
 
-void print_altitude_results_bmp180(struct bmp180_model* my_chip){
+void print_help_log_help(){
+    // USB communications based implementation
     #if USE_USB
-    printf("\rCurrently the device is at %f (m) \r\n",my_chip->measurement_params->altitude);
+    printf("Usage for log:\r\n-q, --query: Prints every sample in the log.\r\n");
+    printf("-f, --from: Only samples from this time on. Takes an integer argument formatted as ddhhmmss.\r\n");
+    printf("-t, --to: Only samples up to this time. Takes an integer argument formatted as ddhhmmss.\r\n");
+    printf("-a, --aggregate: Only prints the min, max and mean of the samples in the window. Place it after -f and -t.\r\n");
+    printf("-w, --write: Appends the integer argument to the log with the current RTC time.\r\n");
+    printf("-h, --help: Displays this help message.\r\n");
+    printf("Example: log -fta 24120000 24130000\r\n");
+    printf("Default: Displays this help message.\r\n");
     #endif
 }
 
-void print_relative_pressure_results_bmp180(struct bmp180_model* my_chip){
+void log_error(char argument){
+    // USB communications based implementation
     #if USE_USB
-    printf("\rRelative pressure at sea level for device = %f Pa \r\n",my_chip->measurement_params->p_relative);
+    printf("Recieved invalid character %c with value %u.\r\nThe usage is defined as: \r\n\r\n",argument,argument);
     #endif
+    // Print generic helper
+    print_help_log_help();
 }
 
-void print_chip_ID_bmp180(struct bmp180_model* my_chip){
-    #if USE_USB
+void stream_bin(struct cmd* cmd_line){
+    // The timer belongs to main, so starting and stopping are queued to it. The status lives in RAM and is printed right here.
+    uint32_t channels = 0;
+    uint32_t period_us = 0;
+    bool stop = false;
+
+    if (cmd_line->arg_len == 0){
+        // No args received print generic help
+        print_help_stream_help();
+        return;
+    }
+    for (uint16_t i = 0; i<cmd_line->arg_len; i++){
+        switch ((uint8_t) cmd_line->args[i]){
+            case 97:
+                // The a case
+                channels |= STREAM_CH_BMP180_ALT;
+                break;
+            case 100:
+                // The d case
+                print_stream_status(cmd_line->stream);
+                break;
+            case 102: ;
+                // The f case. Rate in Hz, fixed point allowed.
+                uint32_t milli_hz;
+                bool rate_fits = parse_rate_milli_hz(cmd_line, i, &milli_hz);
+                if (milli_hz != 0){
+                    period_us = (uint32_t) (1000000000ULL / milli_hz);
+                }
+                if (!rate_fits || (period_us < STREAM_MIN_PERIOD_US) || (period_us > STREAM_MAX_PERIOD_US)){
+                    #if USE_USB
+                    printf("The rate has to be between %u mHz and %u Hz.\r\n", (unsigned) (1000000000ULL / STREAM_MAX_PERIOD_US), (unsigned) (1000000 / STREAM_MIN_PERIOD_US));
+                    #endif
+                    return;
+                }
+                break;
+            case 104:
+                // The h case
+                print_help_stream_help();
+                return;
+            case 109:
+                // The m case
+                channels |= STREAM_CH_BMP180;
+                break;
+            case 112:
+                // The p case
+                channels |= STREAM_CH_BME280_PRESS;
+                break;
+            case 115:
+                // The s case
+                stop = true;
+                break;
+            case 116:
+                // The t case
+                channels |= STREAM_CH_BME280_TEMP;
+                break;
+            case 117:
+                // The u case
+                channels |= STREAM_CH_BME280_HUM;
+                break;
+            default:
+                // Invalid input
+                stream_error(cmd_line->args[i]);
+                return;
+        }
+    }
+
+    if (stop){
+        struct com_job stop_entry = {.op = COM_JOB_STREAM_STOP, .handle = cmd_line->stream};
+        queue_add_blocking(&call_queue, &stop_entry);
+        return;
+    }
+    if ((channels == 0) && (period_us == 0)){
+        // Only the status was asked for
+        return;
+    }
+    // A new rate alone keeps the channels, new channels alone keep the rate
+    if (channels == 0){
+        channels = cmd_line->stream->req_channels;
+    }
+    if (period_us == 0){
+        period_us = (cmd_line->stream->req_period_us != 0) ? cmd_line->stream->req_period_us : STREAM_DEFAULT_PERIOD_US;
+    }
+    if (channels == 0){
+        #if USE_USB
+        printf("No channels selected.\r\n");
+        #endif
+        return;
+    }
+    cmd_line->stream->req_channels = channels;
+    cmd_line->stream->req_period_us = period_us;
+    struct com_job start_entry = {.op = COM_JOB_STREAM_START, .handle = cmd_line->stream};
+    queue_add_blocking(&call_queue, &start_entry);
+}
+
+void print_help_stream_help(){
+    // USB communications based implementation
+    #if USE_USB
+    printf("Usage for stream:\r\n-m, --bmp180: Streams the BMP180 temperature and pressure.\r\n");
+    printf("-a, --altitude: Streams the BMP180 altitude.\r\n");
+    printf("-t, --temperature: Streams the BME280 temperature.\r\n");
+    printf("-p, --pressure: Streams the BME280 pressure.\r\n");
+    printf("-u, --humidity: Streams the BME280 humidity.\r\n");
+    printf("-f, --rate: Samples per second, takes an integer or fixed point argument. Default 10.\r\n");
+    printf("-s, --stop: Stops the stream.\r\n");
+    printf("-d, --status: Displays the channels, rate, skipped ticks and dropped samples.\r\n");
+    printf("-h, --help: Displays this help message.\r\n");
+    printf("Each sample is printed as STREAM,<time_us>,<sensor>,<quantity>,<value>, in binary mode it is a sample frame.\r\n");
+    printf("Example: stream -f 25 -tpu\r\n");
+    printf("Default: Displays this help message.\r\n");
+    #endif
+}
+
+void stream_error(char argument){
+    // USB communications based implementation
+    #if USE_USB
+    printf("Recieved invalid character %c with value %u.\r\nThe usage is defined as: \r\n\r\n",argument,argument);
+    #endif
+    // Print generic helper
+    print_help_stream_help();
+}
+
+void pipe_bin(struct cmd* cmd_line){
+    // Like stream, the timer and the bench belong to main and are queued to it. The status is printed right here.
+    uint32_t sensors = 0;
+    uint32_t period_us = 0;
+    uint32_t bench = 0;
+    bool stop = false;
+
+    if (cmd_line->arg_len == 0){
+        // No args received print generic help
+        print_help_pipe_help();
+        return;
+    }
+    for (uint16_t i = 0; i<cmd_line->arg_len; i++){
+        switch ((uint8_t) cmd_line->args[i]){
+            case 98:
+                // The b case. Samples per mode, an integer.
+                bench = PIPELINE_BENCH_DEFAULT;
+                if ((i < cmd_line->value_len) && (cmd_line->values[i].type == CMD_TOKEN_INT)){
+                    bench = (uint32_t) cmd_line->values[i].value;
+                }
+                if ((bench == 0) || (bench > PIPELINE_BENCH_MAX)){
+                    #if USE_USB
+                    printf("The benchmark takes between 1 and %u samples.\r\n", PIPELINE_BENCH_MAX);
+                    #endif
+                    return;
+                }
+                break;
+            case 100:
+                // The d case
+                print_pipeline_status(cmd_line->pipeline);
+                break;
+            case 101:
+                // The e case
+                sensors |= PIPELINE_BME280;
+                break;
+            case 102: ;
+                // The f case. Rate in Hz, fixed point allowed.
+                uint32_t milli_hz;
+                bool rate_fits = parse_rate_milli_hz(cmd_line, i, &milli_hz);
+                if (milli_hz != 0){
+                    period_us = (uint32_t) (1000000000ULL / milli_hz);
+                }
+                if (!rate_fits || (period_us < PIPELINE_MIN_PERIOD_US) || (period_us > PIPELINE_MAX_PERIOD_US)){
+                    #if USE_USB
+                    printf("The rate has to be between %u mHz and %u Hz.\r\n", (unsigned) (1000000000ULL / PIPELINE_MAX_PERIOD_US), (unsigned) (1000000 / PIPELINE_MIN_PERIOD_US));
+                    #endif
+                    return;
+                }
+                break;
+            case 104:
+                // The h case
+                print_help_pipe_help();
+                return;
+            case 109:
+                // The m case
+                sensors |= PIPELINE_BMP180;
+                break;
+            case 115:
+                // The s case
+                stop = true;
+                break;
+            default:
+                // Invalid input
+                pipe_error(cmd_line->args[i]);
+                return;
+        }
+    }
+
+    if (stop){
+        struct com_job stop_entry = {.op = COM_JOB_PIPELINE_STOP, .handle = cmd_line->pipeline};
+        queue_add_blocking(&call_queue, &stop_entry);
+        return;
+    }
+    if (sensors != 0){
+        cmd_line->pipeline->req_sensors = sensors;
+    }
+    if (bench != 0){
+        // Runs on the selected sensors, or the last ones, or both
+        struct com_job bench_entry = {.op = COM_JOB_PIPELINE_BENCH, .handle = cmd_line->pipeline, .params.value = bench};
+        queue_add_blocking(&call_queue, &bench_entry);
+        return;
+    }
+    if ((sensors == 0) && (period_us == 0)){
+        // Only the status was asked for
+        return;
+    }
+    // A new rate alone keeps the sensors, new sensors alone keep the rate
+    if (period_us == 0){
+        period_us = (cmd_line->pipeline->req_period_us != 0) ? cmd_line->pipeline->req_period_us : PIPELINE_DEFAULT_PERIOD_US;
+    }
+    if (cmd_line->pipeline->req_sensors == 0){
+        #if USE_USB
+        printf("No sensors selected.\r\n");
+        #endif
+        return;
+    }
+    cmd_line->pipeline->req_period_us = period_us;
+    struct com_job start_entry = {.op = COM_JOB_PIPELINE_START, .handle = cmd_line->pipeline};
+    queue_add_blocking(&call_queue, &start_entry);
+}
+
+void print_help_pipe_help(){
+    // USB communications based implementation
+    #if USE_USB
+    printf("Usage for pipe:\r\n-m, --bmp180: Acquires the BMP180. Sends its temperature, pressure and altitude.\r\n");
+    printf("-e, --bme280: Acquires the BME280. Sends its temperature, pressure, humidity and dew point.\r\n");
+    printf("-f, --rate: Acquisitions per second, takes an integer or fixed point argument. Default 10.\r\n");
+    printf("-s, --stop: Stops acquisition.\r\n");
+    printf("-d, --status: Displays the rate, skipped ticks, dropped reads and the time spent on each core.\r\n");
+    printf("-b, --bench: Takes the integer argument of samples (default %u) on one core, then on two, and displays both rates. Stops acquisition.\r\n", PIPELINE_BENCH_DEFAULT);
+    printf("-h, --help: Displays this help message.\r\n");
+    printf("core0 only reads the raw values, core1 compensates, filters and derives them.\r\n");
+    printf("Each value is printed as PIPE,<time_us>,<sensor>,<quantity>,<value>,<filtered>, in binary mode it is a sample frame of the filtered value.\r\n");
+    printf("Example: pipe -f 20 -me\r\n");
+    printf("Example: pipe -b 200 -m\r\n");
+    printf("Default: Displays this help message.\r\n");
+    #endif
+}
+
+void pipe_error(char argument){
+    // USB communications based implementation
+    #if USE_USB
+    printf("Recieved invalid character %c with value %u.\r\nThe usage is defined as: \r\n\r\n",argument,argument);
+    #endif
+    // Print generic helper
+    print_help_pipe_help();
+}
+
+// Reads the rate of option i in Hz into period_us, 0 for off. Returns false if it is out of range.
+static bool sched_rate(struct cmd* cmd_line, uint16_t i, uint32_t *period_us){
+    uint32_t milli_hz;
+    bool rate_fits = parse_rate_milli_hz(cmd_line, i, &milli_hz);
+    *period_us = 0;
+    if (rate_fits && (milli_hz == 0)){
+        // No rate or 0 turns the task off
+        return true;
+    }
+    if (rate_fits){
+        *period_us = (uint32_t) (1000000000ULL / milli_hz);
+    }
+    if (!rate_fits || (*period_us < TASK_SCHED_MIN_PERIOD_US) || (*period_us > TASK_SCHED_MAX_PERIOD_US)){
+        #if USE_USB
+        printf("The rate has to be 0 or between %u mHz and %u Hz.\r\n", (unsigned) (1000000000ULL / TASK_SCHED_MAX_PERIOD_US), (unsigned) (1000000 / TASK_SCHED_MIN_PERIOD_US));
+        #endif
+        return false;
+    }
+    return true;
+}
+
+// Queues a new period for the task called name
+static void sched_set(struct cmd* cmd_line, const char *name, uint32_t period_us){
+    int index = task_sched_find(cmd_line->sched, name);
+    if (index < 0){
+        #if USE_USB
+        printf("There is no %s task.\r\n", name);
+        #endif
+        return;
+    }
+    struct com_job entry = {.op = COM_JOB_SCHED_PERIOD, .handle = cmd_line->sched, .params.task = {(uint8_t) index, period_us}};
+    queue_add_blocking(&call_queue, &entry);
+}
+
+void sched_bin(struct cmd* cmd_line){
+    // The tasks and their statistics belong to main. Everything is queued to it, the statistics come back as a result.
+    uint32_t period_us = 0;
+    if (cmd_line->arg_len == 0){
+        // No args received print generic help
+        print_help_sched_help();
+        return;
+    }
+    for (uint16_t i = 0; i<cmd_line->arg_len; i++){
+        switch ((uint8_t) cmd_line->args[i]){
+            case 100: ;
+                // The d case
+                struct com_job stats_entry = {.op = COM_JOB_SCHED_STATS, .handle = cmd_line->sched};
+                queue_add_blocking(&call_queue, &stats_entry);
+                break;
+            case 101:
+                // The e case
+                if (!sched_rate(cmd_line, i, &period_us)){
+                    return;
+                }
+                sched_set(cmd_line, "bme280", period_us);
+                break;
+            case 104:
+                // The h case
+                print_help_sched_help();
+                return;
+            case 109:
+                // The m case
+                if (!sched_rate(cmd_line, i, &period_us)){
+                    return;
+                }
+                sched_set(cmd_line, "bmp180", period_us);
+                break;
+            case 112:
+                // The p case
+                if (!sched_rate(cmd_line, i, &period_us)){
+                    return;
+                }
+                sched_set(cmd_line, "pair", period_us);
+                break;
+            case 114: ;
+                // The r case
+                struct com_job reset_entry = {.op = COM_JOB_SCHED_RESET, .handle = cmd_line->sched};
+                queue_add_blocking(&call_queue, &reset_entry);
+                break;
+            default:
+                // Invalid input
+                sched_error(cmd_line->args[i]);
+                return;
+        }
+    }
+}
+
+void print_help_sched_help(){
+    // USB communications based implementation
+    #if USE_USB
+    printf("Usage for sched:\r\n-d, --status: Displays period, budget, runs, deadline misses, budget overruns, jitter and run time of every task.\r\n");
+    printf("-m, --bmp180: Samples the BMP180 at the rate of the integer or fixed point argument in Hz. 0 or none stops it.\r\n");
+    printf("-e, --bme280: Samples the BME280 at the rate of the integer or fixed point argument in Hz. 0 or none stops it.\r\n");
+    printf("-p, --pair: Samples both sensors in one conversion, same time stamp, at the rate of the argument in Hz. 0 or none stops it.\r\n");
+    printf("-r, --reset: Zeroes the statistics of every task.\r\n");
+    printf("-h, --help: Displays this help message.\r\n");
+    printf("Jitter is the delay from the release of a task to its start. A miss is a task that ended after its next release or never started.\r\n");
+    printf("Example: sched -m 5 -e 0.5 -r\r\n");
+    printf("Default: Displays this help message.\r\n");
+    #endif
+}
+
+void sched_error(char argument){
+    // USB communications based implementation
+    #if USE_USB
+    printf("Recieved invalid character %c with value %u.\r\nThe usage is defined as: \r\n\r\n",argument,argument);
+    #endif
+    // Print generic helper
+    print_help_sched_help();
+}
+
+// Bus with the number given to option i, NULL if there is no such bus in this build
+static struct i2c_bus *i2c_bin_bus(struct cmd* cmd_line, uint16_t i){
+    int32_t number;
+    if (!cmd_value_int(cmd_line, (uint8_t) i, &number)){
+        return NULL;
+    }
+    switch (number){
+        case 0:
+            return cmd_line->i2c;
+        #if I2C_EEPROM_ON_PIO_BUS
+        case 1:
+            return &i2c_bus1;
+        #endif
+        default:
+            return NULL;
+    }
+}
+
+void i2c_bin(struct cmd* cmd_line){
+    // The statistics live in RAM and do not touch the bus, so they are printed right here on core1
+    // Everything but -s and -p acts on the bus picked with -b, i2c_bus0 unless it is given
+    struct i2c_bus *bus = cmd_line->i2c;
+    switch (cmd_line->arg_len){
+        case 0:
+            // No args received print generic help
+            print_help_i2c_help();
+            break;
+        default: ; // This empty label is so we can use declerations
+            for (uint16_t i = 0; i<cmd_line->arg_len; i++){
+                switch ((uint8_t) cmd_line->args[i]){
+                    case 98:
+                        // The b case
+                        bus = i2c_bin_bus(cmd_line, i);
+                        if (bus == NULL){
+                            #if USE_USB
+                            printf("There is no such bus, 0 is the hardware bus and 1 the PIO bus with I2C_EEPROM_ON_PIO_BUS set.\r\n");
+                            #endif
+                            return;
+                        }
+                        break;
+                    case 119:
+                        // The w case
+                        print_i2c_bus_wait_stats(bus);
+                        break;
+                    case 115:
+                        // The s case
+                        print_i2c_bus_stats(cmd_line->i2c);
+                        #if I2C_EEPROM_ON_PIO_BUS
+                        print_i2c_bus_stats(&i2c_bus1);
+                        #endif
+                        print_sensor_max_sample_rates(cmd_line->bmp_180, cmd_line->bme_280);
+                        break;
+                    case 114:
+                        // The r case. Take the bus so a transaction in flight is not half counted.
+                        i2c_bus_acquire(bus);
+                        i2c_stats_reset(&bus->stats, time_us_32());
+                        i2c_bus_reset_wait_stats(bus);
+                        i2c_bus_release(bus);
+                        break;
+                    case 99:
+                        // The c case. Starts a new capture, records still in the ring are lost.
+                        i2c_bus_acquire(bus);
+                        i2c_trace_start(&bus->trace);
+                        i2c_bus_release(bus);
+                        // This core is the reader, it frees the space of the old records
+                        i2c_trace_discard(&bus->trace);
+                        break;
+                    case 120:
+                        // The x case
+                        i2c_bus_acquire(bus);
+                        i2c_trace_stop(&bus->trace);
+                        i2c_bus_release(bus);
+                        break;
+                    case 100:
+                        // The d case. Drains without the bus, the capture keeps running.
+                        print_i2c_trace(bus);
+                        break;
+                    case 112: ;
+                        // The p case. The engines belong to main, so the batch runs there.
+                        struct com_job probe_entry = {.op = COM_JOB_I2C_PROBE, .handle = &i2c_probe_batch};
+                        queue_add_blocking(&call_queue, &probe_entry);
+                        break;
+                    case 104:
+                        // The h case. We also break out of the for loop
+                        print_help_i2c_help();
+                        i = cmd_line->arg_len;
+                        break;
+                    default:
+                        // Invalid input
+                        i2c_error(cmd_line->args[i]);
+                        i = cmd_line->arg_len;
+                        break;
+                }
+            }
+            break;
+    }
+}
+
+void print_help_i2c_help(){
+    // USB communications based implementation
+    #if USE_USB
+    printf("Usage for i2c:\r\n-b, --bus: Selects the bus of the options after it. 0 is the hardware bus (default), 1 the PIO bus when I2C_EEPROM_ON_PIO_BUS is set. Place it first.\r\n");
+    printf("-w, --wait: Displays how long each core waited for bus ownership.\r\n");
+    printf("-s, --stats: Displays transactions, bytes, NACKs, timeouts and a latency histogram per address, the bus occupancy over the last second and the max sensor sample rates.\r\n");
+    printf("-r, --reset: Resets all bus statistics.\r\n");
+    printf("-p, --probe: Reads the chip ID of every device in one batch, devices on different buses at the same time.\r\n");
+    printf("-c, --capture: Starts capturing every transfer into the trace ring.\r\n");
+    printf("-x, --stop: Stops the capture.\r\n");
+    printf("-d, --drain: Prints and empties the trace ring, one " I2C_TRACE_TAG " line per transfer. Save the output to replay it in a host build.\r\n");
+    printf("-h, --help: Displays this help message.\r\n");
+    printf("Example: i2c -b 1 -cd\r\n");
+    printf("Default: Displays this help message.\r\n");
+    #endif
+}
+
+void i2c_error(char argument){
+    // USB communications based implementation
+    #if USE_USB
+    printf("Recieved invalid character %c with value %u.\r\nThe usage is defined as: \r\n\r\n",argument,argument);
+    #endif
+    // Print generic helper
+    print_help_i2c_help();
+}
+
+void binary_bin(struct cmd* cmd_line){
+    // Binary mode runs on core1 alone, nothing is queued to main
+    for (uint16_t i = 0; i<cmd_line->arg_len; i++){
+        switch ((uint8_t) cmd_line->args[i]){
+            case 104:
+                // The h case
+                print_help_binary_help();
+                return;
+            default:
+                // Invalid input
+                binary_error(cmd_line->args[i]);
+                return;
+        }
+    }
+    com_binary_enter();
+}
+
+void print_help_binary_help(){
+    // USB communications based implementation
+    #if USE_USB
+    printf("Usage for binary:\r\n-h, --help: Displays this help message.\r\n");
+    printf("Default: Switches the link to COBS framed binary messages with a CRC16 until the host sends an exit message.\r\n");
+    printf("Text commands are still accepted inside command messages. See com_binary.h for the frame layout.\r\n");
+    #endif
+}
+
+void binary_error(char argument){
+    // USB communications based implementation
+    #if USE_USB
+    printf("Recieved invalid character %c with value %u.\r\nThe usage is defined as: \r\n\r\n",argument,argument);
+    #endif
+    // Print generic helper
+    print_help_binary_help();
+}
+
+// I2C bus Print Functions Defines
+
+void print_i2c_bus_wait_stats(struct i2c_bus* bus){
+    #if USE_USB
+    printf("\r==== I2C Bus Ownership Wait ==== \r\n");
+    for (uint8_t core = 0; core < I2C_BUS_N_CORES; core++){
+        struct i2c_bus_wait_stats *stats = &bus->wait[core];
+        uint32_t mean = (stats->acquisitions == 0) ? 0 : (uint32_t) (stats->total_wait_us / stats->acquisitions);
+        printf("core%u: acquisitions = %u, contended = %u, mean wait = %u us, max wait = %u us \r\n", core, stats->acquisitions, stats->contended, mean, stats->max_wait_us);
+    }
+    #endif
+}
+
+void i2c_probe_chips(struct i2c_probe* probe){
+    const struct i2c_device *devices[COM_PROTO_N_PROBES] = {&bmp180_i2c_device, &bme280_i2c_device, lcb16b_i2c_device(LCB16B_CHIP_ID_ADDR)};
+    const uint8_t regs[COM_PROTO_N_PROBES] = {BMP_180_CHIP_ID_ADDR, BME_280_CHIP_ID_ADDR, LCB16B_CHIP_ID_ADDR & 0x0FF};
+    // After a timeout the engines may still point at the descriptors, see i2c_sched.h. Only refill them once all are out.
+    probe->busy = false;
+    if (probe->answer == PICO_ERROR_TIMEOUT){
+        for (uint8_t i = 0; i < COM_PROTO_N_PROBES; i++){
+            probe->busy |= (probe->txns[i].status == I2C_ASYNC_PENDING);
+        }
+        if (probe->busy){
+            return;
+        }
+    }
+    memset(probe->txns, 0, sizeof(probe->txns));
+    for (uint8_t i = 0; i < COM_PROTO_N_PROBES; i++){
+        probe->regs[i] = regs[i];
+        probe->ids[i] = 0;
+        probe->txns[i].dev = devices[i];
+        probe->txns[i].tx = &probe->regs[i];
+        probe->txns[i].tx_len = 1;
+        probe->txns[i].rx = &probe->ids[i];
+        probe->txns[i].rx_len = 1;
+    }
+    uint32_t start = time_us_32();
+    probe->answer = i2c_sched_run(probe->txns, COM_PROTO_N_PROBES, COM_PROTO_PROBE_TIMEOUT_US);
+    probe->elapsed_us = time_us_32() - start;
+}
+
+void print_i2c_probe_results(const struct i2c_probe* probe){
+    #if USE_USB
+    printf("\r==== I2C Probe ==== \r\n");
+    if (probe->busy){
+        printf("Reads of the last batch are still queued, try again later. \r\n");
+        return;
+    }
+    for (uint8_t i = 0; i < COM_PROTO_N_PROBES; i++){
+        const struct i2c_async_txn *txn = &probe->txns[i];
+        printf("%s on %s addr 0x%02x: reg 0x%02x = 0x%02x (%s) \r\n", txn->dev->name, txn->dev->bus->name, txn->dev->addr, probe->regs[i], probe->ids[i], (txn->status == I2C_ASYNC_DONE) ? "done" : ((txn->status == I2C_ASYNC_ABORTED) ? "aborted" : "pending"));
+    }
+    if (probe->answer == PICO_ERROR_TIMEOUT){
+        printf("Batch timed out after %u us \r\n", probe->elapsed_us);
+    }
+    else {
+        printf("Batch of %u reads finished in %u us, %d succeeded \r\n", COM_PROTO_N_PROBES, probe->elapsed_us, probe->answer);
+    }
+    #endif
+}
+
+// Only core1 prints, the record data is too large for its stack
+static uint8_t i2c_trace_data[I2C_TRACE_MAX_DATA];
+
+void print_i2c_trace(struct i2c_bus* bus){
+    #if USE_USB
+    struct i2c_trace_record record;
+    // Format: tag, start us, duration us, addr, flags, result, len, data as hex. i2c_replay.c parses the same.
+    while (i2c_trace_pop(&bus->trace, &record, i2c_trace_data)){
+        printf(I2C_TRACE_TAG " %u %u %02x %02x %d %u ", record.start_us, record.duration_us, record.addr, record.flags, record.result, record.len);
+        uint16_t stored = i2c_trace_stored_len(&record);
+        for (uint16_t i = 0; i < stored; i++){
+            printf("%02x", i2c_trace_data[i]);
+        }
+        printf("\r\n");
+    }
+    printf("Trace %s, %u records captured, %u dropped. \r\n", bus->trace.capturing ? "capturing" : "stopped", bus->trace.records, bus->trace.dropped);
+    #endif
+}
+
+// Only core1 prints, the snapshot is too large for its stack
+static struct i2c_stats i2c_stats_snapshot;
+
+void print_i2c_bus_stats(struct i2c_bus* bus){
+    // Copy while owning the bus so the numbers belong together
+    i2c_bus_acquire(bus);
+    uint32_t occupancy = i2c_stats_occupancy_permille(&bus->stats, time_us_32());
+    memcpy(&i2c_stats_snapshot, &bus->stats, sizeof(struct i2c_stats));
+    uint32_t recoveries = bus->recoveries;
+    i2c_bus_release(bus);
+
+    #if USE_USB
+    printf("\r==== I2C Bus Statistics (%s) ==== \r\n", bus->name);
+    printf("Occupancy over the last %u ms = %u.%u %% \r\n", (I2C_STATS_SLOT_US * I2C_STATS_WINDOW_SLOTS) / 1000, occupancy / 10, occupancy % 10);
+    printf("Bus recoveries = %u, untracked transactions = %u \r\n", recoveries, i2c_stats_snapshot.dropped);
+    for (uint8_t i = 0; i < I2C_STATS_MAX_ADDR; i++){
+        struct i2c_stats_entry *entry = &i2c_stats_snapshot.entries[i];
+        if (entry->addr == I2C_STATS_NO_ADDR){
+            break;
+        }
+        uint32_t mean = (entry->transactions == 0) ? 0 : (uint32_t) (entry->total_us / entry->transactions);
+        printf("addr 0x%02x: transactions = %u, bytes = %u, NACKs = %u, timeouts = %u, mean = %u us, max = %u us \r\n", entry->addr, entry->transactions, entry->bytes, entry->nacks, entry->timeouts, mean, entry->max_us);
+        printf("    latency histogram:");
+        for (uint8_t bucket = 0; bucket < I2C_STATS_N_BUCKETS; bucket++){
+            if (entry->histogram[bucket] != 0){
+                printf(" [%u us]=%u", 1u << bucket, entry->histogram[bucket]);
+            }
+        }
+        printf("\r\n");
+    }
+    #endif
+}
+
+void print_sensor_max_sample_rates(struct bmp180_model* bmp_180, struct bme280_model* bme_280){
+    #if USE_USB
+    // Rates are printed in mHz to keep to integers
+    uint32_t bmp_conversion = bmp180_conversion_time_us(bmp_180);
+    uint32_t bmp_bus = bmp180_bus_time_us(bmp_180);
+    printf("\r==== Max Sample Rates ==== \r\n");
+    printf("BMP180: conversions = %u us, bus = %u us, max rate = %u mHz, bus limit = %u mHz \r\n", bmp_conversion, bmp_bus, (uint32_t) (1000000000ull / (bmp_conversion + bmp_bus)), (uint32_t) (1000000000ull / bmp_bus));
+    uint32_t bme_period = bme280_sample_period_us(bme_280);
+    uint32_t bme_bus = bme280_bus_time_us(bme_280);
+    printf("BME280: measurement = %u us, period = %u us, bus = %u us, max rate = %u mHz, bus limit = %u mHz \r\n", bme280_measurement_time_us(bme_280), bme_period, bme_bus, (uint32_t) (1000000000ull / bme_period), (uint32_t) (1000000000ull / bme_bus));
+    // A pair waits out the slower chip once and does one BMP180 conversion
+    uint32_t pair_conversion = sensor_pair_conversion_time_us(bmp_180, bme_280);
+    uint32_t pair_bus = bmp_bus / BMP_180_SS + bme_bus;
+    printf("Pair: conversions = %u us, bus = %u us, max rate = %u mHz \r\n", pair_conversion, pair_bus, (uint32_t) (1000000000ull / (pair_conversion + pair_bus)));
+    #endif
+}
+
+// BMP_180 Print Functions Defines
+
+// Print functions to be called by Serial queries.
+void print_temp_results_bmp180(const struct bmp180_measurements* measure, uint8_t v)
+{
+    #if USE_USB
+    printf("\r==== Temperature Measurement Results ==== \r\n");
+    // Only print these if verbose
+    if (v == 1){
+    printf("Obtained UT = %i \r\n",measure->ut);
+    printf("Intermittent step X1 = %i \r\n",measure->X1_tmp);
+    printf("Intermittent step X2 = %i \r\n",measure->X2_tmp);
+    printf("Obtained B5 = %i \r\n",measure->B5);
+    printf("Overall sample sum for %u samples = %i \r\n",BMP_180_SS,measure->T_sum);
+    }
+    printf("Obtained TMP in 0.1C = %d \r\n",measure->T);
+    #endif
+}
+
+void print_press_results_bmp180(const struct bmp180_measurements* measure, uint8_t v){
+    #if USE_USB
+    printf("\r==== Pressure Measurement Results ==== \r\n");
+    // Only print these if verbose
+    if (v == 1){
+    printf("Obtained UP = %i \r\n",measure->up);
+
+    printf("Obtained B6 = %i \r\n",measure->B6);
+    printf("Intermittent step X1_1 = %i \r\n",measure->X1_p_1);
+    printf("Intermittent step X2_1 = %i \r\n",measure->X2_p_1);
+    printf("Intermittent step X3_1 = %i \r\n",measure->X3_p_1);
+
+    printf("Intermittent step X1_2 = %i \r\n",measure->X1_p_2);
+    printf("Intermittent step X2_2 = %i \r\n",measure->X2_p_2);
+    printf("Intermittent step X3_2 = %i \r\n",measure->X3_p_2);
+
+    printf("Obtained B3 = %u \r\n",measure->B3);
+    printf("Obtained B4 = %u \r\n",measure->B4);
+    printf("Obtained B7 = %u \r\n",measure->B7);
+    printf("Compensated pressure (P_1) before tuning = %i \r\n",measure->p_inter);
+
+    printf("Intermittent step X1_3 = %i \r\n",measure->X1_p_3);
+
+    printf("Intermittent step X1_4 = %i \r\n",measure->X1_p_4);
+    printf("Intermittent step X2_3 = %i \r\n",measure->X2_p_3);
+
+    printf("Overall sample sum for %u samples = %i \r\n",BMP_180_SS,measure->p_sum);
+    }
+    printf("Obtained Pressure in 1Pa = %d \r\n",measure->p);
+    #endif
+}
+
+void print_altitude_results_bmp180(const struct bmp180_measurements* measure){
+    #if USE_USB
+    printf("\rCurrently the device is at %f (m) \r\n",measure->altitude);
+    #endif
+}
+
+void print_relative_pressure_results_bmp180(const struct bmp180_measurements* measure){
+    #if USE_USB
+    printf("\rRelative pressure at sea level for device = %f Pa \r\n",measure->p_relative);
+    #endif
+}
+
+void print_sample_bmp180(const struct bmp180_sample* sample){
+    #if USE_USB
+    printf("\r==== Last BMP180 Sample (%u us ago) ==== \r\n",time_us_32() - sample->time_us);
+    printf("TMP in 0.1C = %d, Pressure in 1Pa = %d \r\n",sample->T,sample->p);
+    printf("Altitude = %f (m), relative sea pressure = %f Pa \r\n",sample->altitude,sample->p_relative);
+    #endif
+}
+
+void print_chip_ID_bmp180(struct bmp180_model* my_chip){
+    #if USE_USB
     printf("\rFor BMP180 ChipID = %u \r\n",my_chip->chipID);
     #endif
 }
@@ -718,6 +1716,109 @@ void print_eeprom_chip_ID(struct lcb16b_eeprom* my_eeprom){
     #endif
 }
 
+void print_eeprom_dump_chunk(uint16_t reg, const uint8_t *data, uint16_t len, void *ctx){
+    #if USE_USB
+    // 16 bytes per line, each line prefixed with the address of its first byte
+    for (uint16_t i = 0; i < len; i++){
+        if (((reg + i) % 16 == 0) || (i == 0)){
+            printf("\r0x%03x:",reg + i);
+        }
+        printf(" %02x",data[i]);
+        if (((reg + i) % 16 == 15) || (i == (len - 1))){
+            printf("\r\n");
+        }
+    }
+    #endif
+}
+
+// Eeprom log print functions defines
+
+void print_eeprom_log_query_results(const struct com_log_query_payload* query){
+    #if USE_USB
+    printf("\r==== Log Query Results ==== \r\n");
+    if (query->status != BLOCK_STORAGE_OK){
+        printf("Reading the log storage failed with %d, the results are incomplete. \r\n",query->status);
+    }
+    printf("Matched %u of %u samples. \r\n",query->n_matched,query->count);
+    if (query->n_matched == 0){
+        return;
+    }
+    if (query->aggregate){
+        printf("Min = %u \r\n",query->min);
+        printf("Max = %u \r\n",query->max);
+        printf("Mean = %u \r\n",query->mean);
+        return;
+    }
+    for (uint16_t i = 0; i<query->n_results; i++){
+        uint32_t ts = query->results[i].timestamp;
+        printf("Day %02u %02u:%02u:%02u = %u \r\n",ts / 86400,(ts / 3600) % 24,(ts / 60) % 60,ts % 60,query->results[i].value);
+    }
+    if (query->n_matched > query->n_results){
+        printf("%u more samples not shown. Narrow the window or use -a. \r\n",query->n_matched - query->n_results);
+    }
+    #endif
+}
+
+void print_eeprom_log_append_results(const struct com_log_append_payload* append){
+    #if USE_USB
+    if (append->status != BLOCK_STORAGE_OK){
+        printf("\rLogging %u failed, the storage returned %d. The log still holds %u samples. \r\n",append->value,append->status,append->count);
+        return;
+    }
+    printf("\rLogged %u. The log now holds %u samples. \r\n",append->value,append->count);
+    #endif
+}
+
+// Stream, pipeline and task scheduler print functions defines
+
+void print_stream_status(struct stream* stream){
+    #if USE_USB
+    printf("\r==== Stream ==== \r\n");
+    printf("%s, channels 0x%02x every %u us.\r\n", stream->running ? "Running" : "Stopped", stream->channels, stream->period_us);
+    printf("Ticks %u, skipped %u, samples sent %u, dropped %u, waiting %u of %u, high water %u.\r\n",
+        stream->ticks, stream->skipped, stream->sent, stream->samples.dropped, spsc_ring_level(&stream->samples),
+        spsc_ring_capacity(&stream->samples), stream->samples.high_water);
+    #endif
+}
+
+void print_pipeline_status(struct pipeline* pipe){
+    #if USE_USB
+    printf("\r==== Pipeline ==== \r\n");
+    printf("%s, sensors 0x%02x every %u us.\r\n", pipe->running ? "Running" : "Stopped", pipe->sensors, pipe->period_us);
+    printf("Ticks %u, skipped %u, reads %u, dropped %u, processed %u, waiting %u of %u, high water %u.\r\n",
+        pipe->ticks, pipe->skipped, pipe->acquired, pipe->raw.dropped, pipe->processed, spsc_ring_level(&pipe->raw),
+        spsc_ring_capacity(&pipe->raw), pipe->raw.high_water);
+    printf("core0 acquire: mean %u us, max %u us.\r\n", (pipe->acquired != 0) ? pipe->acquire_us / pipe->acquired : 0, pipe->acquire_max_us);
+    printf("core1 process: mean %u us, max %u us.\r\n", (pipe->processed != 0) ? pipe->process_us / pipe->processed : 0, pipe->process_max_us);
+    #endif
+}
+
+void print_pipeline_bench_results(const struct pipeline_bench* bench){
+    #if USE_USB
+    printf("\r==== Pipeline Benchmark ==== \r\n");
+    printf("%u samples of sensors 0x%02x, %u reads per run.\r\n", bench->samples, bench->sensors, bench->records);
+    if ((bench->one_core_us == 0) || (bench->two_core_us == 0) || (bench->records == 0)){
+        printf("Nothing was read.\r\n");
+        return;
+    }
+    printf("One core: %u us, %u mHz.\r\n", bench->one_core_us, (unsigned) ((uint64_t) bench->samples * 1000000000ULL / bench->one_core_us));
+    printf("Two cores: %u us, %u mHz.\r\n", bench->two_core_us, (unsigned) ((uint64_t) bench->samples * 1000000000ULL / bench->two_core_us));
+    printf("Per read: acquire %u us on core0, process %u us on core1.\r\n", bench->acquire_us / bench->records, bench->process_us / bench->records);
+    #endif
+}
+
+void print_sched_stats(const struct task_sched_snapshot* snapshot){
+    #if USE_USB
+    printf("\r==== Tasks over %u ms ==== \r\n", snapshot->elapsed_ms);
+    printf("task, period us, phase us, budget us, runs, misses, overruns, jitter mean/max us, run mean/max us\r\n");
+    for (uint8_t i = 0; i < snapshot->n_tasks; i++){
+        const struct task_sched_report *task = &snapshot->tasks[i];
+        printf("%s, %u, %u, %u, %u, %u, %u, %u/%u, %u/%u\r\n", task->name, task->period_us, task->phase_us, task->budget_us,
+            task->runs, task->misses, task->overruns, task->jitter_mean_us, task->jitter_max_us, task->run_mean_us, task->run_max_us);
+    }
+    #endif
+}
+
 // BME280 print functions defines 
 void print_cal_params_bme280(struct bme280_model* my_chip){
     #if USE_USB
@@ -0,0 +1,43 @@
+#include "../include/dlog.h"
+
+static struct dlog_record dlog_records[2][DLOG_RING_LEN];
+// Statically set up, drivers log before anything could initialize them
+static struct dlog_ring dlog_rings[2] = {
+    {.ring = SPSC_RING_STATIC(dlog_records[0])},
+    {.ring = SPSC_RING_STATIC(dlog_records[1])},
+};
+
+void dlog_write(uint8_t level, const char *fmt, const uintptr_t *args, uint8_t n_args){
+    struct dlog_record record;
+    record.fmt = fmt;
+    record.level = level;
+    record.n_args = n_args;
+    for (uint8_t i = 0; i < n_args; i++){
+        record.args[i] = args[i];
+    }
+
+    // Only this core writes the ring, keeping its own interrupts out is enough
+    uint32_t ints = save_and_disable_interrupts();
+    record.time_us = time_us_32();
+    spsc_ring_push(&dlog_rings[get_core_num()].ring, &record);
+    restore_interrupts(ints);
+}
+
+uint32_t dlog_drain(uint32_t max){
+    uint32_t printed = 0;
+    for (uint8_t core = 0; core < 2; core++){
+        struct dlog_ring *ring = &dlog_rings[core];
+        struct dlog_record record;
+        while ((printed < max) && spsc_ring_pop(&ring->ring, &record)){
+            // Unused arguments are ignored by printf
+            printf(record.fmt, record.args[0], record.args[1], record.args[2], record.args[3]);
+            printed++;
+        }
+        uint32_t dropped = ring->ring.dropped;
+        if (dropped != ring->reported){
+            printf("[DLOG]: core%u dropped %u records.\r\n", core, dropped - ring->reported);
+            ring->reported = dropped;
+        }
+    }
+    return printed;
+}
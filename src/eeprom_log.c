@@ -0,0 +1,319 @@
+#include "../include/eeprom_log.h"
+
+// Context of a scan over the slots, one record handler per use
+struct eeprom_log_scan {
+    struct eeprom_log *log;
+    uint32_t slot; // Slot of the record handed to on_record
+    bool stop; // Set by the record handler to ignore the rest of the scan
+    uint32_t newest_slot; // Used by the rebuild
+    uint32_t newest_ts; // Used by the rebuild
+    uint64_t sum; // Used by the query for the mean
+    void (*on_record)(struct eeprom_log_scan *scan, const struct eeprom_log_sample *sample, bool valid);
+};
+
+uint32_t eeprom_log_timestamp(uint8_t day, uint8_t hour, uint8_t min, uint8_t sec){
+    return (((uint32_t) day * 24 + hour) * 60 + min) * 60 + sec;
+}
+
+uint32_t eeprom_log_timestamp_from_ddhhmmss(uint32_t ddhhmmss){
+    return eeprom_log_timestamp((ddhhmmss / 1000000) % 100, (ddhhmmss / 10000) % 100, (ddhhmmss / 100) % 100, ddhhmmss % 100);
+}
+
+uint32_t eeprom_log_slot_address(uint32_t slot){
+    return slot * EEPROM_LOG_RECORD_SIZE;
+}
+
+// Returns the index entry a slot falls in
+static struct eeprom_log_index_entry *eeprom_log_slot_entry(struct eeprom_log *log, uint32_t slot){
+    return &log->index[slot / log->index_slots];
+}
+
+// Decodes a raw record. Erased cells read as 0xFF so they fail the range checks.
+static bool eeprom_log_decode(const uint8_t *record, struct eeprom_log_sample *sample){
+    if ((record[0] == 0) || (record[0] > 31) || (record[1] > 23) || (record[2] > 59) || (record[3] > 59)){
+        return false;
+    }
+    sample->timestamp = eeprom_log_timestamp(record[0], record[1], record[2], record[3]);
+    // MSB first, same as lcb16b_set_src
+    sample->value = ((uint32_t) record[4] << 24) | ((uint32_t) record[5] << 16) | ((uint32_t) record[6] << 8) | record[7];
+    return true;
+}
+
+// Lays a sample out as a raw record, the inverse of eeprom_log_decode
+static void eeprom_log_encode(uint8_t *record, uint32_t timestamp, uint32_t value){
+    record[0] = timestamp / 86400;
+    record[1] = (timestamp / 3600) % 24;
+    record[2] = (timestamp / 60) % 60;
+    record[3] = timestamp % 60;
+    record[4] = value >> 24;
+    record[5] = (value >> 16) & 0xFF;
+    record[6] = (value >> 8) & 0xFF;
+    record[7] = value & 0xFF;
+}
+
+// Reads n physically consecutive slots starting at first and hands every record to the scan handler.
+// The chunk is a whole number of records, so a record never spans two reads.
+static int eeprom_log_scan_slots(struct eeprom_log_scan *scan, uint32_t first, uint32_t n){
+    uint8_t chunk[EEPROM_LOG_SCAN_CHUNK];
+    scan->slot = first;
+    while ((n > 0) && !scan->stop){
+        uint32_t slots = EEPROM_LOG_SCAN_CHUNK / EEPROM_LOG_RECORD_SIZE;
+        if (slots > n){
+            slots = n;
+        }
+        int res = block_storage_read(scan->log->storage, eeprom_log_slot_address(scan->slot), chunk, slots * EEPROM_LOG_RECORD_SIZE);
+        if (res != BLOCK_STORAGE_OK){
+            return res;
+        }
+        for (uint32_t i = 0; (i < slots) && !scan->stop; i++){
+            struct eeprom_log_sample sample;
+            bool valid = eeprom_log_decode(chunk + i * EEPROM_LOG_RECORD_SIZE, &sample);
+            scan->on_record(scan, &sample, valid);
+            scan->slot++;
+        }
+        n -= slots;
+    }
+    return BLOCK_STORAGE_OK;
+}
+
+// Returns the oldest slot in the log
+static uint32_t eeprom_log_oldest(struct eeprom_log *log){
+    return (log->head + log->n_slots - log->count) % log->n_slots;
+}
+
+// Returns the chronological position of a slot, 0 being the oldest record
+static uint32_t eeprom_log_position(struct eeprom_log *log, uint32_t slot){
+    return (slot + log->n_slots - eeprom_log_oldest(log)) % log->n_slots;
+}
+
+static void eeprom_log_rebuild_record(struct eeprom_log_scan *scan, const struct eeprom_log_sample *sample, bool valid){
+    if (!valid){
+        return;
+    }
+    struct eeprom_log *log = scan->log;
+    log->count++;
+
+    // The newest record has the largest key. Equal keys are resolved in favour of the later slot.
+    if ((log->count == 1) || (sample->timestamp >= scan->newest_ts)){
+        scan->newest_ts = sample->timestamp;
+        scan->newest_slot = scan->slot;
+    }
+
+    struct eeprom_log_index_entry *entry = eeprom_log_slot_entry(log, scan->slot);
+    if (entry->first_slot == scan->slot){
+        entry->first_ts = sample->timestamp;
+        entry->valid = true;
+    }
+}
+
+int eeprom_log_rebuild_index(struct eeprom_log *log){
+    for (uint8_t i = 0; i < EEPROM_LOG_INDEX_LEN; i++){
+        uint32_t first_slot = i * log->index_slots;
+        log->index[i].first_slot = (first_slot < log->n_slots) ? first_slot : EEPROM_LOG_NO_SLOT;
+        log->index[i].first_ts = 0;
+        log->index[i].valid = false;
+    }
+
+    log->count = 0;
+    log->head = 0;
+
+    struct eeprom_log_scan scan = {.log = log, .stop = false, .newest_slot = 0, .newest_ts = 0, .on_record = eeprom_log_rebuild_record};
+    int res = eeprom_log_scan_slots(&scan, 0, log->n_slots);
+    if (res != BLOCK_STORAGE_OK){
+        // Better an empty log than one that overwrites what could not be read
+        log->count = 0;
+        #if EEPROM_LOG_INFO
+        printf("[EEPROM_LOG]: Reading the %s failed with %d, the log is empty.\r\n", log->storage->name, res);
+        #endif
+        return res;
+    }
+
+    // The next write goes right after the newest record
+    log->head = (log->count == 0) ? 0 : (scan.newest_slot + 1) % log->n_slots;
+
+    #if EEPROM_LOG_INFO
+    printf("[EEPROM_LOG]: Index rebuilt with %u records on the %s, next slot %u of %u.\r\n", log->count, log->storage->name, log->head, log->n_slots);
+    #endif
+    return BLOCK_STORAGE_OK;
+}
+
+int eeprom_log_init(struct eeprom_log *log, struct block_storage *storage){
+    log->storage = storage;
+    log->q_start = 0;
+    log->q_end = UINT32_MAX;
+    log->q_aggregate = false;
+    log->q_value = 0;
+    log->n_results = 0;
+    log->n_matched = 0;
+    log->head = 0;
+    log->count = 0;
+    log->n_slots = 0;
+
+    // A record has to fill its program unit a whole number of times, and a program unit its erase unit
+    uint32_t unit = (storage->program_size > EEPROM_LOG_RECORD_SIZE) ? storage->program_size : EEPROM_LOG_RECORD_SIZE;
+    if ((storage->program_size > EEPROM_LOG_MAX_PROGRAM) || ((unit % storage->program_size) != 0) || ((unit % EEPROM_LOG_RECORD_SIZE) != 0)
+        || (storage->needs_erase && ((storage->erase_size % unit) != 0))){
+        #if EEPROM_LOG_INFO
+        printf("[EEPROM_LOG]: The %s can not hold the log, program size %u, erase size %u.\r\n", storage->name, storage->program_size, storage->erase_size);
+        #endif
+        return BLOCK_STORAGE_ALIGN;
+    }
+    log->program_slots = unit / EEPROM_LOG_RECORD_SIZE;
+    if (storage->needs_erase){
+        log->erase_slots = storage->erase_size / EEPROM_LOG_RECORD_SIZE;
+        log->n_slots = (storage->size / storage->erase_size) * log->erase_slots;
+    }
+    else {
+        log->erase_slots = 0;
+        log->n_slots = (storage->size / unit) * log->program_slots;
+    }
+    if (log->n_slots == 0){
+        return BLOCK_STORAGE_RANGE;
+    }
+    log->index_slots = (log->n_slots + EEPROM_LOG_INDEX_LEN - 1) / EEPROM_LOG_INDEX_LEN;
+    return eeprom_log_rebuild_index(log);
+}
+
+// Erases the erase unit starting at slot and forgets the records that were in it
+static int eeprom_log_erase_unit(struct eeprom_log *log, uint32_t slot){
+    int res = block_storage_erase(log->storage, eeprom_log_slot_address(slot), log->erase_slots * EEPROM_LOG_RECORD_SIZE);
+    if (res != BLOCK_STORAGE_OK){
+        return res;
+    }
+    // Slots from the head to the end of its unit are always erased, so the unit only held the oldest records
+    uint32_t kept = log->n_slots - log->erase_slots;
+    if (log->count > kept){
+        log->count = kept;
+    }
+    for (uint8_t i = 0; i < EEPROM_LOG_INDEX_LEN; i++){
+        struct eeprom_log_index_entry *entry = &log->index[i];
+        if ((entry->first_slot >= slot) && (entry->first_slot < slot + log->erase_slots)){
+            entry->valid = false;
+        }
+    }
+    return BLOCK_STORAGE_OK;
+}
+
+int eeprom_log_append(struct eeprom_log *log, uint32_t timestamp, uint32_t value){
+    uint32_t slot = log->head;
+
+    if ((log->erase_slots != 0) && ((slot % log->erase_slots) == 0)){
+        int res = eeprom_log_erase_unit(log, slot);
+        if (res != BLOCK_STORAGE_OK){
+            return res;
+        }
+    }
+
+    // Backends that program more than a record at a time get the neighbours back as they are
+    uint8_t unit[EEPROM_LOG_MAX_PROGRAM];
+    uint32_t unit_slot = slot - (slot % log->program_slots);
+    uint32_t unit_len = log->program_slots * EEPROM_LOG_RECORD_SIZE;
+    if (log->program_slots > 1){
+        int res = block_storage_read(log->storage, eeprom_log_slot_address(unit_slot), unit, unit_len);
+        if (res != BLOCK_STORAGE_OK){
+            return res;
+        }
+    }
+    eeprom_log_encode(unit + (slot - unit_slot) * EEPROM_LOG_RECORD_SIZE, timestamp, value);
+    int res = block_storage_program(log->storage, eeprom_log_slot_address(unit_slot), unit, unit_len);
+    if (res != BLOCK_STORAGE_OK){
+        #if EEPROM_LOG_DEBUG
+        DLOG_DEBUG("[EEPROM_LOG]: Writing slot %u failed with %d.\r\n", slot, res);
+        #endif
+        return res;
+    }
+
+    // Keep the index in step with the storage
+    struct eeprom_log_index_entry *entry = eeprom_log_slot_entry(log, slot);
+    if (entry->first_slot == slot){
+        entry->first_ts = timestamp;
+        entry->valid = true;
+    }
+
+    log->head = (slot + 1) % log->n_slots;
+    if (log->count < log->n_slots){
+        log->count++;
+    }
+
+    #if EEPROM_LOG_DEBUG
+    DLOG_DEBUG("[EEPROM_LOG]: Logged %u at slot %u with time stamp %u.\r\n", value, slot, timestamp);
+    #endif
+    return BLOCK_STORAGE_OK;
+}
+
+static void eeprom_log_query_record(struct eeprom_log_scan *scan, const struct eeprom_log_sample *sample, bool valid){
+    struct eeprom_log *log = scan->log;
+    if (!valid){
+        return;
+    }
+    // Records are visited in time order, so we are done once we pass the window
+    if (sample->timestamp > log->q_end){
+        scan->stop = true;
+        return;
+    }
+    if (sample->timestamp < log->q_start){
+        return;
+    }
+
+    if ((log->n_matched == 0) || (sample->value < log->min)){
+        log->min = sample->value;
+    }
+    if ((log->n_matched == 0) || (sample->value > log->max)){
+        log->max = sample->value;
+    }
+    scan->sum += sample->value;
+    log->n_matched++;
+
+    if (!log->q_aggregate && (log->n_results < EEPROM_LOG_QUERY_MAX)){
+        log->results[log->n_results] = *sample;
+        log->n_results++;
+    }
+}
+
+int eeprom_log_query(struct eeprom_log *log){
+    log->n_results = 0;
+    log->n_matched = 0;
+    log->min = 0;
+    log->max = 0;
+    log->mean = 0;
+
+    if (log->count == 0){
+        return BLOCK_STORAGE_OK;
+    }
+
+    // Use the index to find the latest run that starts strictly before the window.
+    // Time stamps only grow in chronological order so nothing before it can match.
+    // A run starting at q_start itself is no good, keys have one second resolution and the run before may end in that second.
+    uint32_t start = eeprom_log_oldest(log);
+    for (uint8_t i = 0; i < EEPROM_LOG_INDEX_LEN; i++){
+        struct eeprom_log_index_entry *entry = &log->index[i];
+        if (!entry->valid || (entry->first_ts >= log->q_start)){
+            continue;
+        }
+        uint32_t position = eeprom_log_position(log, entry->first_slot);
+        if ((position < log->count) && (position > eeprom_log_position(log, start))){
+            start = entry->first_slot;
+        }
+    }
+
+    #if EEPROM_LOG_DEBUG
+    DLOG_DEBUG("[EEPROM_LOG]: Query [%u, %u] starts scanning at slot %u.\r\n", log->q_start, log->q_end, start);
+    #endif
+
+    // Scan forward in time order. The log might wrap, in which case it is read in two parts.
+    uint32_t remaining = log->count - eeprom_log_position(log, start);
+    uint32_t first_part = log->n_slots - start;
+    if (first_part > remaining){
+        first_part = remaining;
+    }
+    struct eeprom_log_scan scan = {.log = log, .stop = false, .sum = 0, .on_record = eeprom_log_query_record};
+    int res = eeprom_log_scan_slots(&scan, start, first_part);
+    if ((res == BLOCK_STORAGE_OK) && !scan.stop){
+        res = eeprom_log_scan_slots(&scan, 0, remaining - first_part);
+    }
+
+    if (log->n_matched > 0){
+        log->mean = (uint32_t) (scan.sum / log->n_matched);
+    }
+    return res;
+}
@@ -0,0 +1,231 @@
+#include "../include/i2c_async.h"
+
+static struct i2c_async_engine i2c_async;
+
+static int64_t i2c_async_timeout(alarm_id_t id, void *user_data);
+
+// Starts the transaction at the head of the queue. Interrupts must be disabled or we must be in the handler.
+static void i2c_async_start_next(){
+    if (i2c_async.count == 0){
+        // Queue ran dry, let the blocking users have the bus
+        i2c_async.active = NULL;
+        i2c_async.owns_bus = false;
+        i2c_bus_release(i2c_async.bus);
+        return;
+    }
+
+    struct i2c_async_txn *txn = i2c_async.queue[i2c_async.head];
+    i2c_hw_t *hw = i2c_get_hw(i2c_async.bus->port);
+    i2c_async.active = txn;
+    i2c_async.aborted = false;
+
+    // Build the command stream, RP2040 datasheet 4.3.10.
+    uint16_t n = 0;
+    for (uint8_t i = 0; i < txn->tx_len; i++){
+        i2c_async.cmd[n++] = txn->tx[i];
+    }
+    for (uint8_t i = 0; i < txn->rx_len; i++){
+        uint32_t word = I2C_IC_DATA_CMD_CMD_BITS;
+        if ((i == 0) && (txn->tx_len > 0)){
+            word |= I2C_IC_DATA_CMD_RESTART_BITS; // Turn the bus around without releasing it
+        }
+        i2c_async.cmd[n++] = word;
+    }
+    i2c_async.cmd[n - 1] |= I2C_IC_DATA_CMD_STOP_BITS;
+
+    // Run at the device's own rate. i2c_set_baudrate only touches the timing registers.
+    i2c_bus_set_speed(txn->dev);
+
+    // The target address can only be changed while the controller is disabled
+    hw->enable = 0;
+    hw->tar = txn->dev->addr;
+    hw->enable = 1;
+
+    // Clear stale flags and only listen while we own the bus, the blocking SDK functions poll the same flags
+    (void) hw->clr_stop_det;
+    (void) hw->clr_tx_abrt;
+    hw->intr_mask = I2C_IC_INTR_MASK_M_STOP_DET_BITS | I2C_IC_INTR_MASK_M_TX_ABRT_BITS;
+
+    if (txn->rx_len > 0){
+        dma_channel_config rx_config = dma_channel_get_default_config(i2c_async.rx_chan);
+        channel_config_set_transfer_data_size(&rx_config, DMA_SIZE_8);
+        channel_config_set_read_increment(&rx_config, false);
+        channel_config_set_write_increment(&rx_config, true);
+        channel_config_set_dreq(&rx_config, i2c_get_dreq(i2c_async.bus->port, false));
+        dma_channel_configure(i2c_async.rx_chan, &rx_config, txn->rx, &hw->data_cmd, txn->rx_len, true);
+    }
+
+    dma_channel_config tx_config = dma_channel_get_default_config(i2c_async.tx_chan);
+    channel_config_set_transfer_data_size(&tx_config, DMA_SIZE_32);
+    channel_config_set_read_increment(&tx_config, true);
+    channel_config_set_write_increment(&tx_config, false);
+    channel_config_set_dreq(&tx_config, i2c_get_dreq(i2c_async.bus->port, true));
+    i2c_async.start_us = time_us_32();
+    dma_channel_configure(i2c_async.tx_chan, &tx_config, &hw->data_cmd, i2c_async.cmd, n, true);
+
+    i2c_async.seq++;
+    i2c_async.alarm = add_alarm_in_us(I2C_ASYNC_TIMEOUT_US, i2c_async_timeout, (void *) (uintptr_t) i2c_async.seq, true);
+    if (i2c_async.alarm < 0){
+        #if I2C_ASYNC_ERROR
+        DLOG_ERROR("[I2C_ASYNC]: No alarm left, the %s transaction runs without a deadline.\r\n", (uintptr_t) txn->dev->name);
+        #endif
+        i2c_async.alarm = 0;
+    }
+}
+
+// Takes txn off the queue, starts the next one and fires its callback. Interrupts must be disabled or we must be in a handler.
+static void i2c_async_finish(struct i2c_async_txn *txn, bool aborted){
+    if (i2c_async.alarm > 0){
+        cancel_alarm(i2c_async.alarm);
+    }
+    i2c_async.alarm = 0;
+    i2c_async_record(txn, aborted, i2c_async.start_us, time_us_32());
+
+    i2c_async.head = (i2c_async.head + 1) % I2C_ASYNC_QUEUE_LEN;
+    i2c_async.count--;
+    txn->status = aborted ? I2C_ASYNC_ABORTED : I2C_ASYNC_DONE;
+
+    #if I2C_ASYNC_DEBUG
+    DLOG_DEBUG("[I2C_ASYNC]: %s transaction %s.\r\n", (uintptr_t) txn->dev->name, (uintptr_t) (aborted ? "aborted" : "done"));
+    #endif
+
+    // Keep the bus busy before handing control to the caller
+    i2c_async_start_next();
+    if (txn->callback != NULL){
+        txn->callback(txn);
+    }
+}
+
+// Runs in the alarm interrupt when a transaction is still on the wire after I2C_ASYNC_TIMEOUT_US
+static int64_t i2c_async_timeout(alarm_id_t id, void *user_data){
+    struct i2c_async_txn *txn = i2c_async.active;
+    if ((txn == NULL) || ((uint32_t) (uintptr_t) user_data != i2c_async.seq)){
+        // That transaction finished while the alarm went off
+        return 0;
+    }
+    i2c_async.alarm = 0;
+
+    i2c_get_hw(i2c_async.bus->port)->intr_mask = 0;
+    dma_channel_abort(i2c_async.tx_chan);
+    dma_channel_abort(i2c_async.rx_chan);
+    #if I2C_ASYNC_ERROR
+    DLOG_ERROR("[I2C_ASYNC]: %s transaction timed out, recovering the bus.\r\n", (uintptr_t) txn->dev->name);
+    #endif
+    // The engine owns the bus, so it may clock the slave free and reset the controller. That takes about 100 us.
+    i2c_bus_recover(i2c_async.bus);
+
+    txn->abort_source = 0;
+    i2c_async_finish(txn, true);
+    return 0;
+}
+
+void i2c_async_record(struct i2c_async_txn *txn, bool aborted, uint32_t start_us, uint32_t end_us){
+    struct i2c_bus *bus = txn->dev->bus;
+    int result = aborted ? PICO_ERROR_GENERIC : 0;
+    i2c_stats_record(&bus->stats, txn->dev->addr, txn->tx_len + txn->rx_len, result, start_us, end_us);
+    // Traced as the write and read the blocking functions would have done, the write ends at the repeated start
+    if (txn->tx_len > 0){
+        i2c_trace_record(&bus->trace, txn->dev->addr, I2C_TRACE_ASYNC | ((txn->rx_len > 0) ? I2C_TRACE_NOSTOP : 0), txn->tx, txn->tx_len, aborted ? result : txn->tx_len, start_us, (txn->rx_len > 0) ? start_us : end_us);
+    }
+    if (txn->rx_len > 0){
+        i2c_trace_record(&bus->trace, txn->dev->addr, I2C_TRACE_ASYNC | I2C_TRACE_READ, txn->rx, txn->rx_len, aborted ? result : txn->rx_len, start_us, end_us);
+    }
+}
+
+static void i2c_async_irq_handler(){
+    i2c_hw_t *hw = i2c_get_hw(i2c_async.bus->port);
+    uint32_t stat = hw->intr_stat;
+    struct i2c_async_txn *txn = i2c_async.active;
+
+    if (stat & I2C_IC_INTR_STAT_R_TX_ABRT_BITS){
+        // The controller flushed its FIFO, stop feeding it. The STOP that follows finishes the transaction.
+        if (txn != NULL){
+            txn->abort_source = hw->tx_abrt_source;
+        }
+        (void) hw->clr_tx_abrt;
+        dma_channel_abort(i2c_async.tx_chan);
+        dma_channel_abort(i2c_async.rx_chan);
+        i2c_async.aborted = true;
+    }
+
+    if (!(stat & I2C_IC_INTR_STAT_R_STOP_DET_BITS)){
+        return;
+    }
+    (void) hw->clr_stop_det;
+    hw->intr_mask = 0;
+
+    if (txn == NULL){
+        return;
+    }
+
+    if (!i2c_async.aborted && (txn->rx_len > 0)){
+        // The last byte is already in the FIFO, the DMA needs at most a few cycles to move it
+        dma_channel_wait_for_finish_blocking(i2c_async.rx_chan);
+    }
+
+    i2c_async_finish(txn, i2c_async.aborted);
+}
+
+void i2c_async_init(struct i2c_bus *bus){
+    i2c_async.bus = bus;
+    i2c_async.head = 0;
+    i2c_async.count = 0;
+    i2c_async.active = NULL;
+    i2c_async.aborted = false;
+    i2c_async.owns_bus = false;
+    i2c_async.alarm = 0;
+    i2c_async.seq = 0;
+    i2c_async.tx_chan = dma_claim_unused_channel(true);
+    i2c_async.rx_chan = dma_claim_unused_channel(true);
+
+    i2c_hw_t *hw = i2c_get_hw(bus->port);
+    hw->intr_mask = 0;
+    // The SDK enables the DREQs in i2c_init, this only makes sure they are on
+    hw->dma_cr = I2C_IC_DMA_CR_TDMAE_BITS | I2C_IC_DMA_CR_RDMAE_BITS;
+
+    uint irq = I2C0_IRQ + i2c_hw_index(bus->port);
+    irq_set_exclusive_handler(irq, i2c_async_irq_handler);
+    irq_set_enabled(irq, true);
+
+    #if I2C_ASYNC_INFO
+    printf("[I2C_ASYNC]: Engine ready using DMA channels %d and %d.\r\n", i2c_async.tx_chan, i2c_async.rx_chan);
+    #endif
+}
+
+int i2c_async_submit(struct i2c_async_txn *txn){
+    if ((txn->tx_len > I2C_ASYNC_MAX_TX) || (txn->rx_len > I2C_ASYNC_MAX_RX) || ((txn->tx_len + txn->rx_len) == 0)){
+        return I2C_ASYNC_INVALID;
+    }
+
+    uint32_t ints = save_and_disable_interrupts();
+    if (i2c_async.count == I2C_ASYNC_QUEUE_LEN){
+        restore_interrupts(ints);
+        return I2C_ASYNC_FULL;
+    }
+    txn->status = I2C_ASYNC_PENDING;
+    txn->abort_source = 0;
+    i2c_async.queue[(i2c_async.head + i2c_async.count) % I2C_ASYNC_QUEUE_LEN] = txn;
+    i2c_async.count++;
+    bool need_bus = !i2c_async.owns_bus;
+    i2c_async.owns_bus = true;
+    restore_interrupts(ints);
+
+    if (need_bus){
+        // First transaction of a batch. Wait our turn with interrupts enabled, the owner may need them to finish.
+        i2c_bus_acquire(i2c_async.bus);
+        ints = save_and_disable_interrupts();
+        i2c_async_start_next();
+        restore_interrupts(ints);
+    }
+    return I2C_ASYNC_OK;
+}
+
+bool i2c_async_idle(){
+    return i2c_async.count == 0;
+}
+
+void i2c_async_wait_idle(){
+    while (!i2c_async_idle()){
+        tight_loop_contents();
+    }
+}
@@ -0,0 +1,373 @@
+#include "../include/i2c_bus.h"
+#if PICO_ON_DEVICE
+#include "../include/i2c_async.h"
+#endif
+
+struct i2c_bus i2c_bus0 = {
+    .name = "i2c0",
+    .ops = &i2c_bus_hw_ops,
+    .port = I2C_PORT,
+    .baudrate = I2C_BAUDRATE,
+    .sda = GPIO_I2C0_SDA,
+    .scl = GPIO_I2C0_SCL,
+};
+
+// RP2040 I2C block controller
+
+static void i2c_bus_hw_init(struct i2c_bus *bus){
+    #if PICO_ON_DEVICE
+    i2c_init(bus->port, bus->current_baudrate);
+    // The block comes out of reset with most interrupts unmasked. The async engine unmasks what it needs per transaction.
+    i2c_get_hw(bus->port)->intr_mask = 0;
+    gpio_set_function(bus->sda, GPIO_FUNC_I2C);
+    gpio_set_function(bus->scl, GPIO_FUNC_I2C);
+    gpio_pull_up(bus->sda);
+    gpio_pull_up(bus->scl);
+    #endif
+}
+
+static void i2c_bus_hw_set_baudrate(struct i2c_bus *bus, uint32_t baudrate){
+    // Only touches the timing registers
+    #if PICO_ON_DEVICE
+    i2c_set_baudrate(bus->port, baudrate);
+    #endif
+}
+
+static int i2c_bus_hw_write(struct i2c_bus *bus, uint8_t addr, const uint8_t *src, size_t len, bool nostop, absolute_time_t until){
+    #if PICO_ON_DEVICE
+    return i2c_write_blocking_until(bus->port, addr, src, len, nostop, until);
+    #else
+    return i2c_replay_write(addr, src, len, nostop);
+    #endif
+}
+
+static int i2c_bus_hw_read(struct i2c_bus *bus, uint8_t addr, uint8_t *dst, size_t len, bool nostop, absolute_time_t until){
+    #if PICO_ON_DEVICE
+    return i2c_read_blocking_until(bus->port, addr, dst, len, nostop, until);
+    #else
+    return i2c_replay_read(addr, dst, len, nostop);
+    #endif
+}
+
+const struct i2c_bus_ops i2c_bus_hw_ops = {
+    .init = i2c_bus_hw_init,
+    .set_baudrate = i2c_bus_hw_set_baudrate,
+    .write = i2c_bus_hw_write,
+    .read = i2c_bus_hw_read,
+    #if PICO_ON_DEVICE
+    .submit = i2c_async_submit,
+    #else
+    .submit = NULL, // No DMA on the host
+    #endif
+};
+
+void i2c_bus_init(struct i2c_bus *bus){
+    bus->current_baudrate = bus->baudrate;
+    bus->recoveries = 0;
+    #if !PICO_ON_DEVICE
+    // No controller on the host, the captured trace stands in for the chips
+    i2c_replay_open(I2C_REPLAY_FILE);
+    #endif
+    bus->ops->init(bus);
+
+    bus->lock = spin_lock_instance(spin_lock_claim_unused(true));
+    bus->next_ticket = 0;
+    bus->now_serving = 0;
+    i2c_bus_reset_wait_stats(bus);
+    i2c_stats_reset(&bus->stats, time_us_32());
+    i2c_trace_stop(&bus->trace);
+}
+
+void i2c_bus_acquire(struct i2c_bus *bus){
+    uint32_t start = time_us_32();
+
+    // Take a ticket. The spinlock makes the increment atomic across both cores.
+    uint32_t saved_irq = spin_lock_blocking(bus->lock);
+    uint32_t ticket = bus->next_ticket;
+    bus->next_ticket = ticket + 1;
+    bool contended = (bus->now_serving != ticket);
+    spin_unlock(bus->lock, saved_irq);
+
+    // Sleep until it is our turn. i2c_bus_release sends an event.
+    while (bus->now_serving != ticket){
+        __wfe();
+    }
+
+    uint32_t waited = time_us_32() - start;
+    struct i2c_bus_wait_stats *stats = &bus->wait[get_core_num()];
+    stats->acquisitions++;
+    if (contended){
+        stats->contended++;
+    }
+    stats->total_wait_us += waited;
+    if (waited > stats->max_wait_us){
+        stats->max_wait_us = waited;
+    }
+}
+
+void i2c_bus_release(struct i2c_bus *bus){
+    // Only the owner writes now_serving, the barrier makes the bus traffic visible before the hand over
+    __dmb();
+    bus->now_serving = bus->now_serving + 1;
+    __sev();
+}
+
+void i2c_bus_reset_wait_stats(struct i2c_bus *bus){
+    memset(bus->wait, 0, sizeof(bus->wait));
+}
+
+// Bus speed
+
+void i2c_bus_set_speed(const struct i2c_device *dev){
+    struct i2c_bus *bus = dev->bus;
+    uint32_t baudrate = bus->baudrate;
+    if (dev->max_baudrate != 0){
+        baudrate = dev->max_baudrate;
+    }
+    if (baudrate == bus->current_baudrate){
+        return;
+    }
+    // The controller is idle between transactions
+    bus->ops->set_baudrate(bus, baudrate);
+    bus->current_baudrate = baudrate;
+    #if I2C_BUS_DEBUG
+    DLOG_DEBUG("[I2C_BUS]: Switched to %u Hz for %s.\r\n", baudrate, (uintptr_t) dev->name);
+    #endif
+}
+
+// Bus recovery
+
+void i2c_bus_recover(struct i2c_bus *bus){
+    /*
+    A slave that lost clocks in the middle of a read can hold SDA low forever and no START can be sent.
+    Clocking SCL up to 9 times lets it shift out the rest of its byte (I2C specification UM10204 3.1.16).
+    Both lines are driven open drain by hand: output low or input with the pull up.
+    */
+    bus->recoveries++;
+
+    #if PICO_ON_DEVICE
+    gpio_init(bus->sda);
+    gpio_init(bus->scl);
+    gpio_pull_up(bus->sda);
+    gpio_pull_up(bus->scl);
+    gpio_put(bus->sda, 0);
+    gpio_put(bus->scl, 0);
+    gpio_set_dir(bus->sda, GPIO_IN);
+    gpio_set_dir(bus->scl, GPIO_IN);
+    busy_wait_us_32(I2C_BUS_RECOVERY_HALF_PERIOD_US);
+
+    for (uint8_t i = 0; (i < I2C_BUS_RECOVERY_CLOCKS) && !gpio_get(bus->sda); i++){
+        gpio_set_dir(bus->scl, GPIO_OUT); // SCL low
+        busy_wait_us_32(I2C_BUS_RECOVERY_HALF_PERIOD_US);
+        gpio_set_dir(bus->scl, GPIO_IN); // SCL released
+        busy_wait_us_32(I2C_BUS_RECOVERY_HALF_PERIOD_US);
+    }
+
+    // Finish with a STOP, SDA rising while SCL is high
+    gpio_set_dir(bus->scl, GPIO_OUT);
+    busy_wait_us_32(I2C_BUS_RECOVERY_HALF_PERIOD_US);
+    gpio_set_dir(bus->sda, GPIO_OUT);
+    busy_wait_us_32(I2C_BUS_RECOVERY_HALF_PERIOD_US);
+    gpio_set_dir(bus->scl, GPIO_IN);
+    busy_wait_us_32(I2C_BUS_RECOVERY_HALF_PERIOD_US);
+    gpio_set_dir(bus->sda, GPIO_IN);
+    busy_wait_us_32(I2C_BUS_RECOVERY_HALF_PERIOD_US);
+
+    #if I2C_BUS_ERROR
+    if (!gpio_get(bus->sda)){
+        DLOG_ERROR("[I2C_BUS]: SDA is still held low after bus recovery.\r\n");
+    }
+    #endif
+
+    #endif
+
+    // Hand the pins back and reset the controller, it may be stuck mid transfer as well
+    bus->ops->init(bus);
+}
+
+// Decides if a failed attempt should be tried again. Recovers the bus after a timeout.
+static bool i2c_bus_retry(const struct i2c_device *dev, int answer, uint8_t *attempt, absolute_time_t until){
+    if (answer >= 0){
+        return false;
+    }
+    #if I2C_BUS_ERROR
+    DLOG_ERROR("[I2C_BUS]: %s transfer on addr 0x%02x FAILED with %s on attempt %u.\r\n", (uintptr_t) dev->name, dev->addr, (uintptr_t) ((answer == PICO_ERROR_TIMEOUT) ? "PICO_ERROR_TIMEOUT" : "PICO_ERROR_GENERIC"), *attempt + 1);
+    #endif
+    if (answer == PICO_ERROR_TIMEOUT){
+        // Something held the bus for the whole deadline
+        i2c_bus_recover(dev->bus);
+    }
+    if ((*attempt >= dev->retries) || time_reached(until)){
+        return false;
+    }
+    *attempt += 1;
+    return true;
+}
+
+// Single attempts. The caller has to own the bus.
+
+static int i2c_bus_write_owned(const struct i2c_device *dev, const uint8_t *src, size_t len, bool nostop, absolute_time_t until){
+    uint32_t start = time_us_32();
+    int answer = dev->bus->ops->write(dev->bus, dev->addr, src, len, nostop, until);
+    i2c_trace_record(&dev->bus->trace, dev->addr, nostop ? I2C_TRACE_NOSTOP : 0, src, len, answer, start, time_us_32());
+    #if I2C_BUS_DEBUG
+    DLOG_DEBUG("[I2C_BUS]: %s wrote %u bytes to addr 0x%02x.\r\n", (uintptr_t) dev->name, (unsigned) len, dev->addr);
+    #endif
+    return answer;
+}
+
+static int i2c_bus_read_owned(const struct i2c_device *dev, uint8_t *dst, size_t len, bool nostop, absolute_time_t until){
+    uint32_t start = time_us_32();
+    int answer = dev->bus->ops->read(dev->bus, dev->addr, dst, len, nostop, until);
+    i2c_trace_record(&dev->bus->trace, dev->addr, I2C_TRACE_READ | (nostop ? I2C_TRACE_NOSTOP : 0), dst, len, answer, start, time_us_32());
+    #if I2C_BUS_DEBUG
+    DLOG_DEBUG("[I2C_BUS]: %s read %u bytes from addr 0x%02x.\r\n", (uintptr_t) dev->name, (unsigned) len, dev->addr);
+    #endif
+    return answer;
+}
+
+// Attempts with retries. The caller has to own the bus.
+
+// Returns true if the deadline ran out while waiting for the bus. Nothing went over the wire, so there is nothing to recover.
+static bool i2c_bus_deadline_spent(const struct i2c_device *dev, absolute_time_t until){
+    if (!time_reached(until)){
+        return false;
+    }
+    #if I2C_BUS_ERROR
+    DLOG_ERROR("[I2C_BUS]: %s transfer on addr 0x%02x spent its deadline waiting for the bus.\r\n", (uintptr_t) dev->name, dev->addr);
+    #endif
+    return true;
+}
+
+static int i2c_bus_write_attempts(const struct i2c_device *dev, const uint8_t *src, size_t len, bool nostop, absolute_time_t until){
+    if (i2c_bus_deadline_spent(dev, until)){
+        return PICO_ERROR_TIMEOUT;
+    }
+    i2c_bus_set_speed(dev);
+    int answer;
+    uint8_t attempt = 0;
+    do {
+        uint32_t start = time_us_32();
+        answer = i2c_bus_write_owned(dev, src, len, nostop, until);
+        i2c_stats_record(&dev->bus->stats, dev->addr, len, answer, start, time_us_32());
+    } while (i2c_bus_retry(dev, answer, &attempt, until));
+    return answer;
+}
+
+static int i2c_bus_read_attempts(const struct i2c_device *dev, uint8_t *dst, size_t len, bool nostop, absolute_time_t until){
+    if (i2c_bus_deadline_spent(dev, until)){
+        return PICO_ERROR_TIMEOUT;
+    }
+    i2c_bus_set_speed(dev);
+    int answer;
+    uint8_t attempt = 0;
+    do {
+        uint32_t start = time_us_32();
+        answer = i2c_bus_read_owned(dev, dst, len, nostop, until);
+        i2c_stats_record(&dev->bus->stats, dev->addr, len, answer, start, time_us_32());
+    } while (i2c_bus_retry(dev, answer, &attempt, until));
+    return answer;
+}
+
+static int i2c_bus_write_read_attempts(const struct i2c_device *dev, const uint8_t *src, size_t src_len, uint8_t *dst, size_t dst_len, absolute_time_t until){
+    // Keep control of the bus so the read starts with a Restart. No other core may get in between.
+    // A retry repeats the whole transaction.
+    if (i2c_bus_deadline_spent(dev, until)){
+        return PICO_ERROR_TIMEOUT;
+    }
+    i2c_bus_set_speed(dev);
+    int answer;
+    uint8_t attempt = 0;
+    do {
+        uint32_t start = time_us_32();
+        answer = i2c_bus_write_owned(dev, src, src_len, true, until);
+        if (answer >= 0){
+            answer = i2c_bus_read_owned(dev, dst, dst_len, false, until);
+        }
+        i2c_stats_record(&dev->bus->stats, dev->addr, src_len + dst_len, answer, start, time_us_32());
+    } while (i2c_bus_retry(dev, answer, &attempt, until));
+    return answer;
+}
+
+// Transfers with an absolute deadline, the wait for the bus counts against it
+
+int i2c_bus_write_until(const struct i2c_device *dev, const uint8_t *src, size_t len, bool nostop, absolute_time_t until){
+    i2c_bus_acquire(dev->bus);
+    int answer = i2c_bus_write_attempts(dev, src, len, nostop, until);
+    i2c_bus_release(dev->bus);
+    return answer;
+}
+
+int i2c_bus_read_until(const struct i2c_device *dev, uint8_t *dst, size_t len, bool nostop, absolute_time_t until){
+    i2c_bus_acquire(dev->bus);
+    int answer = i2c_bus_read_attempts(dev, dst, len, nostop, until);
+    i2c_bus_release(dev->bus);
+    return answer;
+}
+
+int i2c_bus_write_read_until(const struct i2c_device *dev, const uint8_t *src, size_t src_len, uint8_t *dst, size_t dst_len, absolute_time_t until){
+    i2c_bus_acquire(dev->bus);
+    int answer = i2c_bus_write_read_attempts(dev, src, src_len, dst, dst_len, until);
+    i2c_bus_release(dev->bus);
+    return answer;
+}
+
+// Transfers with a relative deadline. It starts once the bus is owned, so time queued behind the other core
+// or the async engine is never mistaken for a stuck bus.
+
+int i2c_bus_write_timeout_us(const struct i2c_device *dev, const uint8_t *src, size_t len, bool nostop, uint32_t timeout_us){
+    i2c_bus_acquire(dev->bus);
+    int answer = i2c_bus_write_attempts(dev, src, len, nostop, make_timeout_time_us(timeout_us));
+    i2c_bus_release(dev->bus);
+    return answer;
+}
+
+int i2c_bus_read_timeout_us(const struct i2c_device *dev, uint8_t *dst, size_t len, bool nostop, uint32_t timeout_us){
+    i2c_bus_acquire(dev->bus);
+    int answer = i2c_bus_read_attempts(dev, dst, len, nostop, make_timeout_time_us(timeout_us));
+    i2c_bus_release(dev->bus);
+    return answer;
+}
+
+int i2c_bus_write_read_timeout_us(const struct i2c_device *dev, const uint8_t *src, size_t src_len, uint8_t *dst, size_t dst_len, uint32_t timeout_us){
+    i2c_bus_acquire(dev->bus);
+    int answer = i2c_bus_write_read_attempts(dev, src, src_len, dst, dst_len, make_timeout_time_us(timeout_us));
+    i2c_bus_release(dev->bus);
+    return answer;
+}
+
+// Transfers with the default deadline
+
+int i2c_bus_write(const struct i2c_device *dev, const uint8_t *src, size_t len, bool nostop){
+    return i2c_bus_write_timeout_us(dev, src, len, nostop, I2C_BUS_DEFAULT_TIMEOUT_US);
+}
+
+int i2c_bus_read(const struct i2c_device *dev, uint8_t *dst, size_t len, bool nostop){
+    return i2c_bus_read_timeout_us(dev, dst, len, nostop, I2C_BUS_DEFAULT_TIMEOUT_US);
+}
+
+int i2c_bus_write_read(const struct i2c_device *dev, const uint8_t *src, size_t src_len, uint8_t *dst, size_t dst_len){
+    return i2c_bus_write_read_timeout_us(dev, src, src_len, dst, dst_len, I2C_BUS_DEFAULT_TIMEOUT_US);
+}
+
+int i2c_bus_reg_read(const struct i2c_device *dev, uint8_t reg, uint8_t *dst, size_t len){
+    return i2c_bus_write_read(dev, &reg, 1, dst, len);
+}
+
+int i2c_bus_reg_write(const struct i2c_device *dev, uint8_t reg, const uint8_t *src, size_t len){
+    if (len > I2C_BUS_MAX_WRITE){
+        #if I2C_BUS_ERROR
+        DLOG_ERROR("[I2C_BUS]: %s register write of %u bytes is larger than I2C_BUS_MAX_WRITE.\r\n", (uintptr_t) dev->name, (unsigned) len);
+        #endif
+        return PICO_ERROR_GENERIC;
+    }
+    // The register address and the data has to go out in the same transfer
+    uint8_t write_buffer[I2C_BUS_MAX_WRITE + 1];
+    write_buffer[0] = reg;
+    memcpy(write_buffer + 1, src, len);
+    int answer = i2c_bus_write(dev, write_buffer, len + 1, false);
+    if (answer < 0){
+        return answer;
+    }
+    return answer - 1;
+}
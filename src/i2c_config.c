@@ -1,10 +1,15 @@
 #include "../include/i2c_config.h"
+#include "../include/i2c_bus.h"
+#include "../include/i2c_async.h"
+#include "../include/i2c_pio.h"
 
 void global_i2c_init(){
-    //Initialize the I2C
-    i2c_init(I2C_PORT,I2C_BAUDRATE);
-    gpio_set_function(GPIO_I2C0_SDA, GPIO_FUNC_I2C);
-    gpio_set_function(GPIO_I2C0_SCL, GPIO_FUNC_I2C);
-    gpio_pull_up(GPIO_I2C0_SDA);
-    gpio_pull_up(GPIO_I2C0_SCL);
+    //Initialize the I2C bus shared by all drivers
+    i2c_bus_init(&i2c_bus0);
+    //Let the async engine run transactions on it in the background
+    i2c_async_init(&i2c_bus0);
+    #if I2C_EEPROM_ON_PIO_BUS
+    //Second bus driven by PIO, it has its own engine
+    i2c_bus_init(&i2c_bus1);
+    #endif
 }
\ No newline at end of file
@@ -0,0 +1,433 @@
+#include "../include/i2c_pio.h"
+#include "i2c_pio.pio.h"
+
+static struct i2c_pio i2c_pio;
+
+static int64_t i2c_pio_timeout(alarm_id_t id, void *user_data);
+
+struct i2c_bus i2c_bus1 = {
+    .name = "pio_i2c",
+    .ops = &i2c_pio_ops,
+    .port = NULL,
+    .baudrate = I2C_PIO_BAUDRATE,
+    .sda = GPIO_PIO_I2C_SDA,
+    .scl = GPIO_PIO_I2C_SCL,
+};
+
+static float i2c_pio_clkdiv(uint32_t baudrate){
+    // The program spends 32 cycles on a bit
+    return (float) clock_get_hz(clk_sys) / (32 * baudrate);
+}
+
+// Stream building
+
+// Appends an instruction sequence to the stream at n. The first word tells the state machine how many follow.
+static uint16_t i2c_pio_put_instr(uint16_t n, const uint16_t *instr, uint8_t len){
+    i2c_pio.cmd[n++] = (len - 1) << I2C_PIO_ICOUNT_LSB;
+    for (uint8_t i = 0; i < len; i++){
+        i2c_pio.cmd[n++] = instr[i];
+    }
+    return n;
+}
+
+static uint16_t i2c_pio_put_start(uint16_t n){
+    // SDA falls while SCL is high, then SCL goes low for the first bit
+    const uint16_t start[] = {
+        i2c_pio_set_scl_sda_program_instructions[I2C_PIO_SC1_SD0],
+        i2c_pio_set_scl_sda_program_instructions[I2C_PIO_SC0_SD0],
+    };
+    return i2c_pio_put_instr(n, start, 2);
+}
+
+static uint16_t i2c_pio_put_repstart(uint16_t n){
+    // Release SDA while SCL is low, release SCL, then a normal START
+    const uint16_t repstart[] = {
+        i2c_pio_set_scl_sda_program_instructions[I2C_PIO_SC0_SD1],
+        i2c_pio_set_scl_sda_program_instructions[I2C_PIO_SC1_SD1],
+        i2c_pio_set_scl_sda_program_instructions[I2C_PIO_SC1_SD0],
+        i2c_pio_set_scl_sda_program_instructions[I2C_PIO_SC0_SD0],
+    };
+    return i2c_pio_put_instr(n, repstart, 4);
+}
+
+static uint16_t i2c_pio_put_end(uint16_t n, bool nostop){
+    if (nostop){
+        // Keep SCL low so nobody else can start, the next transfer begins with a repeated start
+        const uint16_t hold[] = {
+            i2c_pio_set_scl_sda_program_instructions[I2C_PIO_SC0_SD1],
+            pio_encode_push(false, false),
+        };
+        return i2c_pio_put_instr(n, hold, 2);
+    }
+    // SDA rises while SCL is high. The PUSH tells the RX side the STOP is out.
+    const uint16_t stop[] = {
+        i2c_pio_set_scl_sda_program_instructions[I2C_PIO_SC0_SD0],
+        i2c_pio_set_scl_sda_program_instructions[I2C_PIO_SC1_SD0],
+        i2c_pio_set_scl_sda_program_instructions[I2C_PIO_SC1_SD1],
+        pio_encode_push(false, false),
+    };
+    return i2c_pio_put_instr(n, stop, 4);
+}
+
+// Builds the stream of a write of tx_len bytes followed by a read of rx_len bytes after a repeated start.
+// Either can be 0. Returns the amount of words, rx_count is set to the bytes the RX FIFO will give back.
+static uint16_t i2c_pio_build(uint8_t addr, const uint8_t *tx, size_t tx_len, size_t rx_len, bool nostop, uint16_t *rx_count){
+    uint16_t n = 0;
+    uint16_t received = 0;
+    bool write_phase = (tx_len > 0) || (rx_len == 0);
+
+    if (write_phase){
+        n = i2c_pio.restart ? i2c_pio_put_repstart(n) : i2c_pio_put_start(n);
+        // We release SDA in the ACK slot, the slave has to pull it low
+        i2c_pio.cmd[n++] = ((addr << 1) << I2C_PIO_DATA_LSB) | (1u << I2C_PIO_NAK_LSB);
+        for (size_t i = 0; i < tx_len; i++){
+            i2c_pio.cmd[n++] = (tx[i] << I2C_PIO_DATA_LSB) | (1u << I2C_PIO_NAK_LSB);
+        }
+        received += 1 + tx_len;
+    }
+
+    if (rx_len > 0){
+        n = (write_phase || i2c_pio.restart) ? i2c_pio_put_repstart(n) : i2c_pio_put_start(n);
+        i2c_pio.cmd[n++] = (((addr << 1) | 1) << I2C_PIO_DATA_LSB) | (1u << I2C_PIO_NAK_LSB);
+        i2c_pio.rx_offset = received + 1;
+        for (size_t i = 0; i < rx_len; i++){
+            // Release SDA for the slave's bits. ACK every byte but the last, which gets a NAK.
+            uint16_t word = 0xFF << I2C_PIO_DATA_LSB;
+            if (i == rx_len - 1){
+                word |= (1u << I2C_PIO_FINAL_LSB) | (1u << I2C_PIO_NAK_LSB);
+            }
+            i2c_pio.cmd[n++] = word;
+        }
+        received += 1 + rx_len;
+    }
+
+    n = i2c_pio_put_end(n, nostop);
+    i2c_pio.restart = nostop;
+    *rx_count = received + 1; // The PUSH at the end
+    return n;
+}
+
+// Starts both DMA channels on the stream in cmd
+static void i2c_pio_start_stream(uint16_t words, uint16_t rx_count){
+    dma_channel_config rx_config = dma_channel_get_default_config(i2c_pio.rx_chan);
+    channel_config_set_transfer_data_size(&rx_config, DMA_SIZE_8);
+    channel_config_set_read_increment(&rx_config, false);
+    channel_config_set_write_increment(&rx_config, true);
+    channel_config_set_dreq(&rx_config, pio_get_dreq(i2c_pio.pio, i2c_pio.sm, false));
+    dma_channel_configure(i2c_pio.rx_chan, &rx_config, i2c_pio.rx, &i2c_pio.pio->rxf[i2c_pio.sm], rx_count, true);
+
+    // Halfword writes land in both halves of the FIFO word, the state machine shifts out the upper one
+    dma_channel_config tx_config = dma_channel_get_default_config(i2c_pio.tx_chan);
+    channel_config_set_transfer_data_size(&tx_config, DMA_SIZE_16);
+    channel_config_set_read_increment(&tx_config, true);
+    channel_config_set_write_increment(&tx_config, false);
+    channel_config_set_dreq(&tx_config, pio_get_dreq(i2c_pio.pio, i2c_pio.sm, true));
+    dma_channel_configure(i2c_pio.tx_chan, &tx_config, &i2c_pio.pio->txf[i2c_pio.sm], i2c_pio.cmd, words, true);
+}
+
+static void i2c_pio_put16(uint16_t word){
+    while (pio_sm_is_tx_fifo_full(i2c_pio.pio, i2c_pio.sm)){
+        tight_loop_contents();
+    }
+    *(io_rw_16 *) &i2c_pio.pio->txf[i2c_pio.sm] = word;
+}
+
+// After a NAK stopped the state machine: drops the stream and resumes at the entry point. Returns the words of the STOP in cmd.
+static uint16_t i2c_pio_nack_reset(){
+    dma_channel_abort(i2c_pio.tx_chan);
+    dma_channel_abort(i2c_pio.rx_chan);
+    pio_sm_drain_tx_fifo(i2c_pio.pio, i2c_pio.sm);
+    pio_sm_exec(i2c_pio.pio, i2c_pio.sm, pio_encode_jmp(i2c_pio.offset + i2c_pio_offset_entry_point));
+    pio_interrupt_clear(i2c_pio.pio, i2c_pio.sm);
+    while (!pio_sm_is_rx_fifo_empty(i2c_pio.pio, i2c_pio.sm)){
+        (void) pio_sm_get(i2c_pio.pio, i2c_pio.sm);
+    }
+
+    i2c_pio.restart = false;
+    return i2c_pio_put_end(0, false);
+}
+
+// Cleans up after a NAK in a blocking transfer and sends the STOP by hand
+static void i2c_pio_nack(){
+    uint16_t n = i2c_pio_nack_reset();
+    for (uint16_t i = 0; i < n; i++){
+        i2c_pio_put16(i2c_pio.cmd[i]);
+    }
+    // Wait for the PUSH behind the STOP
+    absolute_time_t until = make_timeout_time_us(I2C_PIO_STOP_TIMEOUT_US);
+    while (pio_sm_is_rx_fifo_empty(i2c_pio.pio, i2c_pio.sm) && !time_reached(until)){
+        tight_loop_contents();
+    }
+    if (!pio_sm_is_rx_fifo_empty(i2c_pio.pio, i2c_pio.sm)){
+        (void) pio_sm_get(i2c_pio.pio, i2c_pio.sm);
+    }
+}
+
+// Blocks until the stream is done, a NAK or until
+static int i2c_pio_wait(absolute_time_t until){
+    while (dma_channel_is_busy(i2c_pio.rx_chan)){
+        if (pio_interrupt_get(i2c_pio.pio, i2c_pio.sm)){
+            i2c_pio_nack();
+            return PICO_ERROR_GENERIC;
+        }
+        if (time_reached(until)){
+            // Most likely a slave stretching SCL forever. The bus layer recovers the bus, which sets the machine up again.
+            dma_channel_abort(i2c_pio.tx_chan);
+            dma_channel_abort(i2c_pio.rx_chan);
+            pio_sm_set_enabled(i2c_pio.pio, i2c_pio.sm, false);
+            i2c_pio.restart = false;
+            return PICO_ERROR_TIMEOUT;
+        }
+        tight_loop_contents();
+    }
+    return 0;
+}
+
+// Background transactions
+
+// Starts the transaction at the head of the queue. Interrupts must be disabled or we must be in a handler.
+static void i2c_pio_start_next(){
+    if (i2c_pio.count == 0){
+        // Queue ran dry, stop listening and let the blocking users have the bus
+        i2c_pio.active = NULL;
+        pio_set_irq0_source_enabled(i2c_pio.pio, (enum pio_interrupt_source) ((uint) pis_interrupt0 + i2c_pio.sm), false);
+        dma_channel_set_irq1_enabled(i2c_pio.rx_chan, false);
+        i2c_pio.owns_bus = false;
+        i2c_bus_release(&i2c_bus1);
+        return;
+    }
+
+    struct i2c_async_txn *txn = i2c_pio.queue[i2c_pio.head];
+    i2c_pio.active = txn;
+    i2c_bus_set_speed(txn->dev);
+
+    uint16_t rx_count;
+    uint16_t words = i2c_pio_build(txn->dev->addr, txn->tx, txn->tx_len, txn->rx_len, false, &rx_count);
+
+    pio_set_irq0_source_enabled(i2c_pio.pio, (enum pio_interrupt_source) ((uint) pis_interrupt0 + i2c_pio.sm), true);
+    dma_channel_acknowledge_irq1(i2c_pio.rx_chan);
+    dma_channel_set_irq1_enabled(i2c_pio.rx_chan, true);
+    i2c_pio.start_us = time_us_32();
+    i2c_pio_start_stream(words, rx_count);
+
+    i2c_pio.seq++;
+    i2c_pio.alarm = add_alarm_in_us(I2C_ASYNC_TIMEOUT_US, i2c_pio_timeout, (void *) (uintptr_t) i2c_pio.seq, true);
+    if (i2c_pio.alarm < 0){
+        #if I2C_PIO_ERROR
+        DLOG_ERROR("[I2C_PIO]: No alarm left, the %s transaction runs without a deadline.\r\n", (uintptr_t) txn->dev->name);
+        #endif
+        i2c_pio.alarm = 0;
+    }
+}
+
+static void i2c_pio_finish(bool aborted){
+    struct i2c_async_txn *txn = i2c_pio.active;
+    if (i2c_pio.alarm > 0){
+        cancel_alarm(i2c_pio.alarm);
+    }
+    i2c_pio.alarm = 0;
+    if (!aborted && (txn->rx_len > 0)){
+        memcpy(txn->rx, i2c_pio.rx + i2c_pio.rx_offset, txn->rx_len);
+    }
+    i2c_async_record(txn, aborted, i2c_pio.start_us, time_us_32());
+
+    i2c_pio.head = (i2c_pio.head + 1) % I2C_ASYNC_QUEUE_LEN;
+    i2c_pio.count--;
+    // There is no abort source register on the PIO bus, a NAK is the only way to abort
+    txn->abort_source = 0;
+    txn->status = aborted ? I2C_ASYNC_ABORTED : I2C_ASYNC_DONE;
+
+    // Keep the bus busy before handing control to the caller
+    i2c_pio_start_next();
+    if (txn->callback != NULL){
+        txn->callback(txn);
+    }
+}
+
+// Runs in the alarm interrupt when a background transaction is still on the wire after I2C_ASYNC_TIMEOUT_US
+static int64_t i2c_pio_timeout(alarm_id_t id, void *user_data){
+    if ((i2c_pio.active == NULL) || ((uint32_t) (uintptr_t) user_data != i2c_pio.seq)){
+        // That transaction finished while the alarm went off
+        return 0;
+    }
+    i2c_pio.alarm = 0;
+
+    // Neither the abort nor the recovery may look like a completion or a NAK
+    dma_channel_set_irq1_enabled(i2c_pio.rx_chan, false);
+    dma_channel_abort(i2c_pio.tx_chan);
+    dma_channel_abort(i2c_pio.rx_chan);
+    pio_sm_set_enabled(i2c_pio.pio, i2c_pio.sm, false);
+    #if I2C_PIO_ERROR
+    DLOG_ERROR("[I2C_PIO]: %s transaction timed out, recovering the bus.\r\n", (uintptr_t) i2c_pio.active->dev->name);
+    #endif
+    // The engine owns the bus. The recovery sets the machine up again with the NAK interrupt off.
+    i2c_bus_recover(&i2c_bus1);
+    dma_channel_acknowledge_irq1(i2c_pio.rx_chan);
+    i2c_pio_finish(true);
+    return 0;
+}
+
+static void i2c_pio_dma_irq_handler(){
+    // The interrupt is shared, only act on our channel
+    if (!dma_channel_get_irq1_status(i2c_pio.rx_chan)){
+        return;
+    }
+    dma_channel_acknowledge_irq1(i2c_pio.rx_chan);
+    if (i2c_pio.active != NULL){
+        // Either the transaction itself or the STOP behind its NAK is out
+        bool aborted = i2c_pio.stopping;
+        i2c_pio.stopping = false;
+        i2c_pio_finish(aborted);
+    }
+}
+
+static void i2c_pio_nack_irq_handler(){
+    if (!pio_interrupt_get(i2c_pio.pio, i2c_pio.sm)){
+        return;
+    }
+    // Aborting the RX channel must not look like a completion
+    dma_channel_set_irq1_enabled(i2c_pio.rx_chan, false);
+    uint16_t words = i2c_pio_nack_reset();
+    // The STOP goes out by DMA like any stream, its PUSH finishes the transaction in the DMA interrupt.
+    // Nothing waits for the bus in here.
+    i2c_pio.stopping = (i2c_pio.active != NULL);
+    dma_channel_acknowledge_irq1(i2c_pio.rx_chan);
+    dma_channel_set_irq1_enabled(i2c_pio.rx_chan, true);
+    i2c_pio_start_stream(words, 1);
+}
+
+int i2c_pio_submit(struct i2c_async_txn *txn){
+    if ((txn->tx_len > I2C_ASYNC_MAX_TX) || (txn->rx_len > I2C_ASYNC_MAX_RX) || ((txn->tx_len + txn->rx_len) == 0)){
+        return I2C_ASYNC_INVALID;
+    }
+
+    uint32_t ints = save_and_disable_interrupts();
+    if (i2c_pio.count == I2C_ASYNC_QUEUE_LEN){
+        restore_interrupts(ints);
+        return I2C_ASYNC_FULL;
+    }
+    txn->status = I2C_ASYNC_PENDING;
+    txn->abort_source = 0;
+    i2c_pio.queue[(i2c_pio.head + i2c_pio.count) % I2C_ASYNC_QUEUE_LEN] = txn;
+    i2c_pio.count++;
+    bool need_bus = !i2c_pio.owns_bus;
+    i2c_pio.owns_bus = true;
+    restore_interrupts(ints);
+
+    if (need_bus){
+        // First transaction of a batch. Wait our turn with interrupts enabled, the owner may need them to finish.
+        i2c_bus_acquire(&i2c_bus1);
+        ints = save_and_disable_interrupts();
+        i2c_pio_start_next();
+        restore_interrupts(ints);
+    }
+    return I2C_ASYNC_OK;
+}
+
+bool i2c_pio_idle(){
+    return i2c_pio.count == 0;
+}
+
+// Bus operations
+
+static void i2c_pio_init(struct i2c_bus *bus){
+    if (!i2c_pio.claimed){
+        i2c_pio.pio = I2C_PIO_INSTANCE;
+        i2c_pio.sm = pio_claim_unused_sm(i2c_pio.pio, true);
+        i2c_pio.offset = pio_add_program(i2c_pio.pio, &i2c_pio_program);
+        i2c_pio.tx_chan = dma_claim_unused_channel(true);
+        i2c_pio.rx_chan = dma_claim_unused_channel(true);
+        i2c_pio.head = 0;
+        i2c_pio.count = 0;
+        i2c_pio.active = NULL;
+        i2c_pio.owns_bus = false;
+        i2c_pio.alarm = 0;
+        i2c_pio.seq = 0;
+
+        uint pio_irq = PIO0_IRQ_0 + 2 * pio_get_index(i2c_pio.pio);
+        irq_set_exclusive_handler(pio_irq, i2c_pio_nack_irq_handler);
+        irq_set_enabled(pio_irq, true);
+        irq_add_shared_handler(DMA_IRQ_1, i2c_pio_dma_irq_handler, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+        irq_set_enabled(DMA_IRQ_1, true);
+        i2c_pio.claimed = true;
+
+        #if I2C_PIO_INFO
+        printf("[I2C_PIO]: Bus on GPIO %u/%u using PIO%u SM %u and DMA channels %d and %d.\r\n", bus->sda, bus->scl, pio_get_index(i2c_pio.pio), i2c_pio.sm, i2c_pio.tx_chan, i2c_pio.rx_chan);
+        #endif
+    }
+    i2c_pio.restart = false;
+    i2c_pio.stopping = false;
+
+    pio_sm_config config = i2c_pio_program_get_default_config(i2c_pio.offset);
+    sm_config_set_out_pins(&config, bus->sda, 1);
+    sm_config_set_set_pins(&config, bus->sda, 1);
+    sm_config_set_in_pins(&config, bus->sda);
+    sm_config_set_sideset_pins(&config, bus->scl);
+    sm_config_set_jmp_pin(&config, bus->sda);
+    sm_config_set_out_shift(&config, false, true, 16);
+    sm_config_set_in_shift(&config, false, true, 8);
+    sm_config_set_clkdiv(&config, i2c_pio_clkdiv(bus->current_baudrate));
+
+    // Hand the pins over without glitching the bus. Both are pulled low when the machine enables the output
+    // and pulled up by the pull ups otherwise, the inverted output enable makes pindirs 1 mean released.
+    gpio_pull_up(bus->sda);
+    gpio_pull_up(bus->scl);
+    uint32_t both_pins = (1u << bus->sda) | (1u << bus->scl);
+    pio_sm_set_pins_with_mask(i2c_pio.pio, i2c_pio.sm, both_pins, both_pins);
+    pio_sm_set_pindirs_with_mask(i2c_pio.pio, i2c_pio.sm, both_pins, both_pins);
+    pio_gpio_init(i2c_pio.pio, bus->sda);
+    gpio_set_oeover(bus->sda, GPIO_OVERRIDE_INVERT);
+    pio_gpio_init(i2c_pio.pio, bus->scl);
+    gpio_set_oeover(bus->scl, GPIO_OVERRIDE_INVERT);
+    pio_sm_set_pins_with_mask(i2c_pio.pio, i2c_pio.sm, 0, both_pins);
+
+    // The NAK flag only reaches the system interrupt while a background transaction runs
+    pio_set_irq0_source_enabled(i2c_pio.pio, (enum pio_interrupt_source) ((uint) pis_interrupt0 + i2c_pio.sm), false);
+    pio_interrupt_clear(i2c_pio.pio, i2c_pio.sm);
+    pio_sm_init(i2c_pio.pio, i2c_pio.sm, i2c_pio.offset + i2c_pio_offset_entry_point, &config);
+    pio_sm_set_enabled(i2c_pio.pio, i2c_pio.sm, true);
+}
+
+static void i2c_pio_set_baudrate(struct i2c_bus *bus, uint32_t baudrate){
+    pio_sm_set_clkdiv(i2c_pio.pio, i2c_pio.sm, i2c_pio_clkdiv(baudrate));
+}
+
+static int i2c_pio_write(struct i2c_bus *bus, uint8_t addr, const uint8_t *src, size_t len, bool nostop, absolute_time_t until){
+    if (len > I2C_PIO_MAX_LEN){
+        #if I2C_PIO_ERROR
+        DLOG_ERROR("[I2C_PIO]: Write of %u bytes is larger than I2C_PIO_MAX_LEN.\r\n", (unsigned) len);
+        #endif
+        return PICO_ERROR_GENERIC;
+    }
+    uint16_t rx_count;
+    uint16_t words = i2c_pio_build(addr, src, len, 0, nostop, &rx_count);
+    i2c_pio_start_stream(words, rx_count);
+    int answer = i2c_pio_wait(until);
+    return (answer < 0) ? answer : (int) len;
+}
+
+static int i2c_pio_read(struct i2c_bus *bus, uint8_t addr, uint8_t *dst, size_t len, bool nostop, absolute_time_t until){
+    if ((len == 0) || (len > I2C_PIO_MAX_LEN)){
+        #if I2C_PIO_ERROR
+        DLOG_ERROR("[I2C_PIO]: Read of %u bytes is not between 1 and I2C_PIO_MAX_LEN.\r\n", (unsigned) len);
+        #endif
+        return PICO_ERROR_GENERIC;
+    }
+    uint16_t rx_count;
+    uint16_t words = i2c_pio_build(addr, NULL, 0, len, nostop, &rx_count);
+    i2c_pio_start_stream(words, rx_count);
+    int answer = i2c_pio_wait(until);
+    if (answer < 0){
+        return answer;
+    }
+    memcpy(dst, i2c_pio.rx + i2c_pio.rx_offset, len);
+    return (int) len;
+}
+
+const struct i2c_bus_ops i2c_pio_ops = {
+    .init = i2c_pio_init,
+    .set_baudrate = i2c_pio_set_baudrate,
+    .write = i2c_pio_write,
+    .read = i2c_pio_read,
+    .submit = i2c_pio_submit,
+};
@@ -0,0 +1,134 @@
+#include "../include/i2c_replay.h"
+
+#if !PICO_ON_DEVICE
+
+static struct i2c_replay i2c_replay;
+
+// Reads the next record of the trace. Returns false when there are none left.
+static bool i2c_replay_next(struct i2c_trace_record *record, uint8_t *data){
+    char line[I2C_REPLAY_MAX_LINE];
+    while (fgets(line, sizeof(line), i2c_replay.file) != NULL){
+        unsigned start, duration, addr, flags, len;
+        int result, consumed;
+        if (sscanf(line, I2C_TRACE_TAG " %u %u %x %x %d %u %n", &start, &duration, &addr, &flags, &result, &len, &consumed) != 6){
+            // Anything else in the serial log
+            continue;
+        }
+        record->start_us = start;
+        record->duration_us = duration;
+        record->addr = (uint8_t) addr;
+        record->flags = (uint8_t) flags;
+        record->result = (int16_t) result;
+        record->len = (uint16_t) len;
+
+        // The data follows as hex, two characters per byte
+        const char *hex = line + consumed;
+        uint16_t stored = i2c_trace_stored_len(record);
+        for (uint16_t i = 0; i < stored; i++){
+            unsigned byte;
+            if (sscanf(hex + 2 * i, "%2x", &byte) != 1){
+                return false;
+            }
+            data[i] = (uint8_t) byte;
+        }
+        return true;
+    }
+    return false;
+}
+
+// Fetches the record for a transfer and checks it is the one the drivers asked for
+static bool i2c_replay_match(struct i2c_trace_record *record, uint8_t *data, uint8_t addr, bool read, bool nostop, size_t len){
+    if (i2c_replay.file == NULL || i2c_replay.ended){
+        return false;
+    }
+    if (!i2c_replay_next(record, data)){
+        i2c_replay.ended = true;
+        #if I2C_REPLAY_INFO
+        printf("[I2C_REPLAY]: End of trace after %u transfers.\r\n", i2c_replay.transfers);
+        #endif
+        return false;
+    }
+    bool recorded_read = (record->flags & I2C_TRACE_READ) != 0;
+    bool recorded_nostop = (record->flags & I2C_TRACE_NOSTOP) != 0;
+    if ((record->addr != addr) || (recorded_read != read) || (recorded_nostop != nostop) || (record->len != len)){
+        i2c_replay.divergences++;
+        #if I2C_REPLAY_ERROR
+        printf("[I2C_REPLAY]: Transfer %u diverged, asked %s of %u bytes on 0x%02x, trace has %s of %u bytes on 0x%02x.\r\n",
+            i2c_replay.transfers, read ? "read" : "write", (unsigned) len, addr, recorded_read ? "read" : "write", record->len, record->addr);
+        #endif
+        return false;
+    }
+    i2c_replay.transfers++;
+    return true;
+}
+
+// Waits until the record is due relative to the first transfer, then for as long as it took on the board
+static void i2c_replay_pace(const struct i2c_trace_record *record){
+    if (!i2c_replay.started){
+        i2c_replay.trace_start_us = record->start_us;
+        i2c_replay.host_start_us = time_us_32();
+        i2c_replay.started = true;
+    }
+    // Both clocks are time_us_32, the differences survive a wrap
+    uint32_t due = i2c_replay.host_start_us + (record->start_us - i2c_replay.trace_start_us);
+    int32_t ahead = (int32_t) (due - time_us_32());
+    if (ahead > 0){
+        busy_wait_us_32((uint32_t) ahead);
+    }
+    busy_wait_us_32(record->duration_us);
+}
+
+bool i2c_replay_open(const char *path){
+    i2c_replay.file = fopen(path, "r");
+    i2c_replay.transfers = 0;
+    i2c_replay.divergences = 0;
+    i2c_replay.ended = false;
+    i2c_replay.started = false;
+    #if I2C_REPLAY_INFO
+    printf("[I2C_REPLAY]: %s trace %s.\r\n", (i2c_replay.file != NULL) ? "Replaying" : "Could not open", path);
+    #endif
+    return i2c_replay.file != NULL;
+}
+
+void i2c_replay_close(){
+    if (i2c_replay.file != NULL){
+        fclose(i2c_replay.file);
+        i2c_replay.file = NULL;
+    }
+    #if I2C_REPLAY_INFO
+    printf("[I2C_REPLAY]: %u transfers replayed, %u diverged.\r\n", i2c_replay.transfers, i2c_replay.divergences);
+    #endif
+}
+
+int i2c_replay_write(uint8_t addr, const uint8_t *src, size_t len, bool nostop){
+    struct i2c_trace_record record;
+    uint8_t data[I2C_TRACE_MAX_DATA];
+    if (!i2c_replay_match(&record, data, addr, false, nostop, len)){
+        return PICO_ERROR_GENERIC;
+    }
+    if (memcmp(src, data, i2c_trace_stored_len(&record)) != 0){
+        // Same shape, different bytes. The result is still the recorded one so the drivers keep going.
+        i2c_replay.divergences++;
+        #if I2C_REPLAY_ERROR
+        printf("[I2C_REPLAY]: Transfer %u wrote other bytes than the trace to 0x%02x.\r\n", i2c_replay.transfers - 1, addr);
+        #endif
+    }
+    i2c_replay_pace(&record);
+    return record.result;
+}
+
+int i2c_replay_read(uint8_t addr, uint8_t *dst, size_t len, bool nostop){
+    struct i2c_trace_record record;
+    uint8_t data[I2C_TRACE_MAX_DATA];
+    if (!i2c_replay_match(&record, data, addr, true, nostop, len)){
+        return PICO_ERROR_GENERIC;
+    }
+    // Bytes past a truncated record were never captured
+    uint16_t stored = i2c_trace_stored_len(&record);
+    memcpy(dst, data, stored);
+    memset(dst + stored, 0, len - stored);
+    i2c_replay_pace(&record);
+    return record.result;
+}
+
+#endif
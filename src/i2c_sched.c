@@ -0,0 +1,66 @@
+#include "../include/i2c_sched.h"
+
+// Returns true if bus is in the list of buses that have to wait this round
+static bool i2c_sched_is_blocked(struct i2c_bus **blocked, uint8_t n_blocked, struct i2c_bus *bus){
+    for (uint8_t i = 0; i < n_blocked; i++){
+        if (blocked[i] == bus){
+            return true;
+        }
+    }
+    return false;
+}
+
+int i2c_sched_run(struct i2c_async_txn *txns, uint8_t n, uint32_t timeout_us){
+    if (n > I2C_SCHED_MAX_TXNS){
+        return PICO_ERROR_GENERIC;
+    }
+    absolute_time_t until = make_timeout_time_us(timeout_us);
+    uint32_t submitted = 0; // Bit i is set once txns[i] is queued
+    uint32_t all = (n == 32) ? 0xFFFFFFFF : ((1u << n) - 1);
+
+    while (true){
+        // Feed every engine as far as its queue allows. A bus that is full keeps the rest of its transactions back.
+        struct i2c_bus *blocked[I2C_SCHED_MAX_BUSES];
+        uint8_t n_blocked = 0;
+        for (uint8_t i = 0; (i < n) && (submitted != all); i++){
+            struct i2c_bus *bus = txns[i].dev->bus;
+            if ((submitted & (1u << i)) || i2c_sched_is_blocked(blocked, n_blocked, bus)){
+                continue;
+            }
+            int answer = bus->ops->submit(&txns[i]);
+            if (answer == I2C_ASYNC_OK){
+                submitted |= (1u << i);
+            }
+            else if (answer == I2C_ASYNC_FULL){
+                if (n_blocked == I2C_SCHED_MAX_BUSES){
+                    return PICO_ERROR_GENERIC;
+                }
+                blocked[n_blocked++] = bus;
+            }
+            else {
+                // Never going to fit, report it as aborted
+                txns[i].status = I2C_ASYNC_ABORTED;
+                submitted |= (1u << i);
+            }
+        }
+
+        // Done once everything is queued and nothing is pending
+        int done = 0;
+        bool finished = (submitted == all);
+        for (uint8_t i = 0; (i < n) && finished; i++){
+            if (txns[i].status == I2C_ASYNC_PENDING){
+                finished = false;
+            }
+            else if (txns[i].status == I2C_ASYNC_DONE){
+                done++;
+            }
+        }
+        if (finished){
+            return done;
+        }
+        if (time_reached(until)){
+            return PICO_ERROR_TIMEOUT;
+        }
+        tight_loop_contents();
+    }
+}
@@ -0,0 +1,104 @@
+#include "../include/i2c_stats.h"
+
+void i2c_stats_reset(struct i2c_stats *stats, uint32_t now_us){
+    memset(stats, 0, sizeof(struct i2c_stats));
+    for (uint8_t i = 0; i < I2C_STATS_MAX_ADDR; i++){
+        stats->entries[i].addr = I2C_STATS_NO_ADDR;
+    }
+    stats->slot_start_us = now_us;
+}
+
+// Finds the entry of addr or claims a free one. Returns NULL if the table is full.
+static struct i2c_stats_entry* i2c_stats_entry(struct i2c_stats *stats, uint8_t addr){
+    for (uint8_t i = 0; i < I2C_STATS_MAX_ADDR; i++){
+        struct i2c_stats_entry *entry = &stats->entries[i];
+        if (entry->addr == addr){
+            return entry;
+        }
+        if (entry->addr == I2C_STATS_NO_ADDR){
+            entry->addr = addr;
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+// Moves the window forward to now_us, clearing the slots that fell out of it
+static void i2c_stats_advance(struct i2c_stats *stats, uint32_t now_us){
+    uint32_t elapsed = now_us - stats->slot_start_us;
+    if (elapsed >= I2C_STATS_SLOT_US * I2C_STATS_WINDOW_SLOTS){
+        // Quiet for longer than the window
+        memset(stats->busy_us, 0, sizeof(stats->busy_us));
+        stats->slot_start_us = now_us;
+        return;
+    }
+    while (elapsed >= I2C_STATS_SLOT_US){
+        stats->slot = (stats->slot + 1) % I2C_STATS_WINDOW_SLOTS;
+        stats->busy_us[stats->slot] = 0;
+        stats->slot_start_us += I2C_STATS_SLOT_US;
+        elapsed -= I2C_STATS_SLOT_US;
+    }
+}
+
+uint8_t i2c_stats_bucket(uint32_t latency_us){
+    uint8_t bucket = 0;
+    while ((latency_us > 1) && (bucket < (I2C_STATS_N_BUCKETS - 1))){
+        latency_us >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+void i2c_stats_record(struct i2c_stats *stats, uint8_t addr, uint32_t bytes, int result, uint32_t start_us, uint32_t end_us){
+    uint32_t latency = end_us - start_us;
+
+    i2c_stats_advance(stats, end_us);
+    stats->busy_us[stats->slot] += latency;
+
+    struct i2c_stats_entry *entry = i2c_stats_entry(stats, addr);
+    if (entry == NULL){
+        stats->dropped++;
+        return;
+    }
+    entry->transactions++;
+    if (result >= 0){
+        entry->bytes += bytes;
+    }
+    else if (result == PICO_ERROR_TIMEOUT){
+        entry->timeouts++;
+    }
+    else {
+        entry->nacks++;
+    }
+    entry->total_us += latency;
+    if (latency > entry->max_us){
+        entry->max_us = latency;
+    }
+    entry->histogram[i2c_stats_bucket(latency)]++;
+}
+
+uint32_t i2c_stats_occupancy_permille(struct i2c_stats *stats, uint32_t now_us){
+    i2c_stats_advance(stats, now_us);
+    uint64_t busy = 0;
+    for (uint8_t i = 0; i < I2C_STATS_WINDOW_SLOTS; i++){
+        busy += stats->busy_us[i];
+    }
+    // The current slot is only partly over
+    uint64_t window = (uint64_t) I2C_STATS_SLOT_US * (I2C_STATS_WINDOW_SLOTS - 1) + (now_us - stats->slot_start_us);
+    if (window == 0){
+        return 0;
+    }
+    uint64_t permille = (busy * 1000) / window;
+    return (permille > 1000) ? 1000 : (uint32_t) permille;
+}
+
+uint32_t i2c_stats_wire_time_us(uint32_t baudrate, uint32_t tx_len, uint32_t rx_len){
+    uint32_t clocks = 1; // STOP
+    if (tx_len > 0){
+        clocks += 1 + 9 + 9 * tx_len; // START, address and data
+    }
+    if (rx_len > 0){
+        clocks += 1 + 9 + 9 * rx_len; // (RE)START, address and data
+    }
+    return (uint32_t) (((uint64_t) clocks * 1000000 + baudrate - 1) / baudrate);
+}
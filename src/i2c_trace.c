@@ -0,0 +1,99 @@
+#include "../include/i2c_trace.h"
+
+// Copies len bytes into the ring at the free running offset pos, wrapping around the end
+static void i2c_trace_copy_in(struct i2c_trace *trace, uint32_t pos, const void *src, uint32_t len){
+    uint32_t offset = pos % I2C_TRACE_BUFFER_SIZE;
+    uint32_t first = I2C_TRACE_BUFFER_SIZE - offset;
+    if (first > len){
+        first = len;
+    }
+    memcpy(trace->buffer + offset, src, first);
+    memcpy(trace->buffer, (const uint8_t *) src + first, len - first);
+}
+
+// Copies len bytes out of the ring at the free running offset pos, wrapping around the end
+static void i2c_trace_copy_out(struct i2c_trace *trace, uint32_t pos, void *dst, uint32_t len){
+    uint32_t offset = pos % I2C_TRACE_BUFFER_SIZE;
+    uint32_t first = I2C_TRACE_BUFFER_SIZE - offset;
+    if (first > len){
+        first = len;
+    }
+    memcpy(dst, trace->buffer + offset, first);
+    memcpy((uint8_t *) dst + first, trace->buffer, len - first);
+}
+
+uint16_t i2c_trace_stored_len(const struct i2c_trace_record *record){
+    return (record->len > I2C_TRACE_MAX_DATA) ? I2C_TRACE_MAX_DATA : record->len;
+}
+
+void i2c_trace_start(struct i2c_trace *trace){
+    // The reader may be draining right now, so tail is left to it. It skips up to start on its own.
+    trace->capturing = false;
+    trace->start = trace->head;
+    trace->records = 0;
+    trace->dropped = 0;
+    __dmb();
+    trace->capturing = true;
+}
+
+void i2c_trace_stop(struct i2c_trace *trace){
+    trace->capturing = false;
+}
+
+void i2c_trace_record(struct i2c_trace *trace, uint8_t addr, uint8_t flags, const uint8_t *data, size_t len, int result, uint32_t start_us, uint32_t end_us){
+    if (!trace->capturing){
+        return;
+    }
+
+    struct i2c_trace_record record = {
+        .start_us = start_us,
+        .duration_us = end_us - start_us,
+        .len = (uint16_t) len,
+        .result = (int16_t) result,
+        .addr = addr,
+        .flags = flags,
+    };
+    if (len > I2C_TRACE_MAX_DATA){
+        record.flags |= I2C_TRACE_TRUNCATED;
+    }
+    uint16_t stored = i2c_trace_stored_len(&record);
+
+    uint32_t head = trace->head;
+    uint32_t needed = sizeof(struct i2c_trace_record) + stored;
+    if (needed > I2C_TRACE_BUFFER_SIZE - (head - trace->tail)){
+        trace->dropped++;
+        return;
+    }
+    i2c_trace_copy_in(trace, head, &record, sizeof(struct i2c_trace_record));
+    i2c_trace_copy_in(trace, head + sizeof(struct i2c_trace_record), data, stored);
+    trace->records++;
+
+    // The record has to be complete before the reader can see it
+    __dmb();
+    trace->head = head + needed;
+}
+
+void i2c_trace_discard(struct i2c_trace *trace){
+    // start only moves forward and always lands on a record boundary, between tail and head
+    uint32_t start = trace->start;
+    if ((int32_t) (start - trace->tail) > 0){
+        trace->tail = start;
+    }
+}
+
+bool i2c_trace_pop(struct i2c_trace *trace, struct i2c_trace_record *record, uint8_t *data){
+    i2c_trace_discard(trace);
+    uint32_t tail = trace->tail;
+    if (tail == trace->head){
+        return false;
+    }
+    __dmb();
+    i2c_trace_copy_out(trace, tail, record, sizeof(struct i2c_trace_record));
+    uint16_t stored = i2c_trace_stored_len(record);
+    i2c_trace_copy_out(trace, tail + sizeof(struct i2c_trace_record), data, stored);
+
+    // Done reading before the writer may reuse the space
+    __dmb();
+    trace->tail = tail + sizeof(struct i2c_trace_record) + stored;
+    return true;
+}
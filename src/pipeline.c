@@ -0,0 +1,317 @@
+#include "../include/pipeline.h"
+#include "../include/com_protocol.h"
+#include "../include/com_job.h"
+
+// Sensor and quantity of every channel, indexed by PIPELINE_CH_*
+static const uint8_t pipeline_channels[PIPELINE_N_CH][2] = {
+    [PIPELINE_CH_BMP180_TEMP] = {COM_BIN_SENSOR_BMP180, COM_BIN_Q_TEMPERATURE},
+    [PIPELINE_CH_BMP180_PRESS] = {COM_BIN_SENSOR_BMP180, COM_BIN_Q_PRESSURE},
+    [PIPELINE_CH_BMP180_ALT] = {COM_BIN_SENSOR_BMP180, COM_BIN_Q_ALTITUDE},
+    [PIPELINE_CH_BME280_TEMP] = {COM_BIN_SENSOR_BME280, COM_BIN_Q_TEMPERATURE},
+    [PIPELINE_CH_BME280_PRESS] = {COM_BIN_SENSOR_BME280, COM_BIN_Q_PRESSURE},
+    [PIPELINE_CH_BME280_HUM] = {COM_BIN_SENSOR_BME280, COM_BIN_Q_HUMIDITY},
+    [PIPELINE_CH_BME280_DEW] = {COM_BIN_SENSOR_BME280, COM_BIN_Q_DEW_POINT},
+};
+
+// Stage of the one core benchmark run, so core1 keeps its filters
+static struct pipeline_stage pipeline_bench_stage;
+
+// Points the shadow models at the calibration of the chips and at their own measurement structs
+static void pipeline_stage_init(struct pipeline_stage *stage, struct bmp180_model *bmp_180, struct bme280_model *bme_280){
+    memset(stage, 0, sizeof(struct pipeline_stage));
+    stage->bmp_180.cal_params = bmp_180->cal_params;
+    stage->bmp_180.measurement_params = &stage->bmp_measure;
+    stage->bme_280.cal_params = bme_280->cal_params;
+    stage->bme_280.settings = bme_280->settings;
+    stage->bme_280.measure = &stage->bme_measure;
+}
+
+// Reads the raw values of sensors into batch. Returns how many reads were taken. Runs on core0.
+static uint8_t pipeline_read(struct pipeline *pipe, uint32_t sensors, struct pipeline_raw *batch){
+    uint8_t n = 0;
+    if ((sensors & PIPELINE_BMP180) && (sensors & PIPELINE_BME280)){
+        // Both convert at once, see sensor_pair.h. The reads share the time stamp of the pair.
+        struct sensor_pair_timing timing;
+        uint8_t status = sensor_pair_convert(pipe->bmp_180, pipe->bme_280, &timing);
+        struct pipeline_raw bmp = {timing.time_us, PIPELINE_BMP180,
+            {(int32_t) pipe->bmp_180->measurement_params->ut, (int32_t) pipe->bmp_180->measurement_params->up, 0}};
+        batch[n++] = bmp;
+        if (status == BME280_OK){
+            struct pipeline_raw bme = {timing.time_us, PIPELINE_BME280,
+                {pipe->bme_280->measure->adc_T, pipe->bme_280->measure->adc_P, pipe->bme_280->measure->adc_H}};
+            batch[n++] = bme;
+        }
+        return n;
+    }
+    if (sensors & PIPELINE_BMP180){
+        // Both conversions wait out their time on the chip, nothing is compensated
+        bmp180_get_ut(pipe->bmp_180);
+        bmp180_get_up(pipe->bmp_180);
+        struct pipeline_raw raw = {time_us_32(), PIPELINE_BMP180,
+            {(int32_t) pipe->bmp_180->measurement_params->ut, (int32_t) pipe->bmp_180->measurement_params->up, 0}};
+        batch[n++] = raw;
+    }
+    if (sensors & PIPELINE_BME280){
+        // Same forced conversion as bme280_get_compensated_measurements_blocked, without the compensation
+        uint8_t status = bme280_start_measurements(pipe->bme_280);
+        while (status == BME280_BUSY){
+            sleep_us(100);
+            status = bme280_start_measurements(pipe->bme_280);
+        }
+        if (status == BME280_OK){
+            status = bme280_get_uncompensated_measurements(pipe->bme_280);
+            while (status == BME280_BUSY){
+                sleep_us(100);
+                status = bme280_get_uncompensated_measurements(pipe->bme_280);
+            }
+            struct pipeline_raw raw = {time_us_32(), PIPELINE_BME280,
+                {pipe->bme_280->measure->adc_T, pipe->bme_280->measure->adc_P, pipe->bme_280->measure->adc_H}};
+            batch[n++] = raw;
+        }
+    }
+    return n;
+}
+
+// Dew point in 0.01 C from a temperature in 0.01 C and a humidity in 1/1024 %RH
+static int32_t pipeline_dew_point(int32_t T, uint32_t H){
+    float t = (float) T / 100.0f;
+    float gamma = logf(((float) H / 1024.0f) / 100.0f) + (PIPELINE_MAGNUS_B * t) / (PIPELINE_MAGNUS_C + t);
+    return (int32_t) (100.0f * PIPELINE_MAGNUS_C * gamma / (PIPELINE_MAGNUS_B - gamma));
+}
+
+// Filters value into its channel and sends both on if emit is set
+static void pipeline_emit(struct pipeline_stage *stage, uint8_t ch, uint32_t time_us, int32_t value, bool emit){
+    if (stage->primed[ch]){
+        stage->filtered[ch] += (value - stage->filtered[ch]) >> PIPELINE_FILTER_SHIFT;
+    }
+    else {
+        // The first value starts the filter where it is
+        stage->filtered[ch] = value;
+        stage->primed[ch] = true;
+    }
+    if (!emit){
+        return;
+    }
+    if (com_binary_active()){
+        com_binary_send_sample(pipeline_channels[ch][0], pipeline_channels[ch][1], time_us, stage->filtered[ch]);
+    }
+    else {
+        printf("PIPE,%u,%u,%u,%d,%d\r\n", time_us, pipeline_channels[ch][0], pipeline_channels[ch][1], value, stage->filtered[ch]);
+    }
+}
+
+// Compensates, filters and derives one raw read
+static void pipeline_stage_run(struct pipeline_stage *stage, const struct pipeline_raw *raw, bool emit){
+    if (raw->sensor == PIPELINE_BMP180){
+        stage->bmp_measure.ut = raw->adc[0];
+        stage->bmp_measure.up = raw->adc[1];
+        bmp180_compensate(&stage->bmp_180);
+        pipeline_emit(stage, PIPELINE_CH_BMP180_TEMP, raw->time_us, (int32_t) stage->bmp_measure.T, emit);
+        pipeline_emit(stage, PIPELINE_CH_BMP180_PRESS, raw->time_us, (int32_t) stage->bmp_measure.p, emit);
+        // Altitude from the filtered pressure, the raw one jumps by meters
+        float altitude = bmp180_altitude_from_pressure(stage->filtered[PIPELINE_CH_BMP180_PRESS]);
+        pipeline_emit(stage, PIPELINE_CH_BMP180_ALT, raw->time_us, (int32_t) (altitude * 1000.0f), emit);
+    }
+    else if (raw->sensor == PIPELINE_BME280){
+        stage->bme_measure.adc_T = raw->adc[0];
+        stage->bme_measure.adc_P = raw->adc[1];
+        stage->bme_measure.adc_H = raw->adc[2];
+        bme280_compensate(&stage->bme_280);
+        pipeline_emit(stage, PIPELINE_CH_BME280_TEMP, raw->time_us, stage->bme_measure.T, emit);
+        pipeline_emit(stage, PIPELINE_CH_BME280_PRESS, raw->time_us, (int32_t) stage->bme_measure.P, emit);
+        pipeline_emit(stage, PIPELINE_CH_BME280_HUM, raw->time_us, (int32_t) stage->bme_measure.H, emit);
+        // No dew point of dry air
+        if (stage->bme_measure.H > 0){
+            pipeline_emit(stage, PIPELINE_CH_BME280_DEW, raw->time_us, pipeline_dew_point(stage->bme_measure.T, stage->bme_measure.H), emit);
+        }
+    }
+}
+
+// Runs in the timer interrupt on core0. Only queues the work, the sensors are read by main.
+static bool pipeline_timer_callback(repeating_timer_t *rt){
+    struct pipeline *pipe = (struct pipeline *) rt->user_data;
+    pipe->ticks++;
+    if (pipe->pending){
+        // main has not caught up with the last tick
+        pipe->skipped++;
+        return true;
+    }
+    struct com_job entry = {.op = COM_JOB_PIPELINE_ACQUIRE, .handle = pipe};
+    if (queue_try_add(&call_queue, &entry)){
+        pipe->pending = true;
+    }
+    else {
+        pipe->skipped++;
+    }
+    return true;
+}
+
+void pipeline_init(struct pipeline *pipe, struct bmp180_model *bmp_180, struct bme280_model *bme_280){
+    pipe->bmp_180 = bmp_180;
+    pipe->bme_280 = bme_280;
+    spsc_ring_init(&pipe->raw, pipe->raw_records, sizeof(struct pipeline_raw), PIPELINE_RING_LEN);
+    pipeline_stage_init(&pipe->stage, bmp_180, bme_280);
+    pipe->req_sensors = 0;
+    pipe->req_period_us = 0;
+    pipe->sensors = 0;
+    pipe->period_us = 0;
+    pipe->running = false;
+    pipe->pending = false;
+    pipe->bench = false;
+    pipe->reprime = false;
+    pipe->ticks = 0;
+    pipe->skipped = 0;
+    pipe->acquired = 0;
+    pipe->pushed = 0;
+    pipe->acquire_us = 0;
+    pipe->acquire_max_us = 0;
+    pipe->processed = 0;
+    pipe->process_us = 0;
+    pipe->process_max_us = 0;
+}
+
+void pipeline_start(struct pipeline *pipe){
+    if (pipe->running){
+        cancel_repeating_timer(&pipe->timer);
+        pipe->running = false;
+    }
+    pipe->sensors = pipe->req_sensors;
+    pipe->period_us = pipe->req_period_us;
+    pipe->ticks = 0;
+    pipe->skipped = 0;
+    pipe->acquired = 0;
+    pipe->acquire_us = 0;
+    pipe->acquire_max_us = 0;
+    // main is the producer, so it may reset the producer counters
+    pipe->raw.dropped = 0;
+    pipe->raw.high_water = 0;
+    // The filters belong to core1, it starts them over with the next read
+    pipe->reprime = true;
+
+    // A negative delay keeps the rate fixed, no matter how long the callback takes
+    pipe->running = add_repeating_timer_us(-((int64_t) pipe->period_us), pipeline_timer_callback, pipe, &pipe->timer);
+    #if PIPELINE_INFO
+    if (pipe->running){
+        printf("[PIPELINE]: Acquiring sensors 0x%02x every %u us.\r\n", pipe->sensors, pipe->period_us);
+    }
+    else {
+        printf("[PIPELINE]: No alarm left for the pipeline timer.\r\n");
+    }
+    #endif
+}
+
+void pipeline_stop(struct pipeline *pipe){
+    if (pipe->running){
+        cancel_repeating_timer(&pipe->timer);
+        pipe->running = false;
+    }
+    #if PIPELINE_INFO
+    printf("[PIPELINE]: Stopped after %u ticks, %u skipped, %u reads dropped.\r\n", pipe->ticks, pipe->skipped, pipe->raw.dropped);
+    #endif
+}
+
+void pipeline_acquire(struct pipeline *pipe){
+    // From here on the timer may queue the next tick
+    pipe->pending = false;
+    if (!pipe->running || pipe->bench){
+        // Stopped while this was in the call queue
+        return;
+    }
+    struct pipeline_raw batch[2];
+    uint32_t start = time_us_32();
+    uint8_t n = pipeline_read(pipe, pipe->sensors, batch);
+    uint32_t elapsed = time_us_32() - start;
+    pipe->acquire_us += elapsed;
+    if (elapsed > pipe->acquire_max_us){
+        pipe->acquire_max_us = elapsed;
+    }
+    pipe->acquired += n;
+    // Whatever does not fit is counted as dropped by the ring
+    pipe->pushed += spsc_ring_push_batch(&pipe->raw, batch, n);
+    // Wake core1 in case it sleeps in WFE
+    __sev();
+}
+
+uint16_t pipeline_process(struct pipeline *pipe, uint16_t max){
+    struct pipeline_raw batch[PIPELINE_PROCESS_MAX];
+    if (max > PIPELINE_PROCESS_MAX){
+        max = PIPELINE_PROCESS_MAX;
+    }
+    if (pipe->reprime){
+        memset(pipe->stage.primed, 0, sizeof(pipe->stage.primed));
+        pipe->reprime = false;
+    }
+    uint16_t n = (uint16_t) spsc_ring_pop_batch(&pipe->raw, batch, max);
+    bool emit = !pipe->bench;
+    for (uint16_t i = 0; i < n; i++){
+        uint32_t start = time_us_32();
+        pipeline_stage_run(&pipe->stage, &batch[i], emit);
+        uint32_t elapsed = time_us_32() - start;
+        pipe->process_us += elapsed;
+        if (elapsed > pipe->process_max_us){
+            pipe->process_max_us = elapsed;
+        }
+    }
+    // Published last, the benchmark waits on it
+    pipe->processed += n;
+    return n;
+}
+
+void pipeline_bench(struct pipeline *pipe, uint32_t n, struct pipeline_bench *result){
+    if (pipe->running){
+        cancel_repeating_timer(&pipe->timer);
+        pipe->running = false;
+    }
+    pipe->bench = true;
+    // Let core1 finish what acquisition left for it, so the one core run has the sensors and the cores to itself
+    while (pipe->processed != pipe->pushed){
+        tight_loop_contents();
+    }
+
+    uint32_t sensors = (pipe->req_sensors != 0) ? pipe->req_sensors : (PIPELINE_BMP180 | PIPELINE_BME280);
+    struct pipeline_raw batch[2];
+    uint8_t len = 0;
+    memset(result, 0, sizeof(struct pipeline_bench));
+    result->samples = n;
+    result->sensors = sensors;
+
+    // One core. main acquires and processes on a stage of its own.
+    pipeline_stage_init(&pipeline_bench_stage, pipe->bmp_180, pipe->bme_280);
+    uint32_t start = time_us_32();
+    for (uint32_t i = 0; i < n; i++){
+        len = pipeline_read(pipe, sensors, batch);
+        for (uint8_t j = 0; j < len; j++){
+            pipeline_stage_run(&pipeline_bench_stage, &batch[j], false);
+        }
+        result->records += len;
+    }
+    result->one_core_us = time_us_32() - start;
+
+    // Two cores. main acquires, core1 processes while main is on the bus for the next one.
+    uint32_t processed = pipe->processed;
+    uint32_t process_us = pipe->process_us;
+    uint32_t records = 0;
+    start = time_us_32();
+    for (uint32_t i = 0; i < n; i++){
+        uint32_t acquire_start = time_us_32();
+        len = pipeline_read(pipe, sensors, batch);
+        result->acquire_us += time_us_32() - acquire_start;
+        for (uint8_t j = 0; j < len; j++){
+            // A benchmark measures, it does not drop. Wait for room instead.
+            while (spsc_ring_level(&pipe->raw) >= spsc_ring_capacity(&pipe->raw)){
+                tight_loop_contents();
+            }
+            spsc_ring_push(&pipe->raw, &batch[j]);
+        }
+        records += len;
+        pipe->pushed += len;
+        __sev();
+    }
+    while ((pipe->processed - processed) < records){
+        tight_loop_contents();
+    }
+    result->two_core_us = time_us_32() - start;
+    result->process_us = pipe->process_us - process_us;
+
+    pipe->bench = false;
+}
@@ -0,0 +1,86 @@
+#include "../include/sensor_pair.h"
+
+// Time the BME280 needs after the start, 0 in normal mode where it converts on its own
+static uint32_t sensor_pair_bme280_wait_us(struct bme280_model *bme_280){
+    return (bme_280->settings->mode == 0b11) ? 0 : bme280_measurement_time_us(bme_280);
+}
+
+uint8_t sensor_pair_convert(struct bmp180_model *bmp_180, struct bme280_model *bme_280, struct sensor_pair_timing *timing){
+    // BME280 first, its measurement is usually the longer one
+    uint8_t status = bme280_start_measurements(bme_280);
+    while (status == BME280_BUSY){
+        sleep_us(100);
+        status = bme280_start_measurements(bme_280);
+    }
+    uint64_t start = time_us_64();
+    bmp180_start_ut(bmp_180);
+    timing->time_us = (uint32_t) start;
+
+    // Due times of what is still to be read, UINT64_MAX once read or never started
+    uint64_t bme_due = (status == BME280_OK) ? start + sensor_pair_bme280_wait_us(bme_280) : UINT64_MAX;
+    uint64_t ut_due = start + bmp180_ut_wait_us();
+    uint64_t up_due = UINT64_MAX;
+    timing->bmp180_done_us = 0;
+    timing->bme280_done_us = 0;
+
+    while ((bme_due != UINT64_MAX) || (ut_due != UINT64_MAX) || (up_due != UINT64_MAX)){
+        uint64_t next = bme_due;
+        if (ut_due < next){
+            next = ut_due;
+        }
+        if (up_due < next){
+            next = up_due;
+        }
+        sleep_until(from_us_since_boot(next));
+        uint64_t now = time_us_64();
+
+        if (ut_due <= now){
+            // The pressure conversion starts as soon as the temperature is out
+            bmp180_read_ut(bmp_180);
+            bmp180_start_up(bmp_180);
+            ut_due = UINT64_MAX;
+            up_due = time_us_64() + bmp180_up_wait_us();
+        }
+        else if (up_due <= now){
+            bmp180_read_up(bmp_180);
+            up_due = UINT64_MAX;
+            timing->bmp180_done_us = (uint32_t) (time_us_64() - start);
+        }
+        if (bme_due <= now){
+            // The measurement time is a max, the status only says busy if the chip is slower than its datasheet
+            uint8_t read = bme280_get_uncompensated_measurements(bme_280);
+            while (read == BME280_BUSY){
+                sleep_us(100);
+                read = bme280_get_uncompensated_measurements(bme_280);
+            }
+            bme_due = UINT64_MAX;
+            timing->bme280_done_us = (uint32_t) (time_us_64() - start);
+        }
+    }
+    timing->elapsed_us = (uint32_t) (time_us_64() - start);
+
+    #if SENSOR_PAIR_INFO
+    if (status == BME280_SLEEP){
+        printf("[SENSOR_PAIR]: The BME280 is in sleep mode, only the BMP180 was read.\r\n");
+    }
+    #endif
+    return (status == BME280_SLEEP) ? BME280_SLEEP : BME280_OK;
+}
+
+uint8_t sensor_pair_measure(struct bmp180_model *bmp_180, struct bme280_model *bme_280, struct sensor_pair_timing *timing){
+    uint8_t status = sensor_pair_convert(bmp_180, bme_280, timing);
+    bmp180_compensate(bmp_180);
+    bmp_180->measurement_params->altitude = bmp180_altitude_from_pressure(bmp_180->measurement_params->p);
+    bmp180_publish_at(bmp_180, timing->time_us);
+    if (status == BME280_OK){
+        bme280_compensate(bme_280);
+        bme280_publish_at(bme_280, timing->time_us);
+    }
+    return status;
+}
+
+uint32_t sensor_pair_conversion_time_us(struct bmp180_model *bmp_180, struct bme280_model *bme_280){
+    uint32_t bmp_wait = bmp180_ut_wait_us() + bmp180_up_wait_us();
+    uint32_t bme_wait = sensor_pair_bme280_wait_us(bme_280);
+    return (bmp_wait > bme_wait) ? bmp_wait : bme_wait;
+}
@@ -0,0 +1,36 @@
+#include "../include/seqlock.h"
+
+void seqlock_init(struct seqlock *lock){
+    lock->seq = 0;
+}
+
+void seqlock_write(struct seqlock *lock, void *dst, const void *src, size_t len){
+    lock->seq++;
+    // Readers have to see the odd seq before any of the new values
+    __dmb();
+    memcpy(dst, src, len);
+    // And all of the new values before the even seq
+    __dmb();
+    lock->seq++;
+}
+
+bool seqlock_read(const struct seqlock *lock, void *dst, const void *src, size_t len){
+    for (uint8_t i = 0; i < SEQLOCK_READ_TRIES; i++){
+        uint32_t seq = lock->seq;
+        if (seq == 0){
+            // Nothing published yet
+            return false;
+        }
+        if (seq & 1){
+            // A write is in progress
+            continue;
+        }
+        __dmb();
+        memcpy(dst, src, len);
+        __dmb();
+        if (lock->seq == seq){
+            return true;
+        }
+    }
+    return false;
+}
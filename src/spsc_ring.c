@@ -0,0 +1,93 @@
+#include "../include/spsc_ring.h"
+
+void spsc_ring_init(struct spsc_ring *ring, void *records, uint16_t size, uint32_t len){
+    ring->records = (uint8_t *) records;
+    ring->size = size;
+    ring->mask = len - 1;
+    ring->head = 0;
+    ring->dropped = 0;
+    ring->high_water = 0;
+    ring->tail = 0;
+}
+
+uint32_t spsc_ring_capacity(const struct spsc_ring *ring){
+    return ring->mask + 1;
+}
+
+uint32_t spsc_ring_level(const struct spsc_ring *ring){
+    return ring->head - ring->tail;
+}
+
+bool spsc_ring_is_empty(const struct spsc_ring *ring){
+    return ring->head == ring->tail;
+}
+
+// Copies n records between a flat buffer and the ring starting at index, split at the wrap
+static void spsc_ring_copy(struct spsc_ring *ring, uint32_t index, uint8_t *flat, uint32_t n, bool into_ring){
+    uint32_t slot = index & ring->mask;
+    uint32_t first = spsc_ring_capacity(ring) - slot;
+    if (first > n){
+        first = n;
+    }
+    uint8_t *at = &ring->records[slot * ring->size];
+    size_t first_bytes = (size_t) first * ring->size;
+    size_t rest_bytes = (size_t) (n - first) * ring->size;
+    if (into_ring){
+        memcpy(at, flat, first_bytes);
+        memcpy(ring->records, flat + first_bytes, rest_bytes);
+    }
+    else {
+        memcpy(flat, at, first_bytes);
+        memcpy(flat + first_bytes, ring->records, rest_bytes);
+    }
+}
+
+uint32_t spsc_ring_push_batch(struct spsc_ring *ring, const void *records, uint32_t n){
+    uint32_t head = ring->head;
+    uint32_t free = spsc_ring_capacity(ring) - (head - ring->tail);
+    uint32_t fit = (n > free) ? free : n;
+    if (fit < n){
+        ring->dropped += n - fit;
+    }
+    if (fit == 0){
+        return 0;
+    }
+    spsc_ring_copy(ring, head, (uint8_t *) records, fit, true);
+    // The records have to be in before the consumer can see them
+    __dmb();
+    ring->head = head + fit;
+
+    uint32_t level = head + fit - ring->tail;
+    if (level > ring->high_water){
+        ring->high_water = level;
+    }
+    return fit;
+}
+
+bool spsc_ring_push(struct spsc_ring *ring, const void *record){
+    return spsc_ring_push_batch(ring, record, 1) == 1;
+}
+
+uint32_t spsc_ring_pop_batch(struct spsc_ring *ring, void *records, uint32_t max){
+    uint32_t tail = ring->tail;
+    uint32_t level = ring->head - tail;
+    uint32_t n = (max > level) ? level : max;
+    if (n == 0){
+        return 0;
+    }
+    // Read the records only after seeing head
+    __dmb();
+    spsc_ring_copy(ring, tail, (uint8_t *) records, n, false);
+    // Done with the slots before the producer may reuse them
+    __dmb();
+    ring->tail = tail + n;
+    return n;
+}
+
+bool spsc_ring_pop(struct spsc_ring *ring, void *record){
+    return spsc_ring_pop_batch(ring, record, 1) == 1;
+}
+
+void spsc_ring_flush(struct spsc_ring *ring){
+    ring->tail = ring->head;
+}
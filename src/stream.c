@@ -0,0 +1,150 @@
+#include "../include/stream.h"
+#include "../include/com_protocol.h"
+#include "../include/com_job.h"
+
+// Adds a value to the batch of this tick
+static void stream_push(struct stream_sample *batch, uint8_t *n, uint8_t sensor, uint8_t quantity, uint32_t time_us, int32_t value){
+    struct stream_sample sample = {time_us, value, sensor, quantity};
+    batch[(*n)++] = sample;
+}
+
+// Runs in the timer interrupt on core0. Only queues the work, the sensors are read by main.
+static bool stream_timer_callback(repeating_timer_t *rt){
+    struct stream *stream = (struct stream *) rt->user_data;
+    stream->ticks++;
+    if (stream->pending){
+        // main has not caught up with the last tick
+        stream->skipped++;
+        return true;
+    }
+    struct com_job entry = {.op = COM_JOB_STREAM_SAMPLE, .handle = stream};
+    if (queue_try_add(&call_queue, &entry)){
+        stream->pending = true;
+    }
+    else {
+        stream->skipped++;
+    }
+    return true;
+}
+
+void stream_init(struct stream *stream, struct bmp180_model *bmp_180, struct bme280_model *bme_280){
+    stream->bmp_180 = bmp_180;
+    stream->bme_280 = bme_280;
+    spsc_ring_init(&stream->samples, stream->sample_records, sizeof(struct stream_sample), STREAM_RING_LEN);
+    stream->req_channels = 0;
+    stream->req_period_us = 0;
+    stream->channels = 0;
+    stream->period_us = 0;
+    stream->running = false;
+    stream->pending = false;
+    stream->ticks = 0;
+    stream->skipped = 0;
+    stream->sent = 0;
+}
+
+void stream_start(struct stream *stream){
+    if (stream->running){
+        cancel_repeating_timer(&stream->timer);
+        stream->running = false;
+    }
+    stream->channels = stream->req_channels;
+    stream->period_us = stream->req_period_us;
+    stream->ticks = 0;
+    stream->skipped = 0;
+    stream->sent = 0;
+    // main is the producer, so it may reset the producer counters
+    stream->samples.dropped = 0;
+    stream->samples.high_water = 0;
+
+    // A negative delay keeps the rate fixed, no matter how long the callback takes
+    stream->running = add_repeating_timer_us(-((int64_t) stream->period_us), stream_timer_callback, stream, &stream->timer);
+    #if STREAM_INFO
+    if (stream->running){
+        printf("[STREAM]: Streaming channels 0x%02x every %u us.\r\n", stream->channels, stream->period_us);
+    }
+    else {
+        printf("[STREAM]: No alarm left for the stream timer.\r\n");
+    }
+    #endif
+}
+
+void stream_stop(struct stream *stream){
+    if (stream->running){
+        cancel_repeating_timer(&stream->timer);
+        stream->running = false;
+    }
+    #if STREAM_INFO
+    printf("[STREAM]: Stopped after %u ticks, %u skipped, %u samples dropped.\r\n", stream->ticks, stream->skipped, stream->samples.dropped);
+    #endif
+}
+
+void stream_sample(struct stream *stream){
+    // From here on the timer may queue the next tick
+    stream->pending = false;
+    if (!stream->running){
+        // Stopped while this was in the call queue
+        return;
+    }
+
+    if (stream->channels & STREAM_CH_BMP180_ALT){
+        // Measures the temperature and pressure on the way
+        bmp180_get_altitude(stream->bmp_180);
+    }
+    else if (stream->channels & STREAM_CH_BMP180){
+        bmp180_get_measurement(stream->bmp_180);
+    }
+    // Values go out as published, stamped with the time they were. One tick is handed to core1 as one batch.
+    struct stream_sample batch[STREAM_TICK_MAX];
+    uint8_t n = 0;
+    struct bmp180_sample bmp;
+    if ((stream->channels & (STREAM_CH_BMP180 | STREAM_CH_BMP180_ALT)) && bmp180_read_sample(stream->bmp_180, &bmp)){
+        if (stream->channels & STREAM_CH_BMP180){
+            stream_push(batch, &n, COM_BIN_SENSOR_BMP180, COM_BIN_Q_TEMPERATURE, bmp.time_us, bmp.T);
+            stream_push(batch, &n, COM_BIN_SENSOR_BMP180, COM_BIN_Q_PRESSURE, bmp.time_us, bmp.p);
+        }
+        if (stream->channels & STREAM_CH_BMP180_ALT){
+            stream_push(batch, &n, COM_BIN_SENSOR_BMP180, COM_BIN_Q_ALTITUDE, bmp.time_us, (int32_t) (bmp.altitude * 1000.0f));
+        }
+    }
+
+    struct bme280_sample bme;
+    if (stream->channels & STREAM_CH_BME280){
+        // One forced conversion covers all three
+        bme280_get_compensated_measurements_blocked(stream->bme_280);
+        if (bme280_read_sample(stream->bme_280, &bme)){
+            if (stream->channels & STREAM_CH_BME280_TEMP){
+                stream_push(batch, &n, COM_BIN_SENSOR_BME280, COM_BIN_Q_TEMPERATURE, bme.time_us, bme.T);
+            }
+            if (stream->channels & STREAM_CH_BME280_PRESS){
+                stream_push(batch, &n, COM_BIN_SENSOR_BME280, COM_BIN_Q_PRESSURE, bme.time_us, (int32_t) bme.P);
+            }
+            if (stream->channels & STREAM_CH_BME280_HUM){
+                stream_push(batch, &n, COM_BIN_SENSOR_BME280, COM_BIN_Q_HUMIDITY, bme.time_us, (int32_t) bme.H);
+            }
+        }
+    }
+
+    // Whatever does not fit is counted as dropped by the ring
+    spsc_ring_push_batch(&stream->samples, batch, n);
+    // Wake core1 in case it sleeps in WFE
+    __sev();
+}
+
+uint16_t stream_drain(struct stream *stream, uint16_t max){
+    struct stream_sample batch[STREAM_DRAIN_MAX];
+    if (max > STREAM_DRAIN_MAX){
+        max = STREAM_DRAIN_MAX;
+    }
+    uint16_t n = (uint16_t) spsc_ring_pop_batch(&stream->samples, batch, max);
+    for (uint16_t i = 0; i < n; i++){
+        struct stream_sample *sample = &batch[i];
+        if (com_binary_active()){
+            com_binary_send_sample(sample->sensor, sample->quantity, sample->time_us, sample->value);
+        }
+        else {
+            printf("STREAM,%u,%u,%u,%d\r\n", sample->time_us, sample->sensor, sample->quantity, sample->value);
+        }
+    }
+    stream->sent += n;
+    return n;
+}
@@ -0,0 +1,199 @@
+#include "../include/task_sched.h"
+
+// Hardware alarm callbacks carry no user data, there is one scheduler
+static struct task_sched *task_sched_owner;
+
+// Marks every task whose release has come ready and sets the alarm to the next release.
+// Runs in the alarm interrupt, or on main with interrupts off.
+static void task_sched_release(struct task_sched *sched){
+    bool woken = false;
+    uint64_t next;
+    do {
+        uint64_t now = time_us_64();
+        next = UINT64_MAX;
+        for (uint8_t i = 0; i < sched->n_tasks; i++){
+            struct task_sched_task *task = &sched->tasks[i];
+            if (task->period_us == 0){
+                continue;
+            }
+            while (task->release_us <= now){
+                if (task->ready){
+                    // The last instance never started, this one is dropped
+                    task->misses++;
+                }
+                else {
+                    task->ready = true;
+                    task->pending_us = task->release_us;
+                    woken = true;
+                }
+                task->release_us += task->period_us;
+            }
+            if (task->release_us < next){
+                next = task->release_us;
+            }
+        }
+        // Setting a target that already passed returns true, release again then
+    } while ((next != UINT64_MAX) && hardware_alarm_set_target((uint) sched->alarm, from_us_since_boot(next)));
+
+    if (next == UINT64_MAX){
+        hardware_alarm_cancel((uint) sched->alarm);
+    }
+    if (woken){
+        // Wake main in case it sleeps in WFE
+        __sev();
+    }
+}
+
+static void task_sched_alarm_callback(uint alarm_num){
+    task_sched_release(task_sched_owner);
+}
+
+void task_sched_init(struct task_sched *sched){
+    memset(sched, 0, sizeof(struct task_sched));
+    sched->alarm = hardware_alarm_claim_unused(true);
+    task_sched_owner = sched;
+    hardware_alarm_set_callback((uint) sched->alarm, task_sched_alarm_callback);
+}
+
+int task_sched_add(struct task_sched *sched, const char *name, void (*run)(void *ctx), void *ctx, uint32_t period_us, uint32_t phase_us, uint32_t budget_us){
+    if (sched->n_tasks >= TASK_SCHED_MAX_TASKS){
+        #if TASK_SCHED_INFO
+        printf("[TASK_SCHED]: No room left for task %s.\r\n", name);
+        #endif
+        return -1;
+    }
+    struct task_sched_task *task = &sched->tasks[sched->n_tasks];
+    memset(task, 0, sizeof(struct task_sched_task));
+    task->name = name;
+    task->run = run;
+    task->ctx = ctx;
+    task->period_us = period_us;
+    task->phase_us = phase_us;
+    task->budget_us = budget_us;
+    return sched->n_tasks++;
+}
+
+void task_sched_start(struct task_sched *sched){
+    uint32_t irq = save_and_disable_interrupts();
+    sched->start_us = time_us_64();
+    for (uint8_t i = 0; i < sched->n_tasks; i++){
+        sched->tasks[i].release_us = sched->start_us + sched->tasks[i].phase_us;
+        sched->tasks[i].ready = false;
+    }
+    sched->running = true;
+    task_sched_release(sched);
+    restore_interrupts(irq);
+    #if TASK_SCHED_INFO
+    printf("[TASK_SCHED]: Started %u tasks on alarm %d.\r\n", sched->n_tasks, sched->alarm);
+    #endif
+}
+
+void task_sched_run(struct task_sched *sched){
+    for (uint8_t i = 0; i < sched->n_tasks; i++){
+        struct task_sched_task *task = &sched->tasks[i];
+        // Taken before it runs, so a release while it runs is the next instance and not a miss
+        uint32_t irq = save_and_disable_interrupts();
+        bool ready = task->ready;
+        uint64_t release_us = task->pending_us;
+        task->ready = false;
+        restore_interrupts(irq);
+        if (!ready){
+            continue;
+        }
+
+        uint64_t start = time_us_64();
+        task->run(task->ctx);
+        uint64_t end = time_us_64();
+
+        uint32_t jitter = (uint32_t) (start - release_us);
+        uint32_t run = (uint32_t) (end - start);
+        irq = save_and_disable_interrupts();
+        task->runs++;
+        task->jitter_total_us += jitter;
+        if (jitter > task->jitter_max_us){
+            task->jitter_max_us = jitter;
+        }
+        task->run_total_us += run;
+        if (run > task->run_max_us){
+            task->run_max_us = run;
+        }
+        if (run > task->budget_us){
+            task->overruns++;
+        }
+        // The deadline is the next release, a task that disabled itself has none
+        if ((task->period_us != 0) && (end > (release_us + task->period_us))){
+            task->misses++;
+        }
+        restore_interrupts(irq);
+    }
+}
+
+void task_sched_set_period(struct task_sched *sched, uint8_t index, uint32_t period_us){
+    if (index >= sched->n_tasks){
+        return;
+    }
+    struct task_sched_task *task = &sched->tasks[index];
+    uint32_t irq = save_and_disable_interrupts();
+    task->period_us = period_us;
+    task->ready = false;
+    task->release_us = time_us_64() + task->phase_us;
+    if (sched->running){
+        task_sched_release(sched);
+    }
+    restore_interrupts(irq);
+    #if TASK_SCHED_INFO
+    if (period_us != 0){
+        printf("[TASK_SCHED]: Task %s every %u us.\r\n", task->name, period_us);
+    }
+    else {
+        printf("[TASK_SCHED]: Task %s disabled.\r\n", task->name);
+    }
+    #endif
+}
+
+void task_sched_reset(struct task_sched *sched){
+    uint32_t irq = save_and_disable_interrupts();
+    for (uint8_t i = 0; i < sched->n_tasks; i++){
+        struct task_sched_task *task = &sched->tasks[i];
+        task->runs = 0;
+        task->misses = 0;
+        task->overruns = 0;
+        task->jitter_max_us = 0;
+        task->jitter_total_us = 0;
+        task->run_max_us = 0;
+        task->run_total_us = 0;
+    }
+    sched->start_us = time_us_64();
+    restore_interrupts(irq);
+}
+
+void task_sched_snapshot(struct task_sched *sched, struct task_sched_snapshot *snapshot){
+    uint32_t irq = save_and_disable_interrupts();
+    snapshot->n_tasks = sched->n_tasks;
+    snapshot->elapsed_ms = (uint32_t) ((time_us_64() - sched->start_us) / 1000);
+    for (uint8_t i = 0; i < sched->n_tasks; i++){
+        struct task_sched_task *task = &sched->tasks[i];
+        struct task_sched_report *report = &snapshot->tasks[i];
+        report->name = task->name;
+        report->period_us = task->period_us;
+        report->phase_us = task->phase_us;
+        report->budget_us = task->budget_us;
+        report->runs = task->runs;
+        report->misses = task->misses;
+        report->overruns = task->overruns;
+        report->jitter_mean_us = (task->runs != 0) ? (uint32_t) (task->jitter_total_us / task->runs) : 0;
+        report->jitter_max_us = task->jitter_max_us;
+        report->run_mean_us = (task->runs != 0) ? (uint32_t) (task->run_total_us / task->runs) : 0;
+        report->run_max_us = task->run_max_us;
+    }
+    restore_interrupts(irq);
+}
+
+int task_sched_find(struct task_sched *sched, const char *name){
+    for (uint8_t i = 0; i < sched->n_tasks; i++){
+        if (strcmp(sched->tasks[i].name, name) == 0){
+            return i;
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,77 @@
+#include <stdio.h>
+#include "../include/block_storage.h"
+
+#define TEST_NAME "BLOCK_STORAGE_TEST"
+#include "test_check.h"
+
+/*
+Host test of the file backend, built by a PICO_PLATFORM=host configure and run by ctest.
+Checks the NOR rules it emulates, the range and alignment checks of the block_storage_* wrappers
+and that the image survives closing and opening it again.
+*/
+
+#define TEST_FILE "block_storage_test.img"
+#define TEST_SIZE _u(8192)
+#define TEST_ERASE _u(1024)
+#define TEST_PROGRAM _u(64)
+
+// True if all len bytes at addr read back as value
+static bool test_reads_as(struct block_storage *storage, uint32_t addr, uint32_t len, uint8_t value){
+    uint8_t data[TEST_ERASE];
+    if (block_storage_read(storage, addr, data, len) != BLOCK_STORAGE_OK){
+        return false;
+    }
+    for (uint32_t i = 0; i < len; i++){
+        if (data[i] != value){
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(){
+    stdio_init_all();
+    remove(TEST_FILE);
+
+    struct block_storage storage;
+    TEST_CHECK(block_storage_file_init(&storage, TEST_FILE, TEST_SIZE, TEST_ERASE, TEST_PROGRAM) == BLOCK_STORAGE_OK);
+    TEST_CHECK(storage.needs_erase);
+
+    // A new image reads as erased
+    TEST_CHECK(test_reads_as(&storage, 0, TEST_ERASE, 0xFF));
+    TEST_CHECK(test_reads_as(&storage, TEST_SIZE - TEST_ERASE, TEST_ERASE, 0xFF));
+
+    // A program only clears bits, programming over data gives the AND of both
+    uint8_t page[TEST_PROGRAM];
+    memset(page, 0xF0, TEST_PROGRAM);
+    TEST_CHECK(block_storage_program(&storage, TEST_PROGRAM, page, TEST_PROGRAM) == BLOCK_STORAGE_OK);
+    TEST_CHECK(test_reads_as(&storage, TEST_PROGRAM, TEST_PROGRAM, 0xF0));
+    memset(page, 0x3C, TEST_PROGRAM);
+    TEST_CHECK(block_storage_program(&storage, TEST_PROGRAM, page, TEST_PROGRAM) == BLOCK_STORAGE_OK);
+    TEST_CHECK(test_reads_as(&storage, TEST_PROGRAM, TEST_PROGRAM, 0x30));
+    // The neighbours are untouched
+    TEST_CHECK(test_reads_as(&storage, 0, TEST_PROGRAM, 0xFF));
+    TEST_CHECK(test_reads_as(&storage, 2 * TEST_PROGRAM, TEST_PROGRAM, 0xFF));
+
+    // Requests that do not make sense never reach the backend
+    uint8_t byte;
+    TEST_CHECK(block_storage_program(&storage, 1, page, TEST_PROGRAM) == BLOCK_STORAGE_ALIGN);
+    TEST_CHECK(block_storage_program(&storage, 0, page, TEST_PROGRAM - 1) == BLOCK_STORAGE_ALIGN);
+    TEST_CHECK(block_storage_erase(&storage, TEST_PROGRAM, TEST_ERASE) == BLOCK_STORAGE_ALIGN);
+    TEST_CHECK(block_storage_read(&storage, TEST_SIZE, &byte, 1) == BLOCK_STORAGE_RANGE);
+    TEST_CHECK(block_storage_read(&storage, TEST_SIZE - 1, page, 2) == BLOCK_STORAGE_RANGE);
+
+    // The image is still there after closing it
+    TEST_CHECK(block_storage_sync(&storage) == BLOCK_STORAGE_OK);
+    block_storage_file_deinit(&storage);
+    TEST_CHECK(block_storage_file_init(&storage, TEST_FILE, TEST_SIZE, TEST_ERASE, TEST_PROGRAM) == BLOCK_STORAGE_OK);
+    TEST_CHECK(test_reads_as(&storage, TEST_PROGRAM, TEST_PROGRAM, 0x30));
+
+    // An erase sets the whole unit back
+    TEST_CHECK(block_storage_erase(&storage, 0, TEST_ERASE) == BLOCK_STORAGE_OK);
+    TEST_CHECK(test_reads_as(&storage, 0, TEST_ERASE, 0xFF));
+
+    block_storage_file_deinit(&storage);
+    remove(TEST_FILE);
+    return test_report();
+}
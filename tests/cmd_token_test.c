@@ -0,0 +1,84 @@
+#include <stdio.h>
+#include "../include/cmd_token.h"
+
+#define TEST_NAME "CMD_TOKEN_TEST"
+#include "test_check.h"
+
+/*
+Host test of the command line tokenizer, run by ctest.
+Checks the int32_t range of numbers, hex, fixed point truncation, quotes and how - and -- split options from numbers.
+*/
+
+// Tokenizes line, which has to hold exactly one token, into token. False if there is none or more than one.
+static bool test_one(const char *line, struct cmd_token *token){
+    const char *cursor = line;
+    const char *end = line + strlen(line);
+    if (!cmd_token_next(&cursor, end, token)){
+        return false;
+    }
+    struct cmd_token extra;
+    return !cmd_token_next(&cursor, end, &extra);
+}
+
+static bool test_is(const char *line, uint8_t type, int32_t value){
+    struct cmd_token token;
+    return test_one(line, &token) && (token.type == type) && (token.value == value);
+}
+
+static bool test_slice(const char *line, uint8_t type, const char *slice){
+    struct cmd_token token;
+    return test_one(line, &token) && (token.type == type) && cmd_token_equals(&token, slice);
+}
+
+int main(){
+    // The ends of the int32_t range and one past them
+    TEST_CHECK(test_is("2147483647", CMD_TOKEN_INT, INT32_MAX));
+    TEST_CHECK(test_is("-2147483648", CMD_TOKEN_INT, INT32_MIN));
+    TEST_CHECK(test_is("+17", CMD_TOKEN_INT, 17));
+    TEST_CHECK(test_slice("2147483648", CMD_TOKEN_ERROR, "2147483648"));
+    TEST_CHECK(test_slice("-2147483649", CMD_TOKEN_ERROR, "-2147483649"));
+    TEST_CHECK(test_slice("99999999999999999999", CMD_TOKEN_ERROR, "99999999999999999999"));
+
+    // Hex
+    TEST_CHECK(test_is("0x1F", CMD_TOKEN_INT, 31));
+    TEST_CHECK(test_is("0x7fffffff", CMD_TOKEN_INT, INT32_MAX));
+    TEST_CHECK(test_is("-0x10", CMD_TOKEN_INT, -16));
+    TEST_CHECK(test_slice("0x80000000", CMD_TOKEN_ERROR, "0x80000000"));
+    TEST_CHECK(test_slice("0x", CMD_TOKEN_WORD, "0x"));
+    TEST_CHECK(test_slice("0x1g", CMD_TOKEN_WORD, "0x1g"));
+
+    // Fixed point keeps CMD_TOKEN_FIXED_DECIMALS decimals and drops the rest
+    TEST_CHECK(test_is("21.5", CMD_TOKEN_FIXED, 21500));
+    TEST_CHECK(test_is("1.23456", CMD_TOKEN_FIXED, 1234));
+    TEST_CHECK(test_is("-0.5", CMD_TOKEN_FIXED, -500));
+    TEST_CHECK(test_is("3.", CMD_TOKEN_FIXED, 3000));
+    TEST_CHECK(test_slice("2147483.648", CMD_TOKEN_ERROR, "2147483.648"));
+    TEST_CHECK(test_slice("1.2.3", CMD_TOKEN_WORD, "1.2.3"));
+
+    // Quotes
+    TEST_CHECK(test_slice("\"a b\"", CMD_TOKEN_STRING, "a b"));
+    TEST_CHECK(test_slice("\"\"", CMD_TOKEN_STRING, ""));
+    TEST_CHECK(test_slice("\"abc", CMD_TOKEN_ERROR, "abc"));
+
+    // A - followed by a digit is a number, otherwise options
+    TEST_CHECK(test_is("-40", CMD_TOKEN_INT, -40));
+    TEST_CHECK(test_slice("-abc", CMD_TOKEN_SHORT_OPTS, "abc"));
+    TEST_CHECK(test_slice("--rate", CMD_TOKEN_LONG_OPT, "rate"));
+    TEST_CHECK(test_slice("-", CMD_TOKEN_SHORT_OPTS, ""));
+    TEST_CHECK(test_slice("--", CMD_TOKEN_LONG_OPT, ""));
+    TEST_CHECK(test_slice("-x1", CMD_TOKEN_SHORT_OPTS, "x1"));
+
+    // A whole line, the end pointer stops it before the trailing text
+    const char *line = "stream  -f 2.5 --stop\"ignored";
+    const char *cursor = line;
+    const char *end = line + strlen("stream  -f 2.5 --stop");
+    struct cmd_token token;
+    TEST_CHECK(cmd_token_next(&cursor, end, &token) && (token.type == CMD_TOKEN_WORD) && cmd_token_equals(&token, "stream"));
+    TEST_CHECK(cmd_token_next(&cursor, end, &token) && (token.type == CMD_TOKEN_SHORT_OPTS) && cmd_token_equals(&token, "f"));
+    TEST_CHECK(cmd_token_next(&cursor, end, &token) && (token.type == CMD_TOKEN_FIXED) && (token.value == 2500));
+    TEST_CHECK(cmd_token_next(&cursor, end, &token) && (token.type == CMD_TOKEN_LONG_OPT) && cmd_token_equals(&token, "stop"));
+    TEST_CHECK(!cmd_token_next(&cursor, end, &token));
+    TEST_CHECK(!cmd_token_equals(&token, "sto"));
+
+    return test_report();
+}
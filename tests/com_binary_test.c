@@ -0,0 +1,84 @@
+#include <stdio.h>
+#include "../include/com_binary.h"
+
+#define TEST_NAME "COM_BINARY_TEST"
+#include "test_check.h"
+
+/*
+Host test of the COBS framing of binary mode, run by ctest.
+Round trips payloads around the 254 byte block limit and with zeros at the edges, checks the encoded lengths
+and that a corrupt code byte or a zero inside a frame is refused.
+*/
+
+#define TEST_MAX_LEN _u(600)
+#define TEST_MAX_ENCODED (TEST_MAX_LEN + TEST_MAX_LEN / 254 + 1)
+
+// Encodes len bytes of src, checks the encoded length and that no zero is left, then decodes and compares
+static bool test_round_trip(const uint8_t *src, uint16_t len, uint16_t encoded_len){
+    uint8_t encoded[TEST_MAX_ENCODED];
+    uint8_t decoded[TEST_MAX_ENCODED];
+    uint16_t n = com_binary_cobs_encode(src, len, encoded);
+    if (n != encoded_len){
+        printf("[" TEST_NAME "]: %u bytes encoded to %u, expected %u.\r\n", len, n, encoded_len);
+        return false;
+    }
+    if (memchr(encoded, 0, n) != NULL){
+        return false;
+    }
+    int m = com_binary_cobs_decode(encoded, n, decoded);
+    return (m == (int) len) && (memcmp(src, decoded, len) == 0);
+}
+
+// Fills len bytes with a non-zero pattern
+static void test_fill(uint8_t *dst, uint16_t len){
+    for (uint16_t i = 0; i < len; i++){
+        dst[i] = (uint8_t) ((i % 255) + 1);
+    }
+}
+
+int main(){
+    uint8_t data[TEST_MAX_LEN] = {0};
+
+    // Empty payload and single bytes
+    TEST_CHECK(test_round_trip(data, 0, 1));
+    data[0] = 0;
+    TEST_CHECK(test_round_trip(data, 1, 2));
+    data[0] = 0x11;
+    TEST_CHECK(test_round_trip(data, 1, 2));
+
+    // Runs of non-zero bytes around the longest block of 254
+    test_fill(data, TEST_MAX_LEN);
+    TEST_CHECK(test_round_trip(data, 253, 254));
+    TEST_CHECK(test_round_trip(data, 254, 256)); // A full block and the empty one that ends the frame
+    TEST_CHECK(test_round_trip(data, 255, 257));
+    TEST_CHECK(test_round_trip(data, 508, 511)); // Two full blocks
+    uint8_t encoded[TEST_MAX_ENCODED];
+    com_binary_cobs_encode(data, 254, encoded);
+    TEST_CHECK((encoded[0] == 0xff) && (encoded[255] == 0x01));
+
+    // Zeros at the end, at the start and right after a full block
+    test_fill(data, 10);
+    data[9] = 0;
+    TEST_CHECK(test_round_trip(data, 10, 11));
+    data[0] = 0;
+    TEST_CHECK(test_round_trip(data, 10, 11));
+    test_fill(data, 255);
+    data[254] = 0;
+    TEST_CHECK(test_round_trip(data, 255, 257));
+    memset(data, 0, 5);
+    TEST_CHECK(test_round_trip(data, 5, 6));
+
+    // Corrupt frames
+    uint8_t decoded[TEST_MAX_ENCODED];
+    const uint8_t past_end[] = {0x05, 0x01, 0x02}; // Code byte runs past the frame
+    TEST_CHECK(com_binary_cobs_decode(past_end, sizeof(past_end), decoded) == -1);
+    const uint8_t zero_code[] = {0x02, 0x01, 0x00, 0x01}; // A zero where a code byte belongs
+    TEST_CHECK(com_binary_cobs_decode(zero_code, sizeof(zero_code), decoded) == -1);
+    const uint8_t zero_data[] = {0x04, 0x01, 0x00, 0x02}; // A zero inside a block
+    TEST_CHECK(com_binary_cobs_decode(zero_data, sizeof(zero_data), decoded) == -1);
+
+    // The CRC of the frames, CRC16-CCITT with init 0xFFFF gives 0x29B1 for "123456789"
+    TEST_CHECK(com_binary_crc16((const uint8_t *) "123456789", 9) == 0x29B1);
+
+    return test_report();
+}
@@ -0,0 +1,101 @@
+#include <stdio.h>
+#include "../include/eeprom_log.h"
+
+#define TEST_NAME "EEPROM_LOG_TEST"
+#include "test_check.h"
+
+/*
+Host test of the sample log on the file backend, built by a PICO_PLATFORM=host configure and run by ctest.
+The file backend follows the flash rules, so this runs the erase on wrap and the read, patch and program
+of records smaller than the program size. Checks appends, queries, the rebuild at boot and the wrap.
+*/
+
+#define TEST_FILE "eeprom_log_test.img"
+#define TEST_SIZE _u(4096)
+#define TEST_ERASE _u(512) // 64 slots
+#define TEST_PROGRAM _u(64) // 8 slots
+
+// Queries [start, end] and returns the amount of matches
+static uint32_t test_query(struct eeprom_log *log, uint32_t start, uint32_t end, bool aggregate){
+    log->q_start = start;
+    log->q_end = end;
+    log->q_aggregate = aggregate;
+    TEST_CHECK(eeprom_log_query(log) == BLOCK_STORAGE_OK);
+    return log->n_matched;
+}
+
+// Opens a fresh image and a log on it
+static void test_open(struct block_storage *storage, struct eeprom_log *log, bool fresh){
+    if (fresh){
+        remove(TEST_FILE);
+    }
+    TEST_CHECK(block_storage_file_init(storage, TEST_FILE, TEST_SIZE, TEST_ERASE, TEST_PROGRAM) == BLOCK_STORAGE_OK);
+    TEST_CHECK(eeprom_log_init(log, storage) == BLOCK_STORAGE_OK);
+}
+
+int main(){
+    stdio_init_all();
+    struct block_storage storage;
+    struct eeprom_log log;
+    uint32_t base = eeprom_log_timestamp(1, 0, 0, 0);
+
+    test_open(&storage, &log, true);
+    TEST_CHECK(log.n_slots == TEST_SIZE / EEPROM_LOG_RECORD_SIZE);
+    TEST_CHECK(log.count == 0);
+
+    // One sample a second
+    for (uint32_t i = 0; i < 100; i++){
+        TEST_CHECK(eeprom_log_append(&log, base + i, i) == BLOCK_STORAGE_OK);
+    }
+    TEST_CHECK(log.count == 100);
+    TEST_CHECK(test_query(&log, base + 10, base + 19, false) == 10);
+    TEST_CHECK(log.n_results == 10);
+    TEST_CHECK(log.results[0].value == 10);
+    TEST_CHECK(log.results[9].timestamp == base + 19);
+    TEST_CHECK(test_query(&log, 0, UINT32_MAX, true) == 100);
+    TEST_CHECK((log.min == 0) && (log.max == 99) && (log.mean == 49));
+
+    // The index, head and count come back from the storage
+    block_storage_file_deinit(&storage);
+    test_open(&storage, &log, false);
+    TEST_CHECK(log.count == 100);
+    TEST_CHECK(log.head == 100);
+
+    // Past the end the oldest erase unit is given up whenever the head enters it
+    uint32_t total = 700;
+    for (uint32_t i = 100; i < total; i++){
+        TEST_CHECK(eeprom_log_append(&log, base + i, i) == BLOCK_STORAGE_OK);
+    }
+    uint32_t erase_slots = TEST_ERASE / EEPROM_LOG_RECORD_SIZE;
+    uint32_t expected = log.n_slots - erase_slots + (log.head % erase_slots);
+    TEST_CHECK(log.head == total % log.n_slots);
+    TEST_CHECK(log.count == expected);
+    TEST_CHECK(test_query(&log, 0, UINT32_MAX, false) == expected);
+    TEST_CHECK(log.results[0].value == total - expected);
+    TEST_CHECK(test_query(&log, base + total - 5, UINT32_MAX, false) == 5);
+
+    block_storage_file_deinit(&storage);
+    test_open(&storage, &log, false);
+    TEST_CHECK(log.count == expected);
+    TEST_CHECK(log.head == total % log.n_slots);
+
+    // Six samples of the same second straddle the start of the second index run
+    block_storage_file_deinit(&storage);
+    test_open(&storage, &log, true);
+    uint32_t run = log.index_slots;
+    for (uint32_t i = 0; i < 2 * run; i++){
+        uint32_t ts = base + i;
+        if ((i >= run - 3) && (i < run + 3)){
+            ts = base + run;
+        }
+        else if (i >= run + 3){
+            ts = base + run + i;
+        }
+        TEST_CHECK(eeprom_log_append(&log, ts, i) == BLOCK_STORAGE_OK);
+    }
+    TEST_CHECK(test_query(&log, base + run, base + run, false) == 6);
+
+    block_storage_file_deinit(&storage);
+    remove(TEST_FILE);
+    return test_report();
+}
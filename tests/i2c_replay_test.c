@@ -0,0 +1,64 @@
+#include <stdio.h>
+#include "../include/i2c_bus.h"
+
+#define TEST_NAME "I2C_REPLAY_TEST"
+#include "test_check.h"
+
+/*
+Host test of the trace replay, built by a PICO_PLATFORM=host configure and run by ctest.
+Writes a short trace the way "i2c -d" prints it, runs the bus layer on it and checks that
+the drivers get the recorded bytes and results, that the gaps between transfers are kept
+and that transfers the trace does not have fail.
+*/
+
+#define TEST_GAP_US _u(20000) // Gap in the trace between the first read and the write
+
+// No retries, a retry would take the next record
+static const struct i2c_device test_device = {.bus = &i2c_bus0, .addr = 0x77, .name = "test", .max_baudrate = 0, .retries = 0};
+
+static bool test_write_trace(const char *path){
+    FILE *file = fopen(path, "w");
+    if (file == NULL){
+        return false;
+    }
+    // Anything without the tag is skipped, as in a full serial log
+    fprintf(file, "Trace capturing, 5 records captured, 0 dropped.\r\n");
+    fprintf(file, I2C_TRACE_TAG " 1000000 100 77 02 1 1 d0\r\n");
+    fprintf(file, I2C_TRACE_TAG " 1000150 120 77 01 1 1 55\r\n");
+    fprintf(file, I2C_TRACE_TAG " %u 200 77 00 2 2 f42e\r\n", 1000000 + TEST_GAP_US);
+    fprintf(file, I2C_TRACE_TAG " %u 100 77 02 1 1 f6\r\n", 1010000 + TEST_GAP_US);
+    fprintf(file, I2C_TRACE_TAG " %u 150 77 01 2 2 6a4b\r\n", 1010150 + TEST_GAP_US);
+    fclose(file);
+    return true;
+}
+
+int main(){
+    stdio_init_all();
+    if (!test_write_trace(I2C_REPLAY_FILE)){
+        printf("[I2C_REPLAY_TEST]: Could not write %s.\r\n", I2C_REPLAY_FILE);
+        return 1;
+    }
+    // Opens the trace
+    i2c_bus_init(&i2c_bus0);
+
+    // Register read, the write of the register and the read both come from the trace
+    uint32_t start = time_us_32();
+    uint8_t id = 0;
+    TEST_CHECK(i2c_bus_reg_read(&test_device, 0xD0, &id, 1) == 1);
+    TEST_CHECK(id == 0x55);
+
+    // The write is recorded TEST_GAP_US after the first transfer, the replay has to wait for it
+    uint8_t ctrl = 0x2E;
+    TEST_CHECK(i2c_bus_reg_write(&test_device, 0xF4, &ctrl, 1) == 1);
+    TEST_CHECK((time_us_32() - start) >= TEST_GAP_US);
+
+    // The trace has a 2 byte read here, asking for 3 diverges
+    uint8_t data[3];
+    TEST_CHECK(i2c_bus_reg_read(&test_device, 0xF6, data, 3) == PICO_ERROR_GENERIC);
+
+    // Past the end every transfer fails
+    TEST_CHECK(i2c_bus_reg_read(&test_device, 0xD0, &id, 1) == PICO_ERROR_GENERIC);
+
+    i2c_replay_close();
+    return test_report();
+}
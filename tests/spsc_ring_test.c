@@ -0,0 +1,114 @@
+#include <stdio.h>
+#include "../include/spsc_ring.h"
+
+#define TEST_NAME "SPSC_RING_TEST"
+#include "test_check.h"
+
+/*
+Host test of the SPSC ring, run by ctest. Producer and consumer are the same thread here,
+so this checks the index arithmetic and the copies, not the barriers.
+Covers single and batch push and pop across the wrap, the free running indices and the dropped and high_water counters.
+*/
+
+#define TEST_RING_LEN _u(4)
+
+// Records larger than a word so a wrong slot size shows
+struct test_record {
+    uint32_t seq;
+    uint8_t pad[3];
+};
+
+static struct test_record test_records[TEST_RING_LEN];
+
+// Pops n records and checks they carry the sequence numbers first, first + 1, ...
+static bool test_pop_seq(struct spsc_ring *ring, uint32_t first, uint32_t n){
+    struct test_record out[TEST_RING_LEN * 2];
+    if (spsc_ring_pop_batch(ring, out, n) != n){
+        return false;
+    }
+    for (uint32_t i = 0; i < n; i++){
+        if ((out[i].seq != first + i) || (out[i].pad[2] != (uint8_t) (first + i))){
+            return false;
+        }
+    }
+    return true;
+}
+
+static void test_make(struct test_record *records, uint32_t first, uint32_t n){
+    for (uint32_t i = 0; i < n; i++){
+        records[i].seq = first + i;
+        memset(records[i].pad, (uint8_t) (first + i), sizeof(records[i].pad));
+    }
+}
+
+int main(){
+    struct spsc_ring ring;
+    spsc_ring_init(&ring, test_records, sizeof(struct test_record), TEST_RING_LEN);
+    struct test_record in[TEST_RING_LEN * 2];
+    struct test_record one;
+
+    TEST_CHECK(spsc_ring_capacity(&ring) == TEST_RING_LEN);
+    TEST_CHECK(spsc_ring_is_empty(&ring));
+    TEST_CHECK(!spsc_ring_pop(&ring, &one));
+
+    // Single records across the wrap: 3 in, 2 out, 3 more in ends at slot 2 after passing slot 3
+    for (uint32_t i = 0; i < 3; i++){
+        test_make(&one, i, 1);
+        TEST_CHECK(spsc_ring_push(&ring, &one));
+    }
+    TEST_CHECK(test_pop_seq(&ring, 0, 2));
+    for (uint32_t i = 3; i < 6; i++){
+        test_make(&one, i, 1);
+        TEST_CHECK(spsc_ring_push(&ring, &one));
+    }
+    TEST_CHECK(spsc_ring_level(&ring) == TEST_RING_LEN);
+    TEST_CHECK(spsc_ring_pop(&ring, &one) && (one.seq == 2));
+    TEST_CHECK(test_pop_seq(&ring, 3, 3));
+    TEST_CHECK(spsc_ring_is_empty(&ring));
+    TEST_CHECK(ring.dropped == 0);
+    TEST_CHECK(ring.high_water == TEST_RING_LEN);
+
+    // Batch push and pop split at the end, head and tail are at slot 2
+    test_make(in, 10, 4);
+    TEST_CHECK(spsc_ring_push_batch(&ring, in, 4) == 4);
+    TEST_CHECK(test_pop_seq(&ring, 10, 3));
+    test_make(in, 14, 3);
+    TEST_CHECK(spsc_ring_push_batch(&ring, in, 3) == 3);
+    TEST_CHECK(test_pop_seq(&ring, 13, 4));
+
+    // A batch larger than the free space keeps the first records and counts the rest
+    test_make(in, 20, 6);
+    TEST_CHECK(spsc_ring_push_batch(&ring, in, 6) == TEST_RING_LEN);
+    TEST_CHECK(ring.dropped == 2);
+    test_make(&one, 26, 1);
+    TEST_CHECK(!spsc_ring_push(&ring, &one));
+    TEST_CHECK(ring.dropped == 3);
+    TEST_CHECK(spsc_ring_push_batch(&ring, in, 0) == 0);
+    TEST_CHECK(ring.dropped == 3);
+
+    // Popping more than there is returns what there is
+    struct test_record out[TEST_RING_LEN * 2];
+    TEST_CHECK(spsc_ring_pop_batch(&ring, out, TEST_RING_LEN * 2) == TEST_RING_LEN);
+    TEST_CHECK((out[0].seq == 20) && (out[TEST_RING_LEN - 1].seq == 23));
+    TEST_CHECK(spsc_ring_pop_batch(&ring, out, 1) == 0);
+
+    // high_water keeps the highest level, flush empties the ring
+    TEST_CHECK(ring.high_water == TEST_RING_LEN);
+    test_make(in, 30, 2);
+    spsc_ring_push_batch(&ring, in, 2);
+    spsc_ring_flush(&ring);
+    TEST_CHECK(spsc_ring_is_empty(&ring));
+    TEST_CHECK(ring.high_water == TEST_RING_LEN);
+
+    // The free running indices wrap around 2^32 like any other boundary
+    spsc_ring_init(&ring, test_records, sizeof(struct test_record), TEST_RING_LEN);
+    ring.head = UINT32_MAX - 1;
+    ring.tail = UINT32_MAX - 1;
+    test_make(in, 40, 4);
+    TEST_CHECK(spsc_ring_push_batch(&ring, in, 4) == 4);
+    TEST_CHECK(spsc_ring_level(&ring) == TEST_RING_LEN);
+    TEST_CHECK(test_pop_seq(&ring, 40, 4));
+    TEST_CHECK(ring.head == 2);
+
+    return test_report();
+}
@@ -0,0 +1,33 @@
+#ifndef __TEST_CHECK_H__
+#define __TEST_CHECK_H__
+// Checks shared by the host tests.
+
+#include <stdio.h>
+#include "pico/stdlib.h"
+
+/*
+Each test defines TEST_NAME, the tag of its prints, before it includes this file.
+TEST_CHECK counts a failed condition and carries on, so one run reports every failure.
+main ends with return test_report(), which prints the summary and gives ctest the exit code.
+*/
+
+#ifndef TEST_NAME
+#error "Define TEST_NAME before including test_check.h"
+#endif
+
+static uint32_t test_failures = 0;
+
+#define TEST_CHECK(cond) do { \
+        if (!(cond)){ \
+            printf("[" TEST_NAME "]: %s:%d failed: %s\r\n", __FILE__, __LINE__, #cond); \
+            test_failures++; \
+        } \
+    } while (0)
+
+// Prints the summary. Returns the exit code of the test, 0 if every check passed.
+static inline int test_report(){
+    printf("[" TEST_NAME "]: %s, %u checks failed.\r\n", (test_failures == 0) ? "Passed" : "FAILED", test_failures);
+    return (test_failures == 0) ? 0 : 1;
+}
+
+#endif